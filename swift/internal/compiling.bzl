@@ -58,6 +58,7 @@ load(
     "SWIFT_FEATURE_OPT",
     "SWIFT_FEATURE_OPT_USES_WMO",
     "SWIFT_FEATURE_PROPAGATE_GENERATED_MODULE_MAP",
+    "SWIFT_FEATURE_PRUNE_UNUSED_INPUTS",
     "SWIFT_FEATURE_SPLIT_DERIVED_FILES_GENERATION",
     "SWIFT_FEATURE_SYSTEM_MODULE",
     "SWIFT_FEATURE_THIN_LTO",
@@ -662,6 +663,9 @@ def compile(
         ]) + compile_outputs.object_files + compile_outputs.const_values_files
         all_derived_outputs = []
 
+    # Dependency files are written by the action that produces the objects.
+    all_compile_outputs += compile_outputs.dependency_files
+
     # In `upstream` they call `merge_compilation_contexts` on passed in
     # `compilation_contexts` instead of merging `CcInfo`s. This is because
     # they don't need the merged linking context to disable framework
@@ -754,6 +758,30 @@ def compile(
     else:
         deps_modules_file = None
 
+    if is_feature_enabled(
+        feature_configuration = feature_configuration,
+        feature_name = SWIFT_FEATURE_PRUNE_UNUSED_INPUTS,
+    ):
+        prunable_inputs_file = actions.declare_file(
+            "{}.prunable_inputs".format(target_name),
+        )
+        _write_prunable_inputs_file(
+            actions = actions,
+            headers = merged_cc_info.compilation_context.headers,
+            prunable_inputs_file = prunable_inputs_file,
+            transitive_modules = transitive_modules,
+            transitive_swift_dependency_inputs = (
+                transitive_swift_dependency_inputs_list
+            ),
+        )
+        unused_inputs_file = actions.declare_file(
+            "{}.unused_inputs".format(target_name),
+        )
+        all_compile_outputs.append(unused_inputs_file)
+    else:
+        prunable_inputs_file = None
+        unused_inputs_file = None
+
     # As of the time of this writing (Xcode 15.0), macros are the only kind of
     # plugins that are available. Since macros do source-level transformations,
     # we only need to load plugins directly used by the module being compiled.
@@ -807,10 +835,12 @@ to use swift_common.compile(include_dev_srch_paths = ...) instead.\
         original_module_name = original_module_name,
         package_name = package_name,
         plugins = collections.uniq(used_plugins),
+        prunable_inputs_file = prunable_inputs_file,
         source_files = srcs,
         target_label = feature_configuration._label,
         transitive_modules = transitive_modules,
         transitive_swift_dependency_inputs = transitive_swift_dependency_inputs_list,
+        unused_inputs_file = unused_inputs_file,
         upcoming_features = upcoming_features,
         user_compile_flags = copts,
         workspace_name = workspace_name,
@@ -841,6 +871,7 @@ to use swift_common.compile(include_dev_srch_paths = ...) instead.\
         progress_message = "Compiling Swift module %{label}",
         swift_toolchain = toolchains.swift,
         toolchain_type = toolchain_type,
+        unused_inputs_list = unused_inputs_file,
     )
 
     # Dump AST has to run in its own action because `-dump-ast` is incompatible
@@ -1543,6 +1574,13 @@ def _declare_compile_outputs(
         indexstore_directory = None
         include_index_unit_paths = False
 
+    # The dependency files record what the compiler read, so that the worker can
+    # tell Bazel which inputs were unused.
+    emit_dependencies = is_feature_enabled(
+        feature_configuration = feature_configuration,
+        feature_name = SWIFT_FEATURE_PRUNE_UNUSED_INPUTS,
+    )
+
     # Configure localized-string extraction if requested. The compiler emits one
     # `.stringsdata` file per source file into this directory; the file set is
     # not known at analysis time, so (like the index store) it must be a
@@ -1573,6 +1611,14 @@ def _declare_compile_outputs(
         const_values_files = [
             actions.declare_file("{}.swiftconstvalues".format(target_name)),
         ]
+
+        # The driver names the dependency file after the object file.
+        if emit_dependencies:
+            dependency_files = [
+                actions.declare_file("{}.d".format(target_name)),
+            ]
+        else:
+            dependency_files = []
         output_file_map = None
         derived_files_output_file_map = None
         # TODO(b/147451378): Support indexing even with a single object file.
@@ -1606,6 +1652,7 @@ def _declare_compile_outputs(
         # object files so that we can pass them all to the archive action.
         output_info = _declare_multiple_outputs_and_write_output_file_map(
             actions = actions,
+            emit_dependencies = emit_dependencies,
             extract_const_values = extract_const_values,
             is_wmo = output_nature.is_wmo,
             emits_bc = emits_bc,
@@ -1617,6 +1664,7 @@ def _declare_compile_outputs(
         object_files = output_info.object_files
         ast_files = output_info.ast_files
         const_values_files = output_info.const_values_files
+        dependency_files = output_info.dependency_files
         output_file_map = output_info.output_file_map
         derived_files_output_file_map = output_info.derived_files_output_file_map
 
@@ -1633,6 +1681,7 @@ def _declare_compile_outputs(
     compile_outputs = struct(
         ast_files = ast_files,
         const_values_files = const_values_files,
+        dependency_files = dependency_files,
         generated_header_file = generated_header,
         generated_module_map_file = generated_module_map,
         indexstore_directory = indexstore_directory,
@@ -1679,6 +1728,7 @@ def _declare_per_source_output_file(actions, extension, target_name, src):
 
 def _declare_multiple_outputs_and_write_output_file_map(
         actions,
+        emit_dependencies,
         extract_const_values,
         is_wmo,
         emits_bc,
@@ -1690,6 +1740,8 @@ def _declare_multiple_outputs_and_write_output_file_map(
 
     Args:
         actions: The object used to register actions.
+        emit_dependencies: A Boolean value indicating whether the compiler
+            should write Make-style dependency files.
         extract_const_values: A Boolean value indicating whether constant values
             should be extracted during this compilation.
         is_wmo: A Boolean value indicating whether whole-module-optimization was
@@ -1707,6 +1759,8 @@ def _declare_multiple_outputs_and_write_output_file_map(
     Returns:
         A `struct` with the following fields:
 
+        *   `dependency_files`: A list of the Make-style dependency files that
+            were declared and recorded in the output file map, if requested.
         *   `derived_files_output_file_map`: A `File` that represents the
             output file map that should be passed to derived file generation
             actions instead of the default `output_file_map` that is used for
@@ -1738,6 +1792,14 @@ def _declare_multiple_outputs_and_write_output_file_map(
     ast_files = []
     output_objs = []
     const_values_files = []
+    dependency_files = []
+
+    # Under whole-module optimization, a single frontend job writes one
+    # dependency file for the whole module.
+    if emit_dependencies and is_wmo:
+        dependency_file = actions.declare_file("{}.d".format(target_name))
+        dependency_files.append(dependency_file)
+        whole_module_map["dependencies"] = dependency_file.path
 
     if extract_const_values and is_wmo:
         const_values_file = actions.declare_file(
@@ -1792,6 +1854,16 @@ def _declare_multiple_outputs_and_write_output_file_map(
             const_values_files.append(const_values_file)
             file_outputs["const-values"] = const_values_file.path
 
+        if emit_dependencies and not is_wmo:
+            dependency_file = _declare_per_source_output_file(
+                actions = actions,
+                extension = "d",
+                target_name = target_name,
+                src = src,
+            )
+            dependency_files.append(dependency_file)
+            file_outputs["dependencies"] = dependency_file.path
+
         output_map[src.path] = file_outputs
 
     if whole_module_map:
@@ -1811,6 +1883,7 @@ def _declare_multiple_outputs_and_write_output_file_map(
     return struct(
         ast_files = ast_files,
         const_values_files = const_values_files,
+        dependency_files = dependency_files,
         derived_files_output_file_map = derived_files_output_map_file,
         object_files = output_objs,
         output_file_map = output_map_file,
@@ -1930,6 +2003,79 @@ def _emitted_output_nature(feature_configuration, user_compile_flags):
         is_wmo = is_wmo,
     )
 
+def _prunable_input_path(file):
+    """A `map_each` helper that skips directories among the prunable inputs.
+
+    Args:
+        file: A `File` that is an input to the compilation action.
+
+    Returns:
+        The path of the file, or `None` if it is a directory. The compiler
+        reports the files it reads inside a directory, never the directory
+        itself, so a directory would always look unused.
+    """
+    if file.is_directory:
+        return None
+    return file.path
+
+def _write_prunable_inputs_file(
+        *,
+        actions,
+        headers,
+        prunable_inputs_file,
+        transitive_modules,
+        transitive_swift_dependency_inputs):
+    """Writes the list of compilation inputs that may be reported as unused.
+
+    The Swift worker compares this list to the dependency files written by the
+    compiler and reports the entries that the compiler did not read in the
+    action's `unused_inputs_list`. Only files that come from dependencies are
+    listed; sources and files generated for this target are always used.
+
+    Args:
+        actions: The object used to register actions.
+        headers: A `depset` of the transitive headers of the target's
+            dependencies.
+        prunable_inputs_file: The output file that will contain the list of
+            paths, one per line.
+        transitive_modules: The list of transitive module contexts of the
+            target being compiled.
+        transitive_swift_dependency_inputs: The `.swiftmodule` and textual
+            interface files of the target's Swift dependencies.
+    """
+    clang_module_files = []
+    for module in transitive_modules:
+        clang_module = module.clang
+        if not clang_module:
+            continue
+        if type(clang_module.module_map) == "File":
+            clang_module_files.append(clang_module.module_map)
+        if clang_module.precompiled_module:
+            clang_module_files.append(clang_module.precompiled_module)
+
+    prunable_inputs = actions.args()
+    prunable_inputs.set_param_file_format("multiline")
+    prunable_inputs.add_all(
+        transitive_swift_dependency_inputs,
+        expand_directories = False,
+        map_each = _prunable_input_path,
+    )
+    prunable_inputs.add_all(
+        clang_module_files,
+        expand_directories = False,
+        map_each = _prunable_input_path,
+    )
+    prunable_inputs.add_all(
+        headers,
+        expand_directories = False,
+        map_each = _prunable_input_path,
+    )
+
+    actions.write(
+        content = prunable_inputs,
+        output = prunable_inputs_file,
+    )
+
 def _write_deps_modules_file(
         actions,
         deps_modules_file,
@@ -47,6 +47,13 @@ SWIFT_FEATURE_NO_IMPLICIT_DEPS = "swift.no_implicit_deps"
 # compilation actions, even when building with explicit modules.
 SWIFT_FEATURE_HEADERS_ALWAYS_ACTION_INPUTS = "swift.headers_always_action_inputs"
 
+# If enabled, Swift compilation actions emit Make-style dependency files and the
+# worker uses them to write an `unused_inputs_list` naming the transitive
+# `.swiftmodule`s, textual interfaces, headers, module maps, and precompiled
+# modules that the compiler did not read. Bazel then ignores changes to those
+# files when deciding whether the action needs to run again.
+SWIFT_FEATURE_PRUNE_UNUSED_INPUTS = "swift.prune_unused_inputs"
+
 # This feature is enabled if coverage collection is enabled for the build. (See
 # the note above about not depending on the C++ features.)
 SWIFT_FEATURE_COVERAGE = "swift.coverage"
@@ -105,6 +112,10 @@ SWIFT_FEATURE_INDEX_WHILE_BUILDING = "swift.index_while_building"
 SWIFT_FEATURE_DISABLE_SYSTEM_INDEX = "swift.disable_system_index"
 
 # Index while building - using a global index store cache
+#
+# Nothing in the build removes stale units or records from the global store;
+# `bazel run @rules_swift//tools/index_store_gc -- <store>` prunes
+# the ones whose output files no longer exist.
 SWIFT_FEATURE_USE_GLOBAL_INDEX_STORE = "swift.use_global_index_store"
 
 # If enabled, indexstore data will contain local definitions and references.
@@ -78,6 +78,7 @@ load(
     "SWIFT_FEATURE_OPT",
     "SWIFT_FEATURE_OPT_USES_OSIZE",
     "SWIFT_FEATURE_OPT_USES_WMO",
+    "SWIFT_FEATURE_PRUNE_UNUSED_INPUTS",
     "SWIFT_FEATURE_REWRITE_GENERATED_HEADER",
     "SWIFT_FEATURE_SPLIT_DERIVED_FILES_GENERATION",
     "SWIFT_FEATURE_SUPPRESS_WARNINGS",
@@ -268,6 +269,13 @@ def compile_action_configs(
             features = [SWIFT_FEATURE_LAYERING_CHECK_SWIFT],
         ),
 
+        # Emit dependency files and report the inputs the compiler didn't read.
+        ActionConfigInfo(
+            actions = [SWIFT_ACTION_COMPILE],
+            configurators = [_prune_unused_inputs_configurator],
+            features = [SWIFT_FEATURE_PRUNE_UNUSED_INPUTS],
+        ),
+
         # Configure constant value extraction.
         ActionConfigInfo(
             actions = [SWIFT_ACTION_COMPILE],
@@ -1635,6 +1643,26 @@ def _swift_layering_check_configurator(prerequisites, args):
         inputs = [prerequisites.deps_modules_file],
     )
 
+def _prune_unused_inputs_configurator(prerequisites, args):
+    """Adds flags that let the worker report unused inputs to Bazel."""
+    if not prerequisites.unused_inputs_file:
+        return ConfigResultInfo()
+
+    args.add("-emit-dependencies")
+    args.add(
+        "-Xwrapped-swift=-unused-inputs-list={}".format(
+            prerequisites.unused_inputs_file.path,
+        ),
+    )
+    args.add(
+        "-Xwrapped-swift=-prunable-inputs={}".format(
+            prerequisites.prunable_inputs_file.path,
+        ),
+    )
+    return ConfigResultInfo(
+        inputs = [prerequisites.prunable_inputs_file],
+    )
+
 def _global_module_cache_configurator(prerequisites, args):
     """Adds flags to enable the global module cache."""
 
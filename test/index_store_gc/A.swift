@@ -0,0 +1,3 @@
+public struct A {
+    public init() {}
+}
@@ -0,0 +1,3 @@
+public struct B {
+    public init() {}
+}
@@ -0,0 +1,3 @@
+public struct C {
+    public init() {}
+}
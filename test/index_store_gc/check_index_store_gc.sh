@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+
+set -euo pipefail
+
+if [[ $# -ne 3 ]]; then
+  echo "usage: $0 <index_store_gc> <index_unit_tool> <index-store>" >&2
+  exit 2
+fi
+
+readonly gc="$1"
+readonly tool="$2"
+readonly work="${TEST_TMPDIR:-$(mktemp -d)}/index_store_gc_test"
+
+rm -rf "$work"
+mkdir -p "$work/exec_root"
+cp -RL "$3" "$work/store"
+chmod -R u+w "$work/store"
+
+readonly units_dir="$(echo "$work"/store/v*/units)"
+readonly records_dir="$(echo "$work"/store/v*/records)"
+
+fail() {
+  echo "error: $*" >&2
+  exit 1
+}
+
+record_path() {
+  echo "$records_dir/${1: -2}/$1"
+}
+
+# Find the units of the three sources of the fixture.
+unit_a=""
+unit_b=""
+unit_c=""
+for unit in "$units_dir"/*; do
+  case "$("$tool" output "$unit")" in
+    */A.swift.o) unit_a="$unit" ;;
+    */B.swift.o) unit_b="$unit" ;;
+    */C.swift.o) unit_c="$unit" ;;
+  esac
+done
+[[ -n "$unit_a" && -n "$unit_b" && -n "$unit_c" ]] ||
+  fail "could not find the units of A.swift, B.swift, and C.swift"
+
+"$tool" records "$unit_a" > "$work/a_records"
+"$tool" records "$unit_b" > "$work/b_records"
+"$tool" records "$unit_c" > "$work/c_records"
+[[ -s "$work/c_records" ]] || fail "C.swift's unit references no records"
+
+# A's unit names no output file, so it must be kept; B's output exists; C's
+# output is resolved against an exec root that doesn't have it.
+"$tool" set-output "$unit_a" ""
+touch "$work/exec_root/B.swift.o"
+"$tool" set-output "$unit_b" "$work/exec_root/B.swift.o"
+"$tool" set-output "$unit_c" "missing/C.swift.o"
+
+# Age everything in the store past the grace period.
+find "$work/store" -type f -exec touch -t 202001010000 {} +
+
+"$gc" --grace-period=1h --exec-root="$work/exec_root" "$work/store"
+
+[[ -f "$unit_a" ]] || fail "the unit without an output file was pruned"
+[[ -f "$unit_b" ]] || fail "the unit whose output exists was pruned"
+[[ ! -f "$unit_c" ]] || fail "the unit whose output is missing was kept"
+
+while read -r record; do
+  [[ -f "$(record_path "$record")" ]] ||
+    fail "record $record of a kept unit was pruned"
+done < <(cat "$work/a_records" "$work/b_records")
+
+while read -r record; do
+  if ! grep -qxF "$record" "$work/a_records" "$work/b_records"; then
+    [[ ! -f "$(record_path "$record")" ]] ||
+      fail "record $record of a pruned unit was kept"
+  fi
+done < "$work/c_records"
+
+echo "ok: index_store_gc kept and pruned the expected units and records"
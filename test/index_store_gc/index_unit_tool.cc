@@ -0,0 +1,100 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Inspects and edits index unit files for the index store GC test.
+//
+// Usage:
+//   index_unit_tool output <unit>            Prints the unit's output file.
+//   index_unit_tool records <unit>           Prints the records it references.
+//   index_unit_tool set-output <unit> <path> Changes the unit's output file.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#include "tools/common/index_store.h"
+
+using bazel_rules_swift::IndexPathRemapper;
+using bazel_rules_swift::IndexUnit;
+using bazel_rules_swift::IndexUnitDependency;
+using bazel_rules_swift::IndexUnitDependencyKind;
+
+namespace {
+
+int Fail(const std::string& message) {
+  std::cerr << "index_unit_tool: " << message << "\n";
+  return EXIT_FAILURE;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    return Fail("usage: index_unit_tool output|records|set-output <unit> ...");
+  }
+  std::string command = argv[1];
+  std::string unit_path = argv[2];
+
+  std::ifstream stream(unit_path, std::ios::binary);
+  std::ostringstream contents;
+  contents << stream.rdbuf();
+  std::string data = contents.str();
+
+  std::string error;
+  std::optional<IndexUnit> unit =
+      bazel_rules_swift::ParseIndexUnit(data, &error);
+  if (!unit.has_value()) {
+    return Fail(unit_path + ": " + error);
+  }
+
+  if (command == "output" && argc == 3) {
+    std::cout << unit->output_file << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (command == "records" && argc == 3) {
+    for (const IndexUnitDependency& dependency : unit->dependencies) {
+      if (dependency.kind == IndexUnitDependencyKind::kRecord) {
+        std::cout << dependency.name << "\n";
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+
+  if (command == "set-output" && argc == 4) {
+    // A mapping of the whole output path replaces it and nothing else.
+    IndexPathRemapper remapper;
+    remapper.AddPrefixMapping(unit->output_file, argv[3]);
+    std::string output_file;
+    std::optional<std::string> remapped = bazel_rules_swift::RemapIndexUnit(
+        data, remapper, &output_file, &error);
+    if (!remapped.has_value()) {
+      return Fail(unit_path + ": " + error);
+    }
+    if (output_file != argv[3]) {
+      return Fail(unit_path + ": output file was not rewritten");
+    }
+    std::ofstream out(unit_path, std::ios::binary | std::ios::trunc);
+    out << *remapped;
+    if (!out.good()) {
+      return Fail("could not write " + unit_path);
+    }
+    return EXIT_SUCCESS;
+  }
+
+  return Fail("unknown command " + command);
+}
@@ -0,0 +1,92 @@
+# Copyright 2026 The Bazel Authors. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Tests for the `swift.prune_unused_inputs` feature."""
+
+load(
+    "//test/rules:action_command_line_test.bzl",
+    "action_command_line_test",
+    "make_action_command_line_test_rule",
+)
+load(
+    "//test/rules:output_file_map_test.bzl",
+    "make_output_file_map_test_rule",
+)
+
+unused_inputs_action_test = make_action_command_line_test_rule(
+    config_settings = {
+        "//command_line_option:features": [
+            "swift.prune_unused_inputs",
+        ],
+    },
+)
+
+unused_inputs_output_file_map_test = make_output_file_map_test_rule(
+    config_settings = {
+        "//command_line_option:features": [
+            "swift.prune_unused_inputs",
+        ],
+    },
+)
+
+def unused_inputs_test_suite(name, tags = []):
+    """Test suite for the `swift.prune_unused_inputs` feature.
+
+    Args:
+        name: The base name to be used in things created by this macro.
+        tags: Additional tags to apply to each test.
+    """
+    all_tags = [name] + tags
+
+    # When the feature is disabled (the default), the compiler is not asked to
+    # emit dependency files and the worker reports no unused inputs.
+    action_command_line_test(
+        name = "{}_disabled_by_default".format(name),
+        not_expected_argv = [
+            "-emit-dependencies",
+            "-Xwrapped-swift=-unused-inputs-list",
+        ],
+        mnemonic = "SwiftCompile",
+        tags = all_tags,
+        target_under_test = "//test/fixtures/multiple_files",
+    )
+
+    unused_inputs_action_test(
+        name = "{}_enabled_passes_flags".format(name),
+        expected_argv = [
+            "-emit-dependencies",
+            "-Xwrapped-swift=-unused-inputs-list",
+            "-Xwrapped-swift=-prunable-inputs",
+        ],
+        mnemonic = "SwiftCompile",
+        tags = all_tags,
+        target_under_test = "//test/fixtures/multiple_files",
+    )
+
+    # Each source's dependency file is recorded in the output file map.
+    unused_inputs_output_file_map_test(
+        name = "{}_output_file_map".format(name),
+        expected_mapping = {
+            "dependencies": "test/fixtures/debug_settings/simple_objs/Empty.swift.d",
+        },
+        file_entry = "test/fixtures/debug_settings/Empty.swift",
+        output_file_map = "test/fixtures/debug_settings/simple.output_file_map.json",
+        tags = all_tags,
+        target_under_test = "//test/fixtures/debug_settings:simple",
+    )
+
+    native.test_suite(
+        name = name,
+        tags = all_tags,
+    )
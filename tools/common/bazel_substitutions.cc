@@ -17,15 +17,19 @@
 #include <cstdlib>
 #include <filesystem>
 #include <iostream>
-#include <map>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <utility>
 
 #include "tools/common/process.h"
 
 namespace bazel_rules_swift {
 namespace {
 
+// The prefix shared by all of the placeholder strings below.
+static const char kPlaceholderPrefix[] = "__BAZEL_";
+
 // The placeholder string used by Bazel that should be replaced by
 // `DEVELOPER_DIR` at runtime.
 static const char kBazelXcodeDeveloperDir[] = "__BAZEL_XCODE_DEVELOPER_DIR__";
@@ -107,45 +111,88 @@ BazelPlaceholderSubstitutions::BazelPlaceholderSubstitutions() {
   // When targeting Apple platforms, replace the magic Bazel placeholders with
   // the path in the corresponding environment variable. These should be set by
   // the build rules; only attempt to retrieve them if they're actually seen in
-  // the argument list.
-  placeholder_resolvers_ = {
-      {kBazelXcodeDeveloperDir, PlaceholderResolver([]() {
-         return GetAppleEnvironmentVariable("DEVELOPER_DIR");
-       })},
-      {kBazelXcodeSdkRoot, PlaceholderResolver([]() {
-         return GetAppleEnvironmentVariable("SDKROOT");
-       })},
-      {kBazelSwiftToolchainPath,
-       PlaceholderResolver([]() { return GetToolchainPath(); })}};
+  // the argument list. A worker's environment doesn't change between requests,
+  // so the values (one of which requires spawning `xcrun`) are resolved once
+  // for the whole process.
+  static PlaceholderResolver* developer_dir_resolver =
+      new PlaceholderResolver(
+          []() { return GetAppleEnvironmentVariable("DEVELOPER_DIR"); });
+  static PlaceholderResolver* sdk_root_resolver = new PlaceholderResolver(
+      []() { return GetAppleEnvironmentVariable("SDKROOT"); });
+  static PlaceholderResolver* toolchain_path_resolver =
+      new PlaceholderResolver([]() { return GetToolchainPath(); });
+
+  placeholders_ = {
+      {kBazelXcodeDeveloperDir, developer_dir_resolver},
+      {kBazelXcodeSdkRoot, sdk_root_resolver},
+      {kBazelSwiftToolchainPath, toolchain_path_resolver},
+  };
 }
 
-bool BazelPlaceholderSubstitutions::Apply(std::string& arg) {
-  bool changed = false;
+BazelPlaceholderSubstitutions::BazelPlaceholderSubstitutions(
+    const std::string& developer_dir, const std::string& sdk_root) {
+  fixed_resolvers_.push_back(std::make_unique<PlaceholderResolver>(
+      [developer_dir]() { return developer_dir; }));
+  fixed_resolvers_.push_back(std::make_unique<PlaceholderResolver>(
+      [sdk_root]() { return sdk_root; }));
+
+  placeholders_ = {
+      {kBazelXcodeDeveloperDir, fixed_resolvers_[0].get()},
+      {kBazelXcodeSdkRoot, fixed_resolvers_[1].get()},
+  };
+}
 
-  // Replace placeholders in the string with their actual values.
-  for (auto& pair : placeholder_resolvers_) {
-    changed |= FindAndReplace(pair.first, pair.second, arg);
+const BazelPlaceholderSubstitutions::Placeholder*
+BazelPlaceholderSubstitutions::PlaceholderAt(const std::string& arg,
+                                             size_t position) const {
+  for (const Placeholder& placeholder : placeholders_) {
+    if (arg.compare(position, placeholder.name.size(), placeholder.name) ==
+        0) {
+      return &placeholder;
+    }
   }
-
-  return changed;
+  return nullptr;
 }
 
-bool BazelPlaceholderSubstitutions::FindAndReplace(
-    const std::string& placeholder,
-    BazelPlaceholderSubstitutions::PlaceholderResolver& resolver,
-    std::string& str) {
-  int start = 0;
-  bool changed = false;
-  while ((start = str.find(placeholder, start)) != std::string::npos) {
-    std::string resolved_value = resolver.get();
+bool BazelPlaceholderSubstitutions::Apply(std::string& arg) {
+  size_t start = arg.find(kPlaceholderPrefix);
+  if (start == std::string::npos) {
+    return false;
+  }
+
+  std::string result;
+  size_t copied = 0;
+  while (start != std::string::npos) {
+    const Placeholder* placeholder = PlaceholderAt(arg, start);
+    if (placeholder == nullptr) {
+      // The prefix can overlap itself (e.g., `__BAZEL__BAZEL_...`), so only
+      // skip its first character.
+      start = arg.find(kPlaceholderPrefix, start + 1);
+      continue;
+    }
+
+    // An empty value means that the placeholder should be left as is.
+    const std::string& resolved_value = placeholder->resolver->get();
     if (resolved_value.empty()) {
-      return false;
+      start = arg.find(kPlaceholderPrefix, start + placeholder->name.size());
+      continue;
     }
-    changed = true;
-    str.replace(start, placeholder.length(), resolved_value);
-    start += resolved_value.length();
+
+    if (result.empty()) {
+      result.reserve(arg.size() + resolved_value.size());
+    }
+    result.append(arg, copied, start - copied);
+    result.append(resolved_value);
+    copied = start + placeholder->name.size();
+    start = arg.find(kPlaceholderPrefix, copied);
+  }
+
+  if (copied == 0) {
+    return false;
   }
-  return changed;
+  result.append(arg, copied, std::string::npos);
+  arg = std::move(result);
+  return true;
 }
 
 }  // namespace bazel_rules_swift
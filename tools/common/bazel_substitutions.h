@@ -15,9 +15,13 @@
 #ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_BAZEL_SUBSTITUTIONS_H_
 #define BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_BAZEL_SUBSTITUTIONS_H_
 
+#include <cstddef>
 #include <functional>
-#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace bazel_rules_swift {
 
@@ -27,7 +31,8 @@ namespace bazel_rules_swift {
 class BazelPlaceholderSubstitutions {
  public:
   // Initializes the substitutions by looking them up in the process's
-  // environment when they are first requested.
+  // environment when they are first requested. The values are resolved at most
+  // once per process and shared by every instance created this way.
   BazelPlaceholderSubstitutions();
 
   // Initializes the substitutions with the given fixed strings. Intended to be
@@ -37,6 +42,10 @@ class BazelPlaceholderSubstitutions {
 
   // Applies any necessary substitutions to `arg` and returns true if this
   // caused the string to change.
+  //
+  // Every placeholder begins with `__BAZEL_`, so the argument is scanned once
+  // for that prefix alone, and the result is built in the same pass. Arguments
+  // without the prefix, which are nearly all of them, are not modified.
   bool Apply(std::string& arg);
 
  private:
@@ -45,15 +54,12 @@ class BazelPlaceholderSubstitutions {
   class PlaceholderResolver {
    public:
     explicit PlaceholderResolver(std::function<std::string()> fn)
-        : function_(fn), initialized_(false) {}
+        : function_(fn) {}
 
     // Returns the requested placeholder value, caching it for future
     // retrievals.
-    std::string get() {
-      if (!initialized_) {
-        value_ = function_();
-        initialized_ = true;
-      }
+    const std::string& get() {
+      std::call_once(initialized_, [this]() { value_ = function_(); });
       return value_;
     }
 
@@ -64,20 +70,29 @@ class BazelPlaceholderSubstitutions {
 
     // Indicates whether the value of the placeholder has been requested yet and
     // and is therefore initialized.
-    bool initialized_;
+    std::once_flag initialized_;
 
-    // The cached value of the placeholder if `initialized_` is true.
+    // The cached value of the placeholder once `initialized_` is set.
     std::string value_;
   };
 
-  // Finds and replaces all instances of `placeholder` with the value provided
-  // by `resolver`, in-place on `str`. Returns true if the string was changed.
-  bool FindAndReplace(const std::string& placeholder,
-                      PlaceholderResolver& resolver, std::string& str);
+  // A Bazel placeholder string and the resolver that provides its value.
+  struct Placeholder {
+    std::string_view name;
+    PlaceholderResolver* resolver;
+  };
+
+  // Returns the placeholder that occurs in `arg` at `position`, or nullptr if
+  // there is none.
+  const Placeholder* PlaceholderAt(const std::string& arg,
+                                   size_t position) const;
+
+  // The placeholders that are replaced by this instance.
+  std::vector<Placeholder> placeholders_;
 
-  // A mapping from Bazel placeholder strings to resolvers that provide their
-  // values.
-  std::map<std::string, PlaceholderResolver> placeholder_resolvers_;
+  // The resolvers for the fixed values passed to the testing constructor. The
+  // default constructor uses resolvers shared by the whole process instead.
+  std::vector<std::unique_ptr<PlaceholderResolver>> fixed_resolvers_;
 };
 
 }  // namespace bazel_rules_swift
@@ -0,0 +1,118 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures placeholder substitution over the arguments of a large compile,
+// against the placeholder-at-a-time substitution it replaced. Run it with
+//
+//   bazel run -c opt //tools/common:bazel_substitutions_benchmark
+//
+// and optionally the number of arguments and of repetitions.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tools/common/bazel_substitutions.h"
+#include "tools/common/bazel_substitutions_reference.h"
+
+namespace bazel_rules_swift {
+namespace {
+
+constexpr char kDeveloperDir[] = "/Applications/Xcode.app/Contents/Developer";
+constexpr char kSdkRoot[] =
+    "/Applications/Xcode.app/Contents/Developer/Platforms/"
+    "MacOSX.platform/Developer/SDKs/MacOSX.sdk";
+
+// Returns `count` arguments shaped like those of a large module's compile:
+// mostly source files and search paths, with a placeholder in one in twenty.
+std::vector<std::string> MakeArguments(size_t count) {
+  std::vector<std::string> arguments;
+  arguments.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    std::string index = std::to_string(i);
+    switch (i % 20) {
+      case 0:
+        arguments.push_back("-F__BAZEL_XCODE_DEVELOPER_DIR__/Platforms/"
+                            "MacOSX.platform/Developer/Library/Frameworks");
+        break;
+      case 10:
+        arguments.push_back("-I__BAZEL_XCODE_SDKROOT__/usr/include/" + index);
+        break;
+      case 1:
+      case 11:
+        arguments.push_back("-Ibazel-out/darwin_arm64-fastbuild/bin/external/"
+                            "some_repository/Library" +
+                            index);
+        break;
+      default:
+        arguments.push_back("app/Sources/Feature" + index + "/View" + index +
+                            ".swift");
+        break;
+    }
+  }
+  return arguments;
+}
+
+// Runs `substitutions.Apply` over a copy of `arguments` `repetitions` times
+// and returns the average time per argument in nanoseconds.
+template <typename Substitutions>
+double Measure(Substitutions& substitutions,
+               const std::vector<std::string>& arguments, int repetitions) {
+  std::chrono::nanoseconds total(0);
+  size_t changed = 0;
+  for (int i = 0; i < repetitions; ++i) {
+    std::vector<std::string> copy = arguments;
+    auto start = std::chrono::steady_clock::now();
+    for (std::string& argument : copy) {
+      changed += substitutions.Apply(argument);
+    }
+    total += std::chrono::steady_clock::now() - start;
+  }
+  if (changed == 0) {
+    std::cerr << "no arguments were changed\n";
+  }
+  return static_cast<double>(total.count()) /
+         (static_cast<double>(arguments.size()) * repetitions);
+}
+
+}  // namespace
+}  // namespace bazel_rules_swift
+
+int main(int argc, char* argv[]) {
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 30000;
+  int repetitions = argc > 2 ? std::atoi(argv[2]) : 50;
+  if (count == 0 || repetitions <= 0) {
+    std::cerr << "usage: " << argv[0] << " [arguments] [repetitions]\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::string> arguments =
+      bazel_rules_swift::MakeArguments(count);
+  bazel_rules_swift::BazelPlaceholderSubstitutions substitutions(
+      bazel_rules_swift::kDeveloperDir, bazel_rules_swift::kSdkRoot);
+  bazel_rules_swift::testing::ReferenceSubstitutions reference(
+      bazel_rules_swift::kDeveloperDir, bazel_rules_swift::kSdkRoot);
+
+  double single_pass =
+      bazel_rules_swift::Measure(substitutions, arguments, repetitions);
+  double per_placeholder =
+      bazel_rules_swift::Measure(reference, arguments, repetitions);
+  std::cout << count << " arguments, " << repetitions << " repetitions\n"
+            << "  single pass:           " << single_pass << " ns/argument\n"
+            << "  placeholder at a time: " << per_placeholder
+            << " ns/argument\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_BAZEL_SUBSTITUTIONS_REFERENCE_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_BAZEL_SUBSTITUTIONS_REFERENCE_H_
+
+#include <map>
+#include <string>
+
+namespace bazel_rules_swift {
+namespace testing {
+
+// The way `BazelPlaceholderSubstitutions::Apply` used to substitute
+// placeholders, kept so that the test and benchmark can compare against it:
+// each placeholder, in name order, is searched for and replaced across the
+// whole argument in turn, and one whose value is empty is left as is.
+//
+// Unlike the single pass, a value that itself contains a later placeholder
+// would be substituted again, so callers only compare values without one.
+class ReferenceSubstitutions {
+ public:
+  ReferenceSubstitutions(const std::string& developer_dir,
+                         const std::string& sdk_root)
+      : values_({{"__BAZEL_XCODE_DEVELOPER_DIR__", developer_dir},
+                 {"__BAZEL_XCODE_SDKROOT__", sdk_root}}) {}
+
+  bool Apply(std::string& arg) const {
+    bool changed = false;
+    for (const auto& [placeholder, value] : values_) {
+      changed |= FindAndReplace(placeholder, value, arg);
+    }
+    return changed;
+  }
+
+ private:
+  static bool FindAndReplace(const std::string& placeholder,
+                             const std::string& value, std::string& str) {
+    size_t start = 0;
+    bool changed = false;
+    while ((start = str.find(placeholder, start)) != std::string::npos) {
+      if (value.empty()) {
+        return false;
+      }
+      changed = true;
+      str.replace(start, placeholder.length(), value);
+      start += value.length();
+    }
+    return changed;
+  }
+
+  std::map<std::string, std::string> values_;
+};
+
+}  // namespace testing
+}  // namespace bazel_rules_swift
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_BAZEL_SUBSTITUTIONS_REFERENCE_H_
@@ -0,0 +1,115 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests that placeholder substitution gives the same results as the
+// placeholder-at-a-time substitution it replaced.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tools/common/bazel_substitutions.h"
+#include "tools/common/bazel_substitutions_reference.h"
+#include "tools/common/test_support.h"
+
+namespace bazel_rules_swift {
+namespace {
+
+constexpr char kDeveloperDir[] = "/Applications/Xcode.app/Contents/Developer";
+constexpr char kSdkRoot[] = "/SDKs/MacOSX.sdk";
+
+// Arguments covering placeholders alone, repeated, adjacent, overlapping a
+// partial prefix, and next to `__BAZEL_` names that aren't placeholders.
+const std::vector<std::string>& Arguments() {
+  static const std::vector<std::string>* arguments =
+      new std::vector<std::string>({
+          "",
+          "-module-name",
+          "__BAZEL_",
+          "__BAZEL__",
+          "__BAZEL_XCODE_SDKROOT__",
+          "__BAZEL_XCODE_SDKROOT_",
+          "__BAZEL_XCODE_DEVELOPER_DIR__",
+          "-sdk__BAZEL_XCODE_SDKROOT__",
+          "-F__BAZEL_XCODE_DEVELOPER_DIR__/Platforms/MacOSX.platform",
+          "__BAZEL_XCODE_SDKROOT__/usr/lib:__BAZEL_XCODE_SDKROOT__/lib",
+          "__BAZEL_XCODE_SDKROOT____BAZEL_XCODE_DEVELOPER_DIR__",
+          "__BAZEL__BAZEL_XCODE_SDKROOT__",
+          "__BAZEL___BAZEL_XCODE_SDKROOT__",
+          "__BAZEL_XCODE__BAZEL_XCODE_DEVELOPER_DIR__",
+          "__BAZEL_UNKNOWN__",
+          "__BAZEL_UNKNOWN__/__BAZEL_XCODE_SDKROOT__/__BAZEL_UNKNOWN__",
+          "__BAZEL_SWIFT_TOOLCHAIN_PATH__",
+          "__BAZEL_XCODE_SDKROOT__ __BAZEL_SWIFT_TOOLCHAIN_PATH__",
+          "x__BAZEL_XCODE_DEVELOPER_DIR__y__BAZEL_XCODE_SDKROOT__z",
+          "_____BAZEL_XCODE_SDKROOT_____",
+      });
+  return *arguments;
+}
+
+// Checks that both implementations give the same result and report the same
+// change for every argument.
+void CheckMatchesReference(const std::string& developer_dir,
+                           const std::string& sdk_root) {
+  BazelPlaceholderSubstitutions substitutions(developer_dir, sdk_root);
+  testing::ReferenceSubstitutions reference(developer_dir, sdk_root);
+  for (const std::string& argument : Arguments()) {
+    std::string actual = argument;
+    std::string expected = argument;
+    bool actual_changed = substitutions.Apply(actual);
+    bool expected_changed = reference.Apply(expected);
+    if (actual != expected || actual_changed != expected_changed) {
+      std::cerr << "for argument \"" << argument << "\": got \"" << actual
+                << "\" (" << actual_changed << "), expected \"" << expected
+                << "\" (" << expected_changed << ")\n";
+    }
+    CHECK(actual == expected);
+    CHECK(actual_changed == expected_changed);
+    CHECK(actual_changed == (actual != argument));
+  }
+}
+
+void TestMatchesReference() { CheckMatchesReference(kDeveloperDir, kSdkRoot); }
+
+void TestEmptyValuesAreLeftInPlace() {
+  CheckMatchesReference(kDeveloperDir, "");
+  CheckMatchesReference("", kSdkRoot);
+  CheckMatchesReference("", "");
+
+  BazelPlaceholderSubstitutions substitutions(kDeveloperDir, "");
+  std::string argument =
+      "__BAZEL_XCODE_SDKROOT__:__BAZEL_XCODE_DEVELOPER_DIR__";
+  CHECK(substitutions.Apply(argument));
+  CHECK(argument == std::string("__BAZEL_XCODE_SDKROOT__:") + kDeveloperDir);
+}
+
+void TestValuesAreNotSubstitutedAgain() {
+  // A value that looks like a placeholder is copied as is. The reference
+  // would substitute it again, so this case is checked on its own.
+  BazelPlaceholderSubstitutions substitutions("__BAZEL_XCODE_SDKROOT__",
+                                              kSdkRoot);
+  std::string argument = "__BAZEL_XCODE_DEVELOPER_DIR__";
+  CHECK(substitutions.Apply(argument));
+  CHECK(argument == "__BAZEL_XCODE_SDKROOT__");
+}
+
+}  // namespace
+}  // namespace bazel_rules_swift
+
+int main() {
+  bazel_rules_swift::TestMatchesReference();
+  bazel_rules_swift::TestEmptyValuesAreLeftInPlace();
+  bazel_rules_swift::TestValuesAreNotSubstitutedAgain();
+  return bazel_rules_swift::testing::TestExitCode();
+}
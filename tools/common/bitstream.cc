@@ -0,0 +1,609 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/common/bitstream.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace bazel_rules_swift {
+
+namespace {
+
+// The builtin abbreviation IDs defined by the bitstream format.
+constexpr uint64_t kEndBlock = 0;
+constexpr uint64_t kEnterSubblock = 1;
+constexpr uint64_t kDefineAbbrev = 2;
+constexpr uint64_t kUnabbrevRecord = 3;
+
+// The block ID of the BLOCKINFO block and the code of its SETBID record.
+constexpr uint32_t kBlockInfoBlockId = 0;
+constexpr uint32_t kBlockInfoSetBid = 1;
+
+// Guards against runaway recursion on corrupt input.
+constexpr int kMaxBlockDepth = 64;
+
+// Decodes a 6-bit character as defined by the bitstream format.
+char DecodeChar6(uint64_t value) {
+  if (value < 26) return static_cast<char>('a' + value);
+  if (value < 52) return static_cast<char>('A' + value - 26);
+  if (value < 62) return static_cast<char>('0' + value - 52);
+  return value == 62 ? '.' : '_';
+}
+
+class BitstreamReader {
+ public:
+  explicit BitstreamReader(absl::string_view data) : data_(data) {}
+
+  std::optional<Bitstream> Read(std::string* error) {
+    Bitstream result;
+    if (data_.size() < 4) {
+      return Fail(error, "file is too small to be a bitstream");
+    }
+    result.magic = std::string(data_.substr(0, 4));
+    bit_ = 32;
+
+    // Trailing bytes that don't form a full word are padding.
+    size_t end_bit = (data_.size() / 4) * 32;
+    while (bit_ < end_bit) {
+      uint64_t abbrev_id;
+      if (!ReadFixed(2, &abbrev_id)) return Fail(error, error_);
+      if (abbrev_id != kEnterSubblock) {
+        return Fail(error, absl::StrCat("unexpected top-level abbreviation ",
+                                        abbrev_id));
+      }
+      BitstreamBlock block;
+      if (!ReadBlock(block, /*depth=*/0)) return Fail(error, error_);
+      result.blocks.push_back(std::move(block));
+    }
+    return result;
+  }
+
+ private:
+  static std::nullopt_t Fail(std::string* error, const std::string& message) {
+    if (error != nullptr) *error = message;
+    return std::nullopt;
+  }
+
+  bool SetError(std::string message) {
+    if (error_.empty()) error_ = std::move(message);
+    return false;
+  }
+
+  bool ReadFixed(unsigned width, uint64_t* out) {
+    if (width > 64) return SetError("fixed field wider than 64 bits");
+    uint64_t value = 0;
+    unsigned read = 0;
+    while (read < width) {
+      size_t byte = bit_ / 8;
+      if (byte >= data_.size()) return SetError("unexpected end of stream");
+      unsigned offset = bit_ % 8;
+      unsigned take = std::min(8 - offset, width - read);
+      uint64_t bits =
+          (static_cast<uint8_t>(data_[byte]) >> offset) & ((1u << take) - 1);
+      value |= bits << read;
+      read += take;
+      bit_ += take;
+    }
+    *out = value;
+    return true;
+  }
+
+  bool ReadVBR(unsigned width, uint64_t* out) {
+    if (width < 2 || width > 32) return SetError("invalid VBR width");
+    uint64_t continuation = uint64_t{1} << (width - 1);
+    uint64_t result = 0;
+    unsigned shift = 0;
+    while (true) {
+      uint64_t piece;
+      if (!ReadFixed(width, &piece)) return false;
+      if (shift >= 64) return SetError("VBR value overflows 64 bits");
+      result |= (piece & (continuation - 1)) << shift;
+      if ((piece & continuation) == 0) break;
+      shift += width - 1;
+    }
+    *out = result;
+    return true;
+  }
+
+  void AlignTo32() { bit_ = (bit_ + 31) & ~size_t{31}; }
+
+  bool ReadScalar(const BitstreamAbbrevOp& op, uint64_t* out) {
+    switch (op.encoding) {
+      case BitstreamAbbrevOp::Encoding::kLiteral:
+        *out = op.value;
+        return true;
+      case BitstreamAbbrevOp::Encoding::kFixed:
+        return ReadFixed(static_cast<unsigned>(op.value), out);
+      case BitstreamAbbrevOp::Encoding::kVBR:
+        return ReadVBR(static_cast<unsigned>(op.value), out);
+      case BitstreamAbbrevOp::Encoding::kChar6: {
+        uint64_t value;
+        if (!ReadFixed(6, &value)) return false;
+        *out = static_cast<uint8_t>(DecodeChar6(value));
+        return true;
+      }
+      default:
+        return SetError("array or blob used as a scalar operand");
+    }
+  }
+
+  bool ReadAbbrevDefinition(BitstreamAbbrev* abbrev) {
+    uint64_t num_ops;
+    if (!ReadVBR(5, &num_ops)) return false;
+    for (uint64_t i = 0; i < num_ops; ++i) {
+      uint64_t is_literal;
+      if (!ReadFixed(1, &is_literal)) return false;
+      if (is_literal) {
+        uint64_t value;
+        if (!ReadVBR(8, &value)) return false;
+        abbrev->push_back({BitstreamAbbrevOp::Encoding::kLiteral, value});
+        continue;
+      }
+      uint64_t encoding;
+      if (!ReadFixed(3, &encoding)) return false;
+      BitstreamAbbrevOp op{BitstreamAbbrevOp::Encoding::kLiteral, 0};
+      switch (encoding) {
+        case 1:
+          op.encoding = BitstreamAbbrevOp::Encoding::kFixed;
+          if (!ReadVBR(5, &op.value)) return false;
+          break;
+        case 2:
+          op.encoding = BitstreamAbbrevOp::Encoding::kVBR;
+          if (!ReadVBR(5, &op.value)) return false;
+          break;
+        case 3:
+          op.encoding = BitstreamAbbrevOp::Encoding::kArray;
+          break;
+        case 4:
+          op.encoding = BitstreamAbbrevOp::Encoding::kChar6;
+          break;
+        case 5:
+          op.encoding = BitstreamAbbrevOp::Encoding::kBlob;
+          break;
+        default:
+          return SetError(absl::StrCat("unknown abbreviation encoding ",
+                                       encoding));
+      }
+      abbrev->push_back(op);
+    }
+    return true;
+  }
+
+  bool ReadAbbreviatedRecord(const BitstreamAbbrev& abbrev,
+                             BitstreamRecord* record) {
+    if (abbrev.empty()) return SetError("empty abbreviation");
+    uint64_t code;
+    if (!ReadScalar(abbrev[0], &code)) return false;
+    record->code = static_cast<uint32_t>(code);
+
+    for (size_t i = 1; i < abbrev.size(); ++i) {
+      const BitstreamAbbrevOp& op = abbrev[i];
+      if (op.encoding == BitstreamAbbrevOp::Encoding::kArray) {
+        if (i + 2 != abbrev.size()) {
+          return SetError("array operand must be followed by one element");
+        }
+        uint64_t count;
+        if (!ReadVBR(6, &count)) return false;
+        const BitstreamAbbrevOp& element = abbrev[i + 1];
+        for (uint64_t j = 0; j < count; ++j) {
+          uint64_t value;
+          if (!ReadScalar(element, &value)) return false;
+          record->fields.push_back(value);
+        }
+        return true;
+      }
+      if (op.encoding == BitstreamAbbrevOp::Encoding::kBlob) {
+        if (i + 1 != abbrev.size()) {
+          return SetError("blob operand must be the last operand");
+        }
+        uint64_t length;
+        if (!ReadVBR(6, &length)) return false;
+        AlignTo32();
+        size_t start = bit_ / 8;
+        if (length > data_.size() || start > data_.size() - length) {
+          return SetError("blob extends past the end of the stream");
+        }
+        record->blob = std::string(data_.substr(start, length));
+        bit_ += length * 8;
+        AlignTo32();
+        return true;
+      }
+      uint64_t value;
+      if (!ReadScalar(op, &value)) return false;
+      record->fields.push_back(value);
+    }
+    return true;
+  }
+
+  // Reads the header and contents of a block whose ENTER_SUBBLOCK abbreviation
+  // ID has just been consumed.
+  bool ReadBlock(BitstreamBlock& block, int depth) {
+    if (depth > kMaxBlockDepth) return SetError("blocks are nested too deeply");
+
+    uint64_t block_id, abbrev_width, num_words;
+    if (!ReadVBR(8, &block_id) || !ReadVBR(4, &abbrev_width)) return false;
+    AlignTo32();
+    if (!ReadFixed(32, &num_words)) return false;
+    if (abbrev_width == 0 || abbrev_width > 32) {
+      return SetError("invalid abbreviation width");
+    }
+    block.block_id = static_cast<uint32_t>(block_id);
+    block.abbrev_width = static_cast<uint32_t>(abbrev_width);
+
+    // Abbreviations registered through BLOCKINFO come first, followed by any
+    // that are defined locally.
+    std::vector<BitstreamAbbrev> active_abbrevs;
+    if (auto it = block_info_abbrevs_.find(block.block_id);
+        it != block_info_abbrevs_.end()) {
+      active_abbrevs = it->second;
+    }
+    std::optional<uint32_t> block_info_target;
+
+    while (true) {
+      uint64_t abbrev_id;
+      if (!ReadFixed(block.abbrev_width, &abbrev_id)) return false;
+
+      if (abbrev_id == kEndBlock) {
+        AlignTo32();
+        return true;
+      }
+
+      if (abbrev_id == kEnterSubblock) {
+        BitstreamBlock child;
+        if (!ReadBlock(child, depth + 1)) return false;
+        block.entries.push_back(
+            {BitstreamBlock::Entry::Kind::kBlock, block.blocks.size()});
+        block.blocks.push_back(std::move(child));
+        continue;
+      }
+
+      if (abbrev_id == kDefineAbbrev) {
+        BitstreamAbbrev abbrev;
+        if (!ReadAbbrevDefinition(&abbrev)) return false;
+        if (block.block_id == kBlockInfoBlockId) {
+          if (!block_info_target.has_value()) {
+            return SetError("abbreviation in BLOCKINFO before SETBID");
+          }
+          block_info_abbrevs_[*block_info_target].push_back(abbrev);
+        } else {
+          active_abbrevs.push_back(abbrev);
+        }
+        block.entries.push_back(
+            {BitstreamBlock::Entry::Kind::kAbbrev, block.abbrevs.size()});
+        block.abbrevs.push_back(std::move(abbrev));
+        continue;
+      }
+
+      BitstreamRecord record;
+      record.abbrev_id = static_cast<uint32_t>(abbrev_id);
+      if (abbrev_id == kUnabbrevRecord) {
+        uint64_t code, num_ops;
+        if (!ReadVBR(6, &code) || !ReadVBR(6, &num_ops)) return false;
+        record.code = static_cast<uint32_t>(code);
+        for (uint64_t i = 0; i < num_ops; ++i) {
+          uint64_t value;
+          if (!ReadVBR(6, &value)) return false;
+          record.fields.push_back(value);
+        }
+      } else {
+        size_t index = abbrev_id - 4;
+        if (index >= active_abbrevs.size()) {
+          return SetError(absl::StrCat("undefined abbreviation ", abbrev_id));
+        }
+        if (!ReadAbbreviatedRecord(active_abbrevs[index], &record)) {
+          return false;
+        }
+      }
+
+      if (block.block_id == kBlockInfoBlockId &&
+          record.code == kBlockInfoSetBid && !record.fields.empty()) {
+        block_info_target = static_cast<uint32_t>(record.fields[0]);
+      }
+      block.entries.push_back(
+          {BitstreamBlock::Entry::Kind::kRecord, block.records.size()});
+      block.records.push_back(std::move(record));
+    }
+  }
+
+  absl::string_view data_;
+  size_t bit_ = 0;
+  std::map<uint32_t, std::vector<BitstreamAbbrev>> block_info_abbrevs_;
+  std::string error_;
+};
+
+// Encodes a character as a 6-bit value, or returns nullopt if the character
+// can't be represented.
+std::optional<uint64_t> EncodeChar6(uint64_t ch) {
+  if (ch >= 'a' && ch <= 'z') return ch - 'a';
+  if (ch >= 'A' && ch <= 'Z') return ch - 'A' + 26;
+  if (ch >= '0' && ch <= '9') return ch - '0' + 52;
+  if (ch == '.') return 62;
+  if (ch == '_') return 63;
+  return std::nullopt;
+}
+
+class BitstreamWriter {
+ public:
+  std::optional<std::string> Write(const Bitstream& stream,
+                                   std::string* error) {
+    if (stream.magic.size() != 4) {
+      if (error != nullptr) *error = "bitstream magic must be four bytes";
+      return std::nullopt;
+    }
+    out_ = stream.magic;
+    bit_ = 32;
+    for (const BitstreamBlock& block : stream.blocks) {
+      if (!WriteBlock(block, /*outer_abbrev_width=*/2)) {
+        if (error != nullptr) *error = error_;
+        return std::nullopt;
+      }
+    }
+    return std::move(out_);
+  }
+
+ private:
+  bool SetError(std::string message) {
+    if (error_.empty()) error_ = std::move(message);
+    return false;
+  }
+
+  bool WriteFixed(uint64_t value, unsigned width) {
+    if (width < 64 && (value >> width) != 0) {
+      return SetError(absl::StrCat("value ", value, " does not fit in ",
+                                   width, " bits"));
+    }
+    for (unsigned i = 0; i < width; ++i) {
+      size_t byte = bit_ / 8;
+      if (byte >= out_.size()) out_.push_back('\0');
+      if ((value >> i) & 1) {
+        out_[byte] = static_cast<char>(static_cast<uint8_t>(out_[byte]) |
+                                       (1u << (bit_ % 8)));
+      }
+      ++bit_;
+    }
+    return true;
+  }
+
+  bool WriteVBR(uint64_t value, unsigned width) {
+    uint64_t continuation = uint64_t{1} << (width - 1);
+    while (value >= continuation) {
+      if (!WriteFixed((value & (continuation - 1)) | continuation, width)) {
+        return false;
+      }
+      value >>= width - 1;
+    }
+    return WriteFixed(value, width);
+  }
+
+  void AlignTo32() {
+    bit_ = (bit_ + 31) & ~size_t{31};
+    out_.resize(bit_ / 8, '\0');
+  }
+
+  bool WriteScalar(const BitstreamAbbrevOp& op, uint64_t value) {
+    switch (op.encoding) {
+      case BitstreamAbbrevOp::Encoding::kLiteral:
+        if (value != op.value) {
+          return SetError("field does not match its literal operand");
+        }
+        return true;
+      case BitstreamAbbrevOp::Encoding::kFixed:
+        return WriteFixed(value, static_cast<unsigned>(op.value));
+      case BitstreamAbbrevOp::Encoding::kVBR:
+        return WriteVBR(value, static_cast<unsigned>(op.value));
+      case BitstreamAbbrevOp::Encoding::kChar6: {
+        std::optional<uint64_t> encoded = EncodeChar6(value);
+        if (!encoded.has_value()) {
+          return SetError("character cannot be encoded as char6");
+        }
+        return WriteFixed(*encoded, 6);
+      }
+      default:
+        return SetError("array or blob used as a scalar operand");
+    }
+  }
+
+  bool WriteAbbrevDefinition(const BitstreamAbbrev& abbrev) {
+    if (!WriteVBR(abbrev.size(), 5)) return false;
+    for (const BitstreamAbbrevOp& op : abbrev) {
+      bool is_literal = op.encoding == BitstreamAbbrevOp::Encoding::kLiteral;
+      if (!WriteFixed(is_literal ? 1 : 0, 1)) return false;
+      if (is_literal) {
+        if (!WriteVBR(op.value, 8)) return false;
+        continue;
+      }
+      switch (op.encoding) {
+        case BitstreamAbbrevOp::Encoding::kFixed:
+          if (!WriteFixed(1, 3) || !WriteVBR(op.value, 5)) return false;
+          break;
+        case BitstreamAbbrevOp::Encoding::kVBR:
+          if (!WriteFixed(2, 3) || !WriteVBR(op.value, 5)) return false;
+          break;
+        case BitstreamAbbrevOp::Encoding::kArray:
+          if (!WriteFixed(3, 3)) return false;
+          break;
+        case BitstreamAbbrevOp::Encoding::kChar6:
+          if (!WriteFixed(4, 3)) return false;
+          break;
+        case BitstreamAbbrevOp::Encoding::kBlob:
+          if (!WriteFixed(5, 3)) return false;
+          break;
+        default:
+          break;
+      }
+    }
+    return true;
+  }
+
+  bool WriteAbbreviatedRecord(const BitstreamAbbrev& abbrev,
+                              const BitstreamRecord& record) {
+    if (abbrev.empty()) return SetError("empty abbreviation");
+    if (!WriteScalar(abbrev[0], record.code)) return false;
+
+    size_t field = 0;
+    for (size_t i = 1; i < abbrev.size(); ++i) {
+      const BitstreamAbbrevOp& op = abbrev[i];
+      if (op.encoding == BitstreamAbbrevOp::Encoding::kArray) {
+        if (i + 2 != abbrev.size()) {
+          return SetError("array operand must be followed by one element");
+        }
+        if (!WriteVBR(record.fields.size() - field, 6)) return false;
+        for (; field < record.fields.size(); ++field) {
+          if (!WriteScalar(abbrev[i + 1], record.fields[field])) return false;
+        }
+        return true;
+      }
+      if (op.encoding == BitstreamAbbrevOp::Encoding::kBlob) {
+        const std::string& blob = record.blob.value_or("");
+        if (!WriteVBR(blob.size(), 6)) return false;
+        AlignTo32();
+        out_.append(blob);
+        bit_ += blob.size() * 8;
+        AlignTo32();
+        return field == record.fields.size() ||
+               SetError("record has more fields than its abbreviation");
+      }
+      if (field >= record.fields.size()) {
+        return SetError("record has fewer fields than its abbreviation");
+      }
+      if (!WriteScalar(op, record.fields[field++])) return false;
+    }
+    return field == record.fields.size() ||
+           SetError("record has more fields than its abbreviation");
+  }
+
+  bool WriteBlock(const BitstreamBlock& block, unsigned outer_abbrev_width) {
+    if (!WriteFixed(kEnterSubblock, outer_abbrev_width) ||
+        !WriteVBR(block.block_id, 8) || !WriteVBR(block.abbrev_width, 4)) {
+      return false;
+    }
+    AlignTo32();
+    size_t length_word = out_.size();
+    if (!WriteFixed(0, 32)) return false;
+
+    std::vector<BitstreamAbbrev> active_abbrevs;
+    if (auto it = block_info_abbrevs_.find(block.block_id);
+        it != block_info_abbrevs_.end()) {
+      active_abbrevs = it->second;
+    }
+    std::optional<uint32_t> block_info_target;
+
+    for (const BitstreamBlock::Entry& entry : block.entries) {
+      switch (entry.kind) {
+        case BitstreamBlock::Entry::Kind::kBlock:
+          if (!WriteBlock(block.blocks[entry.index], block.abbrev_width)) {
+            return false;
+          }
+          break;
+        case BitstreamBlock::Entry::Kind::kAbbrev: {
+          const BitstreamAbbrev& abbrev = block.abbrevs[entry.index];
+          if (!WriteFixed(kDefineAbbrev, block.abbrev_width) ||
+              !WriteAbbrevDefinition(abbrev)) {
+            return false;
+          }
+          if (block.block_id == kBlockInfoBlockId) {
+            if (!block_info_target.has_value()) {
+              return SetError("abbreviation in BLOCKINFO before SETBID");
+            }
+            block_info_abbrevs_[*block_info_target].push_back(abbrev);
+          } else {
+            active_abbrevs.push_back(abbrev);
+          }
+          break;
+        }
+        case BitstreamBlock::Entry::Kind::kRecord: {
+          const BitstreamRecord& record = block.records[entry.index];
+          if (!WriteFixed(record.abbrev_id, block.abbrev_width)) return false;
+          if (record.abbrev_id == kUnabbrevRecord) {
+            if (!WriteVBR(record.code, 6) ||
+                !WriteVBR(record.fields.size(), 6)) {
+              return false;
+            }
+            for (uint64_t value : record.fields) {
+              if (!WriteVBR(value, 6)) return false;
+            }
+          } else {
+            size_t index = record.abbrev_id - 4;
+            if (record.abbrev_id < 4 || index >= active_abbrevs.size()) {
+              return SetError(
+                  absl::StrCat("undefined abbreviation ", record.abbrev_id));
+            }
+            if (!WriteAbbreviatedRecord(active_abbrevs[index], record)) {
+              return false;
+            }
+          }
+          if (block.block_id == kBlockInfoBlockId &&
+              record.code == kBlockInfoSetBid && !record.fields.empty()) {
+            block_info_target = static_cast<uint32_t>(record.fields[0]);
+          }
+          break;
+        }
+      }
+    }
+
+    if (!WriteFixed(kEndBlock, block.abbrev_width)) return false;
+    AlignTo32();
+
+    // Backpatch the length of the block in 32-bit words, not counting the
+    // length word itself.
+    uint32_t num_words =
+        static_cast<uint32_t>((out_.size() - length_word - 4) / 4);
+    for (int i = 0; i < 4; ++i) {
+      out_[length_word + i] = static_cast<char>((num_words >> (8 * i)) & 0xff);
+    }
+    return true;
+  }
+
+  std::string out_;
+  size_t bit_ = 0;
+  std::map<uint32_t, std::vector<BitstreamAbbrev>> block_info_abbrevs_;
+  std::string error_;
+};
+
+}  // namespace
+
+const BitstreamBlock* BitstreamBlock::FindBlock(uint32_t id) const {
+  for (const BitstreamBlock& block : blocks) {
+    if (block.block_id == id) return &block;
+  }
+  return nullptr;
+}
+
+const BitstreamBlock* Bitstream::FindBlock(uint32_t id) const {
+  for (const BitstreamBlock& block : blocks) {
+    if (block.block_id == id) return &block;
+  }
+  return nullptr;
+}
+
+std::optional<Bitstream> ParseBitstream(absl::string_view data,
+                                        std::string* error) {
+  return BitstreamReader(data).Read(error);
+}
+
+std::optional<std::string> WriteBitstream(const Bitstream& stream,
+                                          std::string* error) {
+  return BitstreamWriter().Write(stream, error);
+}
+
+}  // namespace bazel_rules_swift
@@ -0,0 +1,132 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_BITSTREAM_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_BITSTREAM_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace bazel_rules_swift {
+
+// A single operand of an abbreviation definition in an LLVM bitstream.
+//
+// See https://llvm.org/docs/BitCodeFormat.html#abbreviations for the meaning
+// of each encoding.
+struct BitstreamAbbrevOp {
+  enum class Encoding {
+    kLiteral,
+    kFixed,
+    kVBR,
+    kArray,
+    kChar6,
+    kBlob,
+  };
+
+  Encoding encoding;
+
+  // The literal value for `kLiteral`, or the bit width for `kFixed`/`kVBR`.
+  uint64_t value;
+};
+
+// An abbreviation definition: the list of operands that describe how the
+// fields of an abbreviated record are encoded.
+using BitstreamAbbrev = std::vector<BitstreamAbbrevOp>;
+
+// A data record read from a bitstream.
+struct BitstreamRecord {
+  // The abbreviation ID that the record was encoded with (3 for unabbreviated
+  // records).
+  uint32_t abbrev_id;
+
+  // The record code.
+  uint32_t code;
+
+  // The record's scalar fields, not including the code. Array elements are
+  // flattened into this list, as LLVM does.
+  std::vector<uint64_t> fields;
+
+  // The record's blob operand, if its abbreviation has one.
+  std::optional<std::string> blob;
+};
+
+// A block read from a bitstream, preserving the order of its contents so that
+// it can be re-emitted faithfully.
+struct BitstreamBlock {
+  // Identifies one item in a block's contents.
+  struct Entry {
+    enum class Kind {
+      kRecord,
+      kBlock,
+      kAbbrev,
+    };
+
+    Kind kind;
+
+    // The index into `records`, `blocks`, or `abbrevs` for this entry.
+    size_t index;
+  };
+
+  // The block ID (0 for the BLOCKINFO block).
+  uint32_t block_id = 0;
+
+  // The abbreviation ID width used inside the block.
+  uint32_t abbrev_width = 2;
+
+  std::vector<Entry> entries;
+  std::vector<BitstreamRecord> records;
+  std::vector<BitstreamBlock> blocks;
+
+  // Abbreviations defined locally in this block (`DEFINE_ABBREV` entries).
+  std::vector<BitstreamAbbrev> abbrevs;
+
+  // Returns the first nested block with the given ID, or nullptr if there is
+  // none.
+  const BitstreamBlock* FindBlock(uint32_t id) const;
+};
+
+// The parsed contents of a bitstream file.
+struct Bitstream {
+  // The four-byte magic number at the start of the file.
+  std::string magic;
+
+  // The top-level blocks, in file order. The BLOCKINFO block, if present, is
+  // included here so that the stream can be re-emitted.
+  std::vector<BitstreamBlock> blocks;
+
+  // Returns the first top-level block with the given ID, or nullptr if there
+  // is none.
+  const BitstreamBlock* FindBlock(uint32_t id) const;
+};
+
+// Parses an LLVM bitstream container (the format shared by bitcode files,
+// serialized AST files, and index store units and records). Returns nullopt
+// and populates `error` (if non-null) if the data is malformed.
+std::optional<Bitstream> ParseBitstream(absl::string_view data,
+                                        std::string* error = nullptr);
+
+// Serializes a bitstream using the same abbreviations that it was read with,
+// so that a parsed stream whose field values have been edited can be written
+// back out in a form its original reader understands. Returns nullopt and
+// populates `error` (if non-null) if a field no longer fits its encoding.
+std::optional<std::string> WriteBitstream(const Bitstream& stream,
+                                          std::string* error = nullptr);
+
+}  // namespace bazel_rules_swift
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_BITSTREAM_H_
@@ -0,0 +1,173 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/common/directory_reaper.h"
+
+#if !defined(_WIN32)
+#include <signal.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+namespace bazel_rules_swift {
+
+namespace {
+
+// The suffix of a directory that is waiting to be deleted.
+constexpr char kTombstoneSuffix[] = ".tombstone";
+
+// The most directories that may be waiting to be deleted. Past this, the
+// worker is producing directories faster than the reaper can delete them, so
+// callers delete their own until it catches up, rather than letting an
+// unbounded amount of disk space pile up behind the reaper.
+constexpr size_t kMaxPending = 4;
+
+#if !defined(_WIN32)
+// Returns the name of the tombstone for `path`, owned by process `pid`.
+std::string TombstonePath(const std::string& path, pid_t pid) {
+  return path + "." + std::to_string(pid) + kTombstoneSuffix;
+}
+
+// Returns true if `name` is a tombstone whose owning process has exited.
+bool IsAbandonedTombstone(const std::string& name) {
+  if (name.size() < sizeof(kTombstoneSuffix)) {
+    return false;
+  }
+  size_t suffix = name.size() - (sizeof(kTombstoneSuffix) - 1);
+  if (name.compare(suffix, std::string::npos, kTombstoneSuffix) != 0) {
+    return false;
+  }
+  size_t dot = name.rfind('.', suffix - 1);
+  if (dot == std::string::npos) {
+    return false;
+  }
+  char* end;
+  long pid = std::strtol(name.c_str() + dot + 1, &end, 10);
+  if (end != name.c_str() + suffix || pid <= 0 || pid == getpid()) {
+    return false;
+  }
+  return kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH;
+}
+
+// Lowers the priority of the calling thread, for both CPU and I/O where the
+// platform allows it, so that deleting files doesn't compete with compiles.
+void LowerCurrentThreadPriority() {
+#if defined(__linux__)
+  // On Linux, the nice value and I/O priority of a thread can be set on its
+  // own by its thread ID.
+  pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+  setpriority(PRIO_PROCESS, tid, 19);
+  // IOPRIO_WHO_PROCESS, and IOPRIO_CLASS_IDLE in the class bits.
+  syscall(SYS_ioprio_set, 1, tid, 3 << 13);
+#elif defined(__APPLE__)
+  setpriority(PRIO_DARWIN_THREAD, 0, PRIO_DARWIN_BG);
+#endif
+}
+#endif
+
+}  // namespace
+
+DirectoryReaper& DirectoryReaper::Shared() {
+  static DirectoryReaper* reaper = new DirectoryReaper();
+  return *reaper;
+}
+
+void DirectoryReaper::Start() {
+#if !defined(_WIN32)
+  // Directories that still have open handles can't be renamed on Windows, so
+  // they are always deleted in place there.
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (started_) {
+    return;
+  }
+  started_ = true;
+  std::thread([this]() { Run(); }).detach();
+#endif
+}
+
+bool DirectoryReaper::Reap(const std::string& path) {
+#if defined(_WIN32)
+  return false;
+#else
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!started_ || pending_.size() >= kMaxPending) {
+    return false;
+  }
+
+  std::string tombstone = TombstonePath(path, getpid());
+  std::error_code ec;
+  std::filesystem::rename(path, tombstone, ec);
+  if (ec) {
+    return false;
+  }
+  pending_.push_back(tombstone);
+
+  // Pick up anything left behind in the same place by workers that exited
+  // before their reapers finished. Each one is renamed first, so that only one
+  // live reaper claims it.
+  std::string parent = std::filesystem::path(path).parent_path().string();
+  if (swept_parents_.insert(parent).second) {
+    for (const auto& entry :
+         std::filesystem::directory_iterator(parent, ec)) {
+      std::string name = entry.path().filename().string();
+      if (!IsAbandonedTombstone(name)) {
+        continue;
+      }
+      std::string claimed = TombstonePath(entry.path().string(), getpid());
+      std::error_code rename_ec;
+      std::filesystem::rename(entry.path(), claimed, rename_ec);
+      if (!rename_ec) {
+        pending_.push_back(claimed);
+      }
+    }
+  }
+
+  pending_changed_.notify_one();
+  return true;
+#endif
+}
+
+void DirectoryReaper::Run() {
+#if !defined(_WIN32)
+  LowerCurrentThreadPriority();
+  while (true) {
+    std::string tombstone;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      pending_changed_.wait(lock, [this]() { return !pending_.empty(); });
+      tombstone = pending_.front();
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(tombstone, ec);
+
+    // The tombstone stays counted against the limit until it is gone.
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.pop_front();
+  }
+#endif
+}
+
+}  // namespace bazel_rules_swift
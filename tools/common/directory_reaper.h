@@ -0,0 +1,74 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_DIRECTORY_REAPER_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_DIRECTORY_REAPER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace bazel_rules_swift {
+
+// Deletes temporary directories on a low-priority background thread, so that a
+// persistent worker doesn't spend the time to recursively delete something
+// like an ephemeral module cache before it sends its response.
+//
+// A directory handed to the reaper is first renamed to a tombstone next to it,
+// which is atomic, so its original path can be reused immediately. Tombstones
+// are named after the process that created them; ones left behind by a worker
+// that has exited are deleted along with the first directory reaped from the
+// same parent.
+class DirectoryReaper {
+ public:
+  // Returns the reaper shared by the whole process.
+  static DirectoryReaper& Shared();
+
+  DirectoryReaper(const DirectoryReaper&) = delete;
+  DirectoryReaper& operator=(const DirectoryReaper&) = delete;
+
+  // Starts the background thread. Until this is called, `Reap` always declines,
+  // so processes that exit after a single compile still delete their
+  // directories before exiting.
+  void Start();
+
+  // Renames the directory at `path` to a tombstone and schedules it for
+  // deletion. Returns false, leaving the directory in place for the caller to
+  // delete itself, if the reaper hasn't been started, if too many directories
+  // are already waiting to be deleted, or if the directory can't be renamed.
+  bool Reap(const std::string& path);
+
+ private:
+  DirectoryReaper() = default;
+
+  // Deletes tombstones until the process exits.
+  void Run();
+
+  std::mutex mutex_;
+  std::condition_variable pending_changed_;
+  bool started_ = false;
+
+  // The tombstones that have yet to be deleted.
+  std::deque<std::string> pending_;
+
+  // The parent directories that have already been checked for tombstones left
+  // behind by other processes.
+  std::set<std::string> swept_parents_;
+};
+
+}  // namespace bazel_rules_swift
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_DIRECTORY_REAPER_H_
@@ -0,0 +1,174 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/common/file_digest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+
+#include "absl/strings/string_view.h"
+#include "tools/common/file_system.h"
+
+namespace bazel_rules_swift {
+
+namespace {
+
+// The primes and round structure below follow the reference XXH64
+// specification: https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+uint64_t RotateLeft(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+// Reads little-endian integers regardless of the host's byte order.
+uint64_t Read64(const char* data) {
+  const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; --i) {
+    value = (value << 8) | bytes[i];
+  }
+  return value;
+}
+
+uint32_t Read32(const char* data) {
+  const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+  return static_cast<uint32_t>(bytes[0]) |
+         (static_cast<uint32_t>(bytes[1]) << 8) |
+         (static_cast<uint32_t>(bytes[2]) << 16) |
+         (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+uint64_t Round(uint64_t accumulator, uint64_t lane) {
+  accumulator += lane * kPrime2;
+  accumulator = RotateLeft(accumulator, 31);
+  return accumulator * kPrime1;
+}
+
+uint64_t MergeAccumulator(uint64_t hash, uint64_t accumulator) {
+  hash ^= Round(0, accumulator);
+  return hash * kPrime1 + kPrime4;
+}
+
+}  // namespace
+
+XXH64Hasher::XXH64Hasher(uint64_t seed) : seed_(seed) {
+  accumulators_[0] = seed + kPrime1 + kPrime2;
+  accumulators_[1] = seed + kPrime2;
+  accumulators_[2] = seed;
+  accumulators_[3] = seed - kPrime1;
+}
+
+void XXH64Hasher::Update(absl::string_view data) {
+  total_length_ += data.size();
+
+  if (buffer_size_ > 0) {
+    size_t needed = sizeof(buffer_) - buffer_size_;
+    if (data.size() < needed) {
+      memcpy(buffer_ + buffer_size_, data.data(), data.size());
+      buffer_size_ += data.size();
+      return;
+    }
+    memcpy(buffer_ + buffer_size_, data.data(), needed);
+    for (int i = 0; i < 4; ++i) {
+      accumulators_[i] = Round(accumulators_[i], Read64(buffer_ + i * 8));
+    }
+    data.remove_prefix(needed);
+    buffer_size_ = 0;
+  }
+
+  while (data.size() >= sizeof(buffer_)) {
+    for (int i = 0; i < 4; ++i) {
+      accumulators_[i] = Round(accumulators_[i], Read64(data.data() + i * 8));
+    }
+    data.remove_prefix(sizeof(buffer_));
+  }
+
+  memcpy(buffer_, data.data(), data.size());
+  buffer_size_ = data.size();
+}
+
+uint64_t XXH64Hasher::Digest() const {
+  uint64_t hash;
+  if (total_length_ >= sizeof(buffer_)) {
+    hash = RotateLeft(accumulators_[0], 1) + RotateLeft(accumulators_[1], 7) +
+           RotateLeft(accumulators_[2], 12) + RotateLeft(accumulators_[3], 18);
+    for (uint64_t accumulator : accumulators_) {
+      hash = MergeAccumulator(hash, accumulator);
+    }
+  } else {
+    hash = seed_ + kPrime5;
+  }
+  hash += total_length_;
+
+  const char* remaining = buffer_;
+  size_t length = buffer_size_;
+  while (length >= 8) {
+    hash ^= Round(0, Read64(remaining));
+    hash = RotateLeft(hash, 27) * kPrime1 + kPrime4;
+    remaining += 8;
+    length -= 8;
+  }
+  if (length >= 4) {
+    hash ^= static_cast<uint64_t>(Read32(remaining)) * kPrime1;
+    hash = RotateLeft(hash, 23) * kPrime2 + kPrime3;
+    remaining += 4;
+    length -= 4;
+  }
+  while (length > 0) {
+    hash ^= static_cast<unsigned char>(*remaining) * kPrime5;
+    hash = RotateLeft(hash, 11) * kPrime1;
+    ++remaining;
+    --length;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+uint64_t XXH64Digest(absl::string_view data, uint64_t seed) {
+  XXH64Hasher hasher(seed);
+  hasher.Update(data);
+  return hasher.Digest();
+}
+
+std::optional<uint64_t> DigestFile(const std::filesystem::path& path) {
+  std::ifstream stream(LongPath(path), std::ios::binary);
+  if (!stream.good()) {
+    return std::nullopt;
+  }
+  XXH64Hasher hasher;
+  char buffer[64 * 1024];
+  while (stream) {
+    stream.read(buffer, sizeof(buffer));
+    hasher.Update(absl::string_view(buffer, stream.gcount()));
+  }
+  if (stream.bad()) {
+    return std::nullopt;
+  }
+  return hasher.Digest();
+}
+
+}  // namespace bazel_rules_swift
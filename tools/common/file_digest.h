@@ -0,0 +1,60 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_FILE_DIGEST_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_FILE_DIGEST_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+#include "absl/strings/string_view.h"
+
+namespace bazel_rules_swift {
+
+// Computes the 64-bit xxHash (XXH64) of data that is supplied incrementally.
+//
+// XXH64 is not a cryptographic hash; it is used to tell whether two files on
+// the same machine have the same contents without comparing them byte by
+// byte.
+class XXH64Hasher {
+ public:
+  explicit XXH64Hasher(uint64_t seed = 0);
+
+  // Adds `data` to the hashed contents.
+  void Update(absl::string_view data);
+
+  // Returns the digest of everything added so far.
+  uint64_t Digest() const;
+
+ private:
+  uint64_t seed_;
+  uint64_t accumulators_[4];
+  uint64_t total_length_ = 0;
+
+  // Input that doesn't yet fill a 32-byte stripe.
+  char buffer_[32];
+  size_t buffer_size_ = 0;
+};
+
+// Returns the XXH64 digest of `data`.
+uint64_t XXH64Digest(absl::string_view data, uint64_t seed = 0);
+
+// Returns the XXH64 digest of the contents of the file at `path`, or nullopt if
+// the file could not be read.
+std::optional<uint64_t> DigestFile(const std::filesystem::path& path);
+
+}  // namespace bazel_rules_swift
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_FILE_DIGEST_H_
@@ -0,0 +1,433 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/common/file_operation_batch.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define RULES_SWIFT_HAVE_IO_URING 1
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "tools/common/file_system.h"
+#include "tools/common/file_transfer.h"
+#include "tools/common/thread_pool.h"
+
+namespace bazel_rules_swift {
+
+namespace {
+
+#if defined(RULES_SWIFT_HAVE_IO_URING)
+
+// io_uring ABI values that are spelled differently (or missing) across
+// versions of the kernel headers, so they are defined here by value.
+constexpr uint8_t kOpStatx = 21;
+constexpr uint8_t kOpUnlinkAt = 36;
+constexpr unsigned kRegisterProbe = 8;
+constexpr uint16_t kOpSupported = 1;
+constexpr unsigned kStatxType = 0x1;
+
+// The size of `struct statx`, which is only written to and never read.
+constexpr size_t kStatxSize = 256;
+
+// A single path-based request submitted to the ring.
+struct RingRequest {
+  uint8_t opcode;
+  std::string path;
+
+  // Whether the operation ran, and if so, its result: zero on success or a
+  // negated errno value.
+  bool completed = false;
+  int result = 0;
+};
+
+// A minimal io_uring submission/completion ring, driven with raw system calls
+// so that liburing isn't needed. It is only used for `statx` and `unlinkat`,
+// which are the operations a batch has the most of and which would otherwise
+// each cost a thread hand-off.
+class IoUring {
+ public:
+  // Returns the process-wide ring, or nullptr if the kernel doesn't support
+  // io_uring or the operations we need (or it has been disabled).
+  static IoUring* Shared() {
+    static IoUring* ring = Create(/*entries=*/64).release();
+    return ring;
+  }
+
+  ~IoUring() {
+    if (sqes_ != nullptr) munmap(sqes_, sqes_size_);
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr) munmap(sq_ring_, sq_ring_size_);
+    if (fd_ >= 0) close(fd_);
+  }
+
+  // Executes the given requests, filling in their results. Returns false if
+  // the ring failed part of the way through, in which case the requests that
+  // aren't marked completed must be executed some other way. A ring that has
+  // failed isn't used again.
+  bool Execute(std::vector<RingRequest>& requests);
+
+ private:
+  IoUring() = default;
+
+  static std::unique_ptr<IoUring> Create(unsigned entries);
+
+  // Returns true if the kernel supports the given opcode.
+  bool Supports(uint8_t opcode) const;
+
+  int fd_ = -1;
+  io_uring_params params_ = {};
+  void* sq_ring_ = nullptr;
+  void* cq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  std::vector<uint8_t> supported_ops_;
+  std::mutex mutex_;
+
+  // The paths and `statx` results of the requests in the current chunk. They
+  // belong to the ring rather than to the caller, so that requests left in
+  // flight when the ring fails can't write to memory that has been freed.
+  std::vector<std::string> paths_;
+  std::unique_ptr<char[]> statx_buffers_;
+
+  bool failed_ = false;
+};
+
+template <typename T>
+T* RingField(void* ring, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+std::unique_ptr<IoUring> IoUring::Create(unsigned entries) {
+  std::unique_ptr<IoUring> ring(new IoUring());
+  ring->fd_ = syscall(__NR_io_uring_setup, entries, &ring->params_);
+  if (ring->fd_ < 0) {
+    return nullptr;
+  }
+
+  const io_uring_params& params = ring->params_;
+  ring->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(__u32);
+  ring->cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    ring->sq_ring_size_ = ring->cq_ring_size_ =
+        std::max(ring->sq_ring_size_, ring->cq_ring_size_);
+  }
+
+  void* sq_ring =
+      mmap(nullptr, ring->sq_ring_size_, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, ring->fd_, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) {
+    return nullptr;
+  }
+  ring->sq_ring_ = sq_ring;
+
+  if (single_mmap) {
+    ring->cq_ring_ = sq_ring;
+  } else {
+    void* cq_ring =
+        mmap(nullptr, ring->cq_ring_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring->fd_, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) {
+      return nullptr;
+    }
+    ring->cq_ring_ = cq_ring;
+  }
+
+  ring->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, ring->sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return nullptr;
+  }
+  ring->sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  // Ask the kernel which operations it supports; `statx` and `unlinkat` were
+  // added in different releases.
+  constexpr unsigned kProbeOps = 256;
+  std::vector<char> probe_buffer(sizeof(io_uring_probe) +
+                                 kProbeOps * sizeof(io_uring_probe_op));
+  auto* probe = reinterpret_cast<io_uring_probe*>(probe_buffer.data());
+  if (syscall(__NR_io_uring_register, ring->fd_, kRegisterProbe, probe,
+              kProbeOps) < 0) {
+    return nullptr;
+  }
+  ring->supported_ops_.assign(kProbeOps, 0);
+  for (unsigned i = 0; i < probe->ops_len && i < kProbeOps; ++i) {
+    if (probe->ops[i].flags & kOpSupported) {
+      ring->supported_ops_[probe->ops[i].op] = 1;
+    }
+  }
+  if (!ring->Supports(kOpStatx) || !ring->Supports(kOpUnlinkAt)) {
+    return nullptr;
+  }
+
+  ring->paths_.resize(params.sq_entries);
+  ring->statx_buffers_.reset(new char[params.sq_entries * kStatxSize]);
+  return ring;
+}
+
+bool IoUring::Supports(uint8_t opcode) const {
+  return opcode < supported_ops_.size() && supported_ops_[opcode] != 0;
+}
+
+bool IoUring::Execute(std::vector<RingRequest>& requests) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (failed_) {
+    return false;
+  }
+
+  auto* sq_tail = RingField<__u32>(sq_ring_, params_.sq_off.tail);
+  __u32 sq_mask = *RingField<__u32>(sq_ring_, params_.sq_off.ring_mask);
+  auto* sq_array = RingField<__u32>(sq_ring_, params_.sq_off.array);
+  auto* cq_head = RingField<__u32>(cq_ring_, params_.cq_off.head);
+  auto* cq_tail = RingField<__u32>(cq_ring_, params_.cq_off.tail);
+  __u32 cq_mask = *RingField<__u32>(cq_ring_, params_.cq_off.ring_mask);
+  auto* cqes = RingField<io_uring_cqe>(cq_ring_, params_.cq_off.cqes);
+
+  for (size_t start = 0; start < requests.size();
+       start += params_.sq_entries) {
+    size_t count =
+        std::min<size_t>(params_.sq_entries, requests.size() - start);
+
+    __u32 tail = *sq_tail;
+    for (size_t i = 0; i < count; ++i) {
+      RingRequest& request = requests[start + i];
+      paths_[i] = request.path;
+      __u32 index = tail & sq_mask;
+      io_uring_sqe* sqe = &sqes_[index];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = request.opcode;
+      sqe->fd = AT_FDCWD;
+      sqe->addr = reinterpret_cast<uintptr_t>(paths_[i].c_str());
+      if (request.opcode == kOpStatx) {
+        sqe->len = kStatxType;
+        sqe->off =
+            reinterpret_cast<uintptr_t>(statx_buffers_.get() + i * kStatxSize);
+      }
+      sqe->user_data = start + i;
+      sq_array[index] = index;
+      ++tail;
+    }
+    __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+    size_t to_submit = count;
+    size_t completed = 0;
+    bool retrying = false;
+    while (completed < count) {
+      int submitted = syscall(__NR_io_uring_enter, fd_, to_submit,
+                              count - completed, IORING_ENTER_GETEVENTS,
+                              nullptr, 0);
+      bool progressed = submitted > 0;
+      if (submitted > 0) {
+        to_submit -= std::min<size_t>(to_submit, submitted);
+      }
+
+      __u32 head = *cq_head;
+      __u32 available = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+      while (head != available) {
+        const io_uring_cqe& cqe = cqes[head & cq_mask];
+        RingRequest& request = requests[cqe.user_data];
+        request.result = cqe.res;
+        request.completed = true;
+        progressed = true;
+        ++completed;
+        ++head;
+      }
+      __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+      if (progressed || (submitted < 0 && errno == EINTR)) {
+        retrying = false;
+        continue;
+      }
+      // A full completion queue or a momentary shortage of kernel resources
+      // can clear once completions are reaped, so try once more; a call that
+      // fails again without any progress means the ring can't be relied on.
+      if (!retrying) {
+        retrying = true;
+        continue;
+      }
+
+      // Take back the requests the kernel hasn't consumed and leave the rest
+      // of the work to the caller. Requests already in flight only refer to
+      // the ring's own buffers, which are never reused once it has failed.
+      __atomic_store_n(sq_tail, tail - to_submit, __ATOMIC_RELEASE);
+      failed_ = true;
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif
+
+}  // namespace
+
+void FileOperationBatch::CreateDirectories(const std::filesystem::path& path) {
+  Add(
+      [path](std::error_code& ec) {
+        std::filesystem::create_directories(LongPath(path), ec);
+        return !ec;
+      },
+      "create directory " + path.string());
+}
+
+void FileOperationBatch::Exists(const std::filesystem::path& path,
+                                bool* exists) {
+  Operation operation;
+  operation.kind = Operation::Kind::kExists;
+  operation.path = path;
+  operation.exists = exists;
+  operation.run = [path, exists](std::error_code& ec) {
+    *exists = std::filesystem::exists(LongPath(path), ec);
+    ec.clear();
+    return true;
+  };
+  operations_.push_back(std::move(operation));
+}
+
+void FileOperationBatch::Remove(const std::filesystem::path& path) {
+  Operation operation;
+  operation.kind = Operation::Kind::kRemove;
+  operation.path = path;
+  operation.run = [path](std::error_code& ec) {
+    std::filesystem::remove(LongPath(path), ec);
+    return !ec;
+  };
+  operation.description = "remove " + path.string();
+  operations_.push_back(std::move(operation));
+}
+
+void FileOperationBatch::Transfer(const std::filesystem::path& from,
+                                  const std::filesystem::path& to,
+                                  bool allow_hard_link) {
+  FileTransferStats* stats = stats_;
+  Add(
+      [from, to, allow_hard_link, stats](std::error_code& ec) {
+        return TransferFile(from, to, allow_hard_link, stats, ec);
+      },
+      "copy " + from.string() + " to " + to.string());
+}
+
+void FileOperationBatch::Add(std::function<bool(std::error_code&)> operation,
+                             std::string description) {
+  Operation entry;
+  entry.kind = Operation::Kind::kOther;
+  entry.run = std::move(operation);
+  entry.description = std::move(description);
+  operations_.push_back(std::move(entry));
+}
+
+void FileOperationBatch::RunOnThreads(
+    const std::vector<Operation*>& operations) {
+  auto run = [](Operation* operation) {
+    operation->failed = !operation->run(operation->error);
+  };
+
+  ThreadPool::Shared().ParallelFor(
+      operations.size(), [&](size_t index) { run(operations[index]); });
+}
+
+bool FileOperationBatch::Run(std::ostream& stderr_stream) {
+  std::vector<Operation*> threaded;
+  threaded.reserve(operations_.size());
+
+#if defined(RULES_SWIFT_HAVE_IO_URING)
+  std::vector<Operation*> ring_operations;
+  if (IoUring* ring = IoUring::Shared()) {
+    for (Operation& operation : operations_) {
+      if (operation.kind != Operation::Kind::kOther) {
+        ring_operations.push_back(&operation);
+      }
+    }
+    std::vector<RingRequest> requests;
+    requests.reserve(ring_operations.size());
+    for (Operation* operation : ring_operations) {
+      RingRequest request;
+      request.opcode = operation->kind == Operation::Kind::kExists
+                           ? kOpStatx
+                           : kOpUnlinkAt;
+      request.path = operation->path.string();
+      requests.push_back(std::move(request));
+    }
+
+    ring->Execute(requests);
+    for (size_t i = 0; i < ring_operations.size(); ++i) {
+      Operation* operation = ring_operations[i];
+      int result = requests[i].result;
+      if (!requests[i].completed) {
+        threaded.push_back(operation);
+      } else if (operation->kind == Operation::Kind::kExists &&
+                 (result == 0 || result == -ENOENT || result == -ENOTDIR)) {
+        *operation->exists = result == 0;
+      } else if (operation->kind == Operation::Kind::kRemove &&
+                 (result == 0 || result == -ENOENT)) {
+        // Removed, or already gone.
+      } else {
+        // Let the portable implementation decide what this error means (for
+        // example, `unlinkat` refuses to remove an empty directory).
+        threaded.push_back(operation);
+      }
+    }
+    for (Operation& operation : operations_) {
+      if (operation.kind == Operation::Kind::kOther) {
+        threaded.push_back(&operation);
+      }
+    }
+  } else
+#endif
+  {
+    for (Operation& operation : operations_) {
+      threaded.push_back(&operation);
+    }
+  }
+
+  RunOnThreads(threaded);
+
+  bool success = true;
+  for (const Operation& operation : operations_) {
+    if (operation.failed) {
+      stderr_stream << "swift_worker: Could not " << operation.description
+                    << " (" << operation.error.message() << ")\n";
+      success = false;
+    }
+  }
+  operations_.clear();
+  return success;
+}
+
+}  // namespace bazel_rules_swift
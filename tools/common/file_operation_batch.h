@@ -0,0 +1,100 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_FILE_OPERATION_BATCH_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_FILE_OPERATION_BATCH_H_
+
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "tools/common/file_transfer.h"
+
+namespace bazel_rules_swift {
+
+// A set of independent file system operations that are submitted together and
+// run concurrently, so that the latency of each one (which dominates on network
+// file systems and overlays) is paid once per batch rather than once per file.
+//
+// Existence checks and removals are issued through io_uring when the kernel
+// supports it; everything else, and everything on other platforms, runs on a
+// small pool of threads. Operations in a batch must not depend on each other.
+class FileOperationBatch {
+ public:
+  // Creates an empty batch. Transfers record their strategies in `stats` if it
+  // is non-null.
+  explicit FileOperationBatch(FileTransferStats* stats = nullptr)
+      : stats_(stats) {}
+
+  FileOperationBatch(const FileOperationBatch&) = delete;
+  FileOperationBatch& operator=(const FileOperationBatch&) = delete;
+
+  // Creates `path` and any missing parent directories.
+  void CreateDirectories(const std::filesystem::path& path);
+
+  // Sets `*exists` to whether `path` exists. `exists` must remain valid until
+  // the batch has run.
+  void Exists(const std::filesystem::path& path, bool* exists);
+
+  // Removes the file at `path`. It is not an error for it not to exist.
+  void Remove(const std::filesystem::path& path);
+
+  // Transfers the file at `from` to `to`; see `TransferFile`.
+  void Transfer(const std::filesystem::path& from,
+                const std::filesystem::path& to, bool allow_hard_link);
+
+  // Adds an operation that isn't one of the above. `operation` returns false
+  // and populates its argument on failure, in which case the diagnostic is
+  // "Could not <description> (<error>)".
+  void Add(std::function<bool(std::error_code&)> operation,
+           std::string description);
+
+  // Returns the number of operations in the batch.
+  size_t size() const { return operations_.size(); }
+
+  // Runs every operation in the batch and empties it. Returns false if any of
+  // them failed, after writing a `swift_worker: Could not ...` diagnostic for
+  // each failure, in the order the operations were added, to `stderr_stream`.
+  bool Run(std::ostream& stderr_stream);
+
+ private:
+  struct Operation {
+    enum class Kind {
+      kExists,
+      kRemove,
+      kOther,
+    };
+
+    Kind kind;
+    std::filesystem::path path;
+    bool* exists = nullptr;
+    std::function<bool(std::error_code&)> run;
+    std::string description;
+    std::error_code error;
+    bool failed = false;
+  };
+
+  // Runs the given operations on the thread pool.
+  void RunOnThreads(const std::vector<Operation*>& operations);
+
+  FileTransferStats* stats_;
+  std::vector<Operation> operations_;
+};
+
+}  // namespace bazel_rules_swift
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_FILE_OPERATION_BATCH_H_
@@ -0,0 +1,283 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/common/file_transfer.h"
+
+#if defined(__APPLE__)
+#include <copyfile.h>
+#include <sys/clonefile.h>
+#elif defined(__linux__)
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <system_error>
+
+#include "tools/common/file_system.h"
+
+namespace bazel_rules_swift {
+
+namespace {
+
+#if !defined(_WIN32)
+std::error_code LastError() {
+  return std::error_code(errno, std::system_category());
+}
+#endif
+
+#if defined(__linux__)
+
+// Closes a file descriptor when it goes out of scope.
+class ScopedFd {
+ public:
+  explicit ScopedFd(int fd) : fd_(fd) {}
+  ~ScopedFd() {
+    if (fd_ >= 0) close(fd_);
+  }
+  ScopedFd(const ScopedFd&) = delete;
+  ScopedFd& operator=(const ScopedFd&) = delete;
+
+  int get() const { return fd_; }
+
+  // Takes ownership of `fd`, closing the descriptor held before.
+  void Reset(int fd) {
+    Close();
+    fd_ = fd;
+  }
+
+  // Closes the descriptor, returning false if closing reported an error.
+  bool Close() {
+    int fd = fd_;
+    fd_ = -1;
+    return fd < 0 || close(fd) == 0;
+  }
+
+ private:
+  int fd_;
+};
+
+// Copies the remaining `size` bytes of `in` to `out`, preferring
+// `copy_file_range` and falling back to reading and writing through a buffer
+// if the kernel or file system doesn't support it. The strategy that was used
+// is stored in `strategy`.
+bool CopyContents(int in, int out, uintmax_t size, TransferStrategy* strategy,
+                  std::error_code& ec) {
+  *strategy = TransferStrategy::kCopyFileRange;
+  uintmax_t remaining = size;
+  while (remaining > 0) {
+    ssize_t copied =
+        copy_file_range(in, nullptr, out, nullptr, remaining, /*flags=*/0);
+    if (copied > 0) {
+      remaining -= copied;
+      continue;
+    }
+    if (copied == 0) {
+      // The file shrank while we were copying it; what we have is complete.
+      return true;
+    }
+    if (remaining == size && (errno == ENOSYS || errno == EXDEV ||
+                              errno == EINVAL || errno == EOPNOTSUPP)) {
+      break;
+    }
+    ec = LastError();
+    return false;
+  }
+  if (remaining == 0) {
+    return true;
+  }
+
+  *strategy = TransferStrategy::kCopy;
+  char buffer[64 * 1024];
+  while (true) {
+    ssize_t bytes_read = read(in, buffer, sizeof(buffer));
+    if (bytes_read == 0) {
+      return true;
+    }
+    if (bytes_read < 0) {
+      if (errno == EINTR) continue;
+      ec = LastError();
+      return false;
+    }
+    for (ssize_t written = 0; written < bytes_read;) {
+      ssize_t result = write(out, buffer + written, bytes_read - written);
+      if (result < 0) {
+        if (errno == EINTR) continue;
+        ec = LastError();
+        return false;
+      }
+      written += result;
+    }
+  }
+}
+
+bool TransferFileLinux(const std::filesystem::path& from,
+                       const std::filesystem::path& to, bool allow_hard_link,
+                       FileTransferStats* stats, std::error_code& ec) {
+  ScopedFd in(open(from.c_str(), O_RDONLY | O_CLOEXEC));
+  struct stat in_stat;
+  if (in.get() < 0 || fstat(in.get(), &in_stat) != 0) {
+    ec = LastError();
+    return false;
+  }
+  uintmax_t size = in_stat.st_size;
+  mode_t mode = in_stat.st_mode & 07777;
+
+  ScopedFd out(
+      open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode));
+  if (out.get() < 0 || fchmod(out.get(), mode) != 0) {
+    ec = LastError();
+    return false;
+  }
+
+  if (ioctl(out.get(), FICLONE, in.get()) == 0) {
+    if (!out.Close()) {
+      ec = LastError();
+      return false;
+    }
+    if (stats != nullptr) stats->Record(TransferStrategy::kClone, size);
+    return true;
+  }
+
+  if (allow_hard_link) {
+    // Replace the empty file we just created with a link to the source. If
+    // linking fails (for example, across devices), recreate it and copy.
+    out.Close();
+    unlink(to.c_str());
+    if (link(from.c_str(), to.c_str()) == 0) {
+      if (stats != nullptr) stats->Record(TransferStrategy::kHardLink, size);
+      return true;
+    }
+    out.Reset(open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode));
+    if (out.get() < 0 || fchmod(out.get(), mode) != 0) {
+      ec = LastError();
+      return false;
+    }
+  }
+
+  TransferStrategy strategy;
+  if (!CopyContents(in.get(), out.get(), size, &strategy, ec)) {
+    out.Close();
+    unlink(to.c_str());
+    return false;
+  }
+  if (!out.Close()) {
+    ec = LastError();
+    return false;
+  }
+  if (stats != nullptr) stats->Record(strategy, size);
+  return true;
+}
+
+#endif
+
+}  // namespace
+
+const char* TransferStrategyName(TransferStrategy strategy) {
+  switch (strategy) {
+    case TransferStrategy::kClone:
+      return "clone";
+    case TransferStrategy::kHardLink:
+      return "hardlink";
+    case TransferStrategy::kCopyFileRange:
+      return "copy_file_range";
+    case TransferStrategy::kCopy:
+      return "copy";
+  }
+  return "unknown";
+}
+
+void FileTransferStats::Record(TransferStrategy strategy, uintmax_t bytes) {
+  files_[static_cast<size_t>(strategy)] += 1;
+  bytes_[static_cast<size_t>(strategy)] += bytes;
+}
+
+void FileTransferStats::RecordUnchanged(uintmax_t bytes) {
+  unchanged_files_ += 1;
+  unchanged_bytes_ += bytes;
+}
+
+bool FileTransferStats::empty() const {
+  for (const std::atomic<uintmax_t>& files : files_) {
+    if (files != 0) return false;
+  }
+  return unchanged_files_ == 0;
+}
+
+void FileTransferStats::Report(std::ostream& stream) const {
+  stream << "swift_worker: Transferred";
+  const char* separator = " ";
+  for (size_t i = 0; i < kStrategyCount; ++i) {
+    if (files_[i] == 0) continue;
+    stream << separator << files_[i] << " files (" << bytes_[i]
+           << " bytes) by "
+           << TransferStrategyName(static_cast<TransferStrategy>(i));
+    separator = ", ";
+  }
+  if (unchanged_files_ != 0) {
+    stream << separator << "skipped " << unchanged_files_
+           << " unchanged files (" << unchanged_bytes_ << " bytes)";
+  }
+  stream << "\n";
+}
+
+bool TransferFile(const std::filesystem::path& from,
+                  const std::filesystem::path& to, bool allow_hard_link,
+                  FileTransferStats* stats, std::error_code& ec) {
+  ec.clear();
+#if defined(__linux__)
+  return TransferFileLinux(from, to, allow_hard_link, stats, ec);
+#else
+  std::error_code size_ec;
+  uintmax_t size = std::filesystem::file_size(LongPath(from), size_ec);
+  if (size_ec) size = 0;
+
+#if defined(__APPLE__)
+  if (clonefile(from.c_str(), to.c_str(), /*flags=*/0) == 0) {
+    if (stats != nullptr) stats->Record(TransferStrategy::kClone, size);
+    return true;
+  }
+#endif
+
+  if (allow_hard_link) {
+    std::filesystem::create_hard_link(LongPath(from), LongPath(to), ec);
+    if (!ec) {
+      if (stats != nullptr) stats->Record(TransferStrategy::kHardLink, size);
+      return true;
+    }
+    ec.clear();
+  }
+
+#if defined(__APPLE__)
+  if (copyfile(from.c_str(), to.c_str(), nullptr, COPYFILE_ALL) < 0) {
+    ec = LastError();
+    return false;
+  }
+#else
+  if (!std::filesystem::copy_file(LongPath(from), LongPath(to), ec)) {
+    return false;
+  }
+#endif
+  if (stats != nullptr) stats->Record(TransferStrategy::kCopy, size);
+  return true;
+#endif
+}
+
+}  // namespace bazel_rules_swift
@@ -0,0 +1,90 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_FILE_TRANSFER_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_FILE_TRANSFER_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <system_error>
+
+namespace bazel_rules_swift {
+
+// The ways a file can be transferred, from cheapest to most expensive.
+enum class TransferStrategy {
+  // A copy-on-write clone that shares storage with the source
+  // (`FICLONE` on Linux, `clonefile` on macOS).
+  kClone,
+
+  // A hard link to the source.
+  kHardLink,
+
+  // An in-kernel copy with `copy_file_range`, which some file systems turn
+  // into a clone or a server-side copy.
+  kCopyFileRange,
+
+  // A plain byte-for-byte copy.
+  kCopy,
+};
+
+// Returns a short human-readable name for the given strategy.
+const char* TransferStrategyName(TransferStrategy strategy);
+
+// Accumulates how many files, and how many bytes, were transferred with each
+// strategy. Transfers may be recorded from several threads at once.
+class FileTransferStats {
+ public:
+  // Records that a file of `bytes` bytes was transferred with `strategy`.
+  void Record(TransferStrategy strategy, uintmax_t bytes);
+
+  // Records that a file of `bytes` bytes didn't need to be transferred because
+  // the destination already had the same contents.
+  void RecordUnchanged(uintmax_t bytes);
+
+  // Returns true if nothing has been recorded.
+  bool empty() const;
+
+  // Writes a one-line summary of the recorded transfers to `stream`.
+  void Report(std::ostream& stream) const;
+
+ private:
+  static constexpr size_t kStrategyCount = 4;
+
+  std::array<std::atomic<uintmax_t>, kStrategyCount> files_ = {};
+  std::array<std::atomic<uintmax_t>, kStrategyCount> bytes_ = {};
+  std::atomic<uintmax_t> unchanged_files_ = 0;
+  std::atomic<uintmax_t> unchanged_bytes_ = 0;
+};
+
+// Transfers the regular file at `from` to `to`, which must not already exist,
+// using the cheapest strategy that works: a clone, then (if `allow_hard_link`
+// is true) a hard link, then a copy.
+//
+// Hard links make the two paths share an inode, contents and permissions
+// alike, so callers must only allow them when neither file will be modified in
+// place or have its mode changed afterwards. That rules out Bazel's action
+// outputs, which Bazel makes read-only once the action finishes.
+//
+// The strategy used is recorded in `stats` if it is non-null. Returns false
+// and populates `ec` if the file could not be transferred.
+bool TransferFile(const std::filesystem::path& from,
+                  const std::filesystem::path& to, bool allow_hard_link,
+                  FileTransferStats* stats, std::error_code& ec);
+
+}  // namespace bazel_rules_swift
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_FILE_TRANSFER_H_
@@ -0,0 +1,291 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/common/index_store.h"
+
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tools/common/bitstream.h"
+
+namespace bazel_rules_swift {
+
+namespace {
+
+// The versioned subdirectory of an index store that holds units and records.
+constexpr char kIndexStoreVersionDirectory[] = "v5";
+
+// The magic number at the start of every unit file.
+constexpr absl::string_view kUnitMagic = "IDXU";
+
+// Block IDs used in unit files. These follow the `UnitBitBlock` enum in Clang's
+// `IndexUnitWriter`, starting at LLVM's `FIRST_APPLICATION_BLOCKID`.
+constexpr uint32_t kUnitInfoBlockId = 9;
+constexpr uint32_t kUnitDependenciesBlockId = 10;
+constexpr uint32_t kUnitPathsBlockId = 12;
+
+// Record codes used in the blocks above.
+constexpr uint32_t kUnitInfoRecord = 1;
+constexpr uint32_t kUnitDependencyRecord = 1;
+constexpr uint32_t kUnitPathRecord = 1;
+constexpr uint32_t kUnitPathBufferRecord = 2;
+
+// Indices of the fields of the `UNIT_INFO` record that we care about.
+constexpr size_t kInfoWorkDirOffset = 1;
+constexpr size_t kInfoWorkDirSize = 2;
+constexpr size_t kInfoOutputFileOffset = 3;
+constexpr size_t kInfoOutputFileSize = 4;
+constexpr size_t kInfoSysrootOffset = 5;
+constexpr size_t kInfoSysrootSize = 6;
+
+// Indices of the fields of a `UNIT_PATH` record. Paths are stored as a
+// directory and a file name, and the directory is either absolute or relative
+// to the unit's working directory or sysroot depending on the prefix kind.
+constexpr size_t kPathPrefixKind = 0;
+constexpr size_t kPathDirOffset = 1;
+constexpr size_t kPathDirSize = 2;
+constexpr size_t kPathFilenameOffset = 3;
+constexpr size_t kPathFilenameSize = 4;
+
+// The prefix kind of a path whose directory is stored verbatim.
+constexpr uint64_t kPathPrefixNone = 0;
+
+// A reference from a record's fields to a string in the unit's path buffer.
+struct PathBufferReference {
+  BitstreamRecord* record;
+  size_t offset_field;
+  size_t size_field;
+
+  // Whether the string is a full path that prefix mappings apply to.
+  bool remappable;
+
+  // Whether the string is the unit's output file.
+  bool is_output_file = false;
+};
+
+// Returns the string at the given offset and size in the unit's path buffer,
+// or nullopt if it is out of range.
+std::optional<std::string> StringFromPathBuffer(absl::string_view buffer,
+                                                uint64_t offset,
+                                                uint64_t size) {
+  if (offset > buffer.size() || size > buffer.size() - offset) {
+    return std::nullopt;
+  }
+  return std::string(buffer.substr(offset, size));
+}
+
+}  // namespace
+
+std::filesystem::path IndexStoreUnitsDirectory(
+    const std::filesystem::path& store_path) {
+  return store_path / kIndexStoreVersionDirectory / "units";
+}
+
+std::filesystem::path IndexStoreRecordsDirectory(
+    const std::filesystem::path& store_path) {
+  return store_path / kIndexStoreVersionDirectory / "records";
+}
+
+std::filesystem::path IndexStoreRecordPath(
+    const std::filesystem::path& store_path, absl::string_view record_name) {
+  absl::string_view bucket = record_name.size() >= 2
+                                 ? record_name.substr(record_name.size() - 2)
+                                 : record_name;
+  return IndexStoreRecordsDirectory(store_path) / std::string(bucket) /
+         std::string(record_name);
+}
+
+void IndexPathRemapper::AddPrefixMapping(std::string prefix,
+                                         std::string replacement) {
+  mappings_.emplace_back(std::move(prefix), std::move(replacement));
+  cache_.clear();
+}
+
+const std::string& IndexPathRemapper::Remap(const std::string& path) {
+  if (auto it = cache_.find(path); it != cache_.end()) {
+    return it->second;
+  }
+  std::string remapped = path;
+  for (const auto& [prefix, replacement] : mappings_) {
+    if (prefix.empty() || path.compare(0, prefix.size(), prefix) != 0) {
+      continue;
+    }
+    // Only match whole path components, so that `/a/b` doesn't rewrite
+    // `/a/bc`.
+    if (path.size() != prefix.size() && path[prefix.size()] != '/' &&
+        prefix.back() != '/') {
+      continue;
+    }
+    remapped = absl::StrCat(replacement, path.substr(prefix.size()));
+    break;
+  }
+  return cache_.emplace(path, std::move(remapped)).first->second;
+}
+
+std::optional<IndexUnit> ParseIndexUnit(absl::string_view data,
+                                        std::string* error) {
+  if (data.substr(0, kUnitMagic.size()) != kUnitMagic) {
+    if (error != nullptr) *error = "not an index unit file";
+    return std::nullopt;
+  }
+
+  std::optional<Bitstream> stream = ParseBitstream(data, error);
+  if (!stream.has_value()) {
+    return std::nullopt;
+  }
+
+  absl::string_view path_buffer;
+  if (const BitstreamBlock* paths = stream->FindBlock(kUnitPathsBlockId)) {
+    for (const BitstreamRecord& record : paths->records) {
+      if (record.code == kUnitPathBufferRecord && record.blob.has_value()) {
+        path_buffer = *record.blob;
+      }
+    }
+  }
+
+  IndexUnit unit;
+  if (const BitstreamBlock* info = stream->FindBlock(kUnitInfoBlockId)) {
+    for (const BitstreamRecord& record : info->records) {
+      if (record.code != kUnitInfoRecord ||
+          record.fields.size() <= kInfoOutputFileSize) {
+        continue;
+      }
+      std::optional<std::string> work_dir = StringFromPathBuffer(
+          path_buffer, record.fields[kInfoWorkDirOffset],
+          record.fields[kInfoWorkDirSize]);
+      std::optional<std::string> output_file = StringFromPathBuffer(
+          path_buffer, record.fields[kInfoOutputFileOffset],
+          record.fields[kInfoOutputFileSize]);
+      if (!work_dir.has_value() || !output_file.has_value()) {
+        if (error != nullptr) *error = "unit info refers outside path buffer";
+        return std::nullopt;
+      }
+      unit.work_dir = *std::move(work_dir);
+      unit.output_file = *std::move(output_file);
+    }
+  }
+
+  if (const BitstreamBlock* dependencies =
+          stream->FindBlock(kUnitDependenciesBlockId)) {
+    for (const BitstreamRecord& record : dependencies->records) {
+      if (record.code != kUnitDependencyRecord || record.fields.empty()) {
+        continue;
+      }
+      IndexUnitDependency dependency;
+      dependency.kind = static_cast<IndexUnitDependencyKind>(record.fields[0]);
+      dependency.name = record.blob.value_or("");
+      unit.dependencies.push_back(std::move(dependency));
+    }
+  }
+
+  return unit;
+}
+
+std::optional<IndexUnit> ReadIndexUnit(const std::filesystem::path& path,
+                                       std::string* error) {
+  std::ifstream stream(path, std::ios::binary);
+  if (!stream) {
+    if (error != nullptr) *error = "could not open file";
+    return std::nullopt;
+  }
+  std::ostringstream contents;
+  contents << stream.rdbuf();
+  return ParseIndexUnit(contents.str(), error);
+}
+
+std::optional<std::string> RemapIndexUnit(absl::string_view data,
+                                          IndexPathRemapper& remapper,
+                                          std::string* output_file,
+                                          std::string* error) {
+  std::optional<Bitstream> stream = ParseBitstream(data, error);
+  if (!stream.has_value()) {
+    return std::nullopt;
+  }
+
+  BitstreamRecord* path_buffer_record = nullptr;
+  std::vector<PathBufferReference> references;
+  for (BitstreamBlock& block : stream->blocks) {
+    for (BitstreamRecord& record : block.records) {
+      if (block.block_id == kUnitPathsBlockId &&
+          record.code == kUnitPathBufferRecord && record.blob.has_value()) {
+        path_buffer_record = &record;
+      } else if (block.block_id == kUnitPathsBlockId &&
+                 record.code == kUnitPathRecord &&
+                 record.fields.size() > kPathFilenameSize) {
+        references.push_back(
+            {&record, kPathDirOffset, kPathDirSize,
+             record.fields[kPathPrefixKind] == kPathPrefixNone});
+        references.push_back({&record, kPathFilenameOffset, kPathFilenameSize,
+                              /*remappable=*/false});
+      } else if (block.block_id == kUnitInfoBlockId &&
+                 record.code == kUnitInfoRecord &&
+                 record.fields.size() > kInfoOutputFileSize) {
+        references.push_back({&record, kInfoWorkDirOffset, kInfoWorkDirSize,
+                              /*remappable=*/true});
+        references.push_back({&record, kInfoOutputFileOffset,
+                              kInfoOutputFileSize, /*remappable=*/true,
+                              /*is_output_file=*/true});
+        if (record.fields.size() > kInfoSysrootSize) {
+          references.push_back({&record, kInfoSysrootOffset, kInfoSysrootSize,
+                                /*remappable=*/true});
+        }
+      }
+    }
+  }
+  if (path_buffer_record == nullptr) {
+    if (error != nullptr) *error = "unit has no path buffer";
+    return std::nullopt;
+  }
+
+  // Lay out a new path buffer, sharing storage between identical strings the
+  // same way the original writer does.
+  const std::string old_buffer = *path_buffer_record->blob;
+  std::string new_buffer;
+  absl::flat_hash_map<std::string, uint64_t> offsets;
+  for (const PathBufferReference& reference : references) {
+    std::vector<uint64_t>& fields = reference.record->fields;
+    std::optional<std::string> value = StringFromPathBuffer(
+        old_buffer, fields[reference.offset_field],
+        fields[reference.size_field]);
+    if (!value.has_value()) {
+      if (error != nullptr) *error = "unit refers outside its path buffer";
+      return std::nullopt;
+    }
+    std::string new_value = reference.remappable && !value->empty()
+                                ? remapper.Remap(*value)
+                                : *std::move(value);
+    if (output_file != nullptr && reference.is_output_file) {
+      *output_file = new_value;
+    }
+    auto [it, inserted] = offsets.try_emplace(new_value, new_buffer.size());
+    if (inserted) {
+      new_buffer.append(new_value);
+    }
+    fields[reference.offset_field] = it->second;
+    fields[reference.size_field] = new_value.size();
+  }
+  path_buffer_record->blob = std::move(new_buffer);
+
+  return WriteBitstream(*stream, error);
+}
+
+}  // namespace bazel_rules_swift
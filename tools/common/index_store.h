@@ -0,0 +1,115 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_INDEX_STORE_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_INDEX_STORE_H_
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+
+namespace bazel_rules_swift {
+
+// The kind of an entry in a unit's dependency list. The values match the
+// `UnitDependencyKind` enum used by Clang's `IndexUnitWriter`.
+enum class IndexUnitDependencyKind {
+  kFile = 0,
+  kRecord = 1,
+  kUnit = 2,
+};
+
+// A dependency of an index unit on a record, another unit, or a plain file.
+struct IndexUnitDependency {
+  IndexUnitDependencyKind kind;
+
+  // The name of the record or unit in the store. Empty for file dependencies.
+  std::string name;
+};
+
+// The subset of an index unit file that the rules need to reason about which
+// records and units are still in use.
+struct IndexUnit {
+  // The working directory of the compilation that produced the unit.
+  std::string work_dir;
+
+  // The path of the output file (for example, the `.o` file) that the unit
+  // describes. May be relative to `work_dir`.
+  std::string output_file;
+
+  std::vector<IndexUnitDependency> dependencies;
+};
+
+// Returns the directory that contains the unit files of the given index store
+// (for example, `<store>/v5/units`).
+std::filesystem::path IndexStoreUnitsDirectory(
+    const std::filesystem::path& store_path);
+
+// Returns the directory that contains the bucketed record files of the given
+// index store (for example, `<store>/v5/records`).
+std::filesystem::path IndexStoreRecordsDirectory(
+    const std::filesystem::path& store_path);
+
+// Returns the path of the record file with the given name in the given index
+// store. Records are bucketed by the last two characters of their name.
+std::filesystem::path IndexStoreRecordPath(
+    const std::filesystem::path& store_path, absl::string_view record_name);
+
+// Rewrites path prefixes in index data the same way `-file-prefix-map` does for
+// the compiler. Results are cached per path, so a remapper that is kept alive
+// across compilations only computes each rewrite once.
+class IndexPathRemapper {
+ public:
+  // Adds a mapping that replaces `prefix` with `replacement` when it matches a
+  // whole leading path component sequence. Mappings are tried in the order
+  // they were added.
+  void AddPrefixMapping(std::string prefix, std::string replacement);
+
+  // Returns true if no mappings have been added.
+  bool empty() const { return mappings_.empty(); }
+
+  // Returns the remapped form of `path`.
+  const std::string& Remap(const std::string& path);
+
+ private:
+  std::vector<std::pair<std::string, std::string>> mappings_;
+  absl::flat_hash_map<std::string, std::string> cache_;
+};
+
+// Parses the contents of an index unit file. Returns nullopt and populates
+// `error` (if non-null) if the data is not a unit file that can be understood.
+std::optional<IndexUnit> ParseIndexUnit(absl::string_view data,
+                                        std::string* error = nullptr);
+
+// Reads and parses the index unit file at the given path.
+std::optional<IndexUnit> ReadIndexUnit(const std::filesystem::path& path,
+                                       std::string* error = nullptr);
+
+// Rewrites the working directory, output file, sysroot, and absolute file
+// paths recorded in the given unit file data using `remapper`, and returns the
+// new unit data. The unit's remapped output file is stored in `output_file` if
+// it is non-null. Returns nullopt and populates `error` (if non-null) if the
+// unit could not be rewritten.
+std::optional<std::string> RemapIndexUnit(absl::string_view data,
+                                          IndexPathRemapper& remapper,
+                                          std::string* output_file,
+                                          std::string* error = nullptr);
+
+}  // namespace bazel_rules_swift
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_INDEX_STORE_H_
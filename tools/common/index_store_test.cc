@@ -0,0 +1,267 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Round-trip tests for the bitstream reader and writer and for rewriting the
+// paths in index units.
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "tools/common/bitstream.h"
+#include "tools/common/index_store.h"
+#include "tools/common/test_support.h"
+
+namespace bazel_rules_swift {
+namespace {
+
+using Encoding = BitstreamAbbrevOp::Encoding;
+
+constexpr char kWorkDir[] = "/work";
+constexpr char kOutputFile[] = "/work/bazel-out/bin/A.swift.o";
+constexpr char kSourceDir[] = "/work/src";
+constexpr char kRelativeSourceDir[] = "src";
+
+// Appends `value` to `buffer` and returns its offset and size.
+std::vector<uint64_t> AddString(std::string& buffer, const std::string& value) {
+  uint64_t offset = buffer.size();
+  buffer.append(value);
+  return {offset, value.size()};
+}
+
+void AddRecord(BitstreamBlock& block, BitstreamRecord record) {
+  block.entries.push_back(
+      {BitstreamBlock::Entry::Kind::kRecord, block.records.size()});
+  block.records.push_back(std::move(record));
+}
+
+void AddAbbrev(BitstreamBlock& block, BitstreamAbbrev abbrev) {
+  block.entries.push_back(
+      {BitstreamBlock::Entry::Kind::kAbbrev, block.abbrevs.size()});
+  block.abbrevs.push_back(std::move(abbrev));
+}
+
+void AddBlock(Bitstream& stream, BitstreamBlock block) {
+  stream.blocks.push_back(std::move(block));
+}
+
+// Builds a unit laid out the way Clang's `IndexUnitWriter` lays one out: the
+// info record's abbreviation comes from BLOCKINFO, the info block precedes the
+// paths block whose buffer it refers to, and both use record code 1.
+Bitstream MakeUnit() {
+  std::string paths;
+  std::vector<uint64_t> work_dir = AddString(paths, kWorkDir);
+  std::vector<uint64_t> output_file = AddString(paths, kOutputFile);
+  std::vector<uint64_t> source_dir = AddString(paths, kSourceDir);
+  std::vector<uint64_t> source_file = AddString(paths, "A.swift");
+  std::vector<uint64_t> relative_dir = AddString(paths, kRelativeSourceDir);
+  std::vector<uint64_t> relative_file = AddString(paths, "B.swift");
+
+  Bitstream stream;
+  stream.magic = "IDXU";
+
+  BitstreamAbbrev info_abbrev = {
+      {Encoding::kLiteral, 1}, {Encoding::kFixed, 1}, {Encoding::kVBR, 6},
+      {Encoding::kVBR, 6},     {Encoding::kVBR, 6},   {Encoding::kVBR, 6},
+      {Encoding::kVBR, 6},     {Encoding::kVBR, 6},   {Encoding::kBlob, 0},
+  };
+  BitstreamBlock block_info;
+  block_info.block_id = 0;
+  AddRecord(block_info, {3, 1, {9}, std::nullopt});
+  AddAbbrev(block_info, info_abbrev);
+  AddBlock(stream, std::move(block_info));
+
+  BitstreamBlock version;
+  version.block_id = 8;
+  AddRecord(version, {3, 1, {5}, std::nullopt});
+  AddBlock(stream, std::move(version));
+
+  BitstreamBlock info;
+  info.block_id = 9;
+  info.abbrev_width = 3;
+  AddRecord(info, {4,
+                   1,
+                   {0, work_dir[0], work_dir[1], output_file[0],
+                    output_file[1], 0, 0},
+                   std::string("swift")});
+  AddBlock(stream, std::move(info));
+
+  BitstreamBlock dependencies;
+  dependencies.block_id = 10;
+  dependencies.abbrev_width = 3;
+  AddAbbrev(dependencies, {{Encoding::kLiteral, 1},
+                           {Encoding::kFixed, 2},
+                           {Encoding::kBlob, 0}});
+  AddRecord(dependencies, {4, 1, {1}, std::string("A.swift-1A2B3C")});
+  AddRecord(dependencies, {4, 1, {2}, std::string("Swift.swiftmodule-XYZ")});
+  AddBlock(stream, std::move(dependencies));
+
+  BitstreamBlock path_block;
+  path_block.block_id = 12;
+  path_block.abbrev_width = 3;
+  AddRecord(path_block, {3,
+                         1,
+                         {0, source_dir[0], source_dir[1], source_file[0],
+                          source_file[1]},
+                         std::nullopt});
+  AddRecord(path_block, {3,
+                         1,
+                         {1, relative_dir[0], relative_dir[1],
+                          relative_file[0], relative_file[1]},
+                         std::nullopt});
+  AddAbbrev(path_block, {{Encoding::kLiteral, 2}, {Encoding::kBlob, 0}});
+  AddRecord(path_block, {4, 2, {}, paths});
+  AddBlock(stream, std::move(path_block));
+
+  return stream;
+}
+
+// Returns the string at the offset and size in `fields` starting at `index`.
+std::string PathString(const Bitstream& stream,
+                       const std::vector<uint64_t>& fields, size_t index) {
+  const BitstreamBlock* paths = stream.FindBlock(12);
+  const std::string& buffer = *paths->records.back().blob;
+  return buffer.substr(fields[index], fields[index + 1]);
+}
+
+void TestBitstreamRoundTrip() {
+  std::string error;
+  std::optional<std::string> written = WriteBitstream(MakeUnit(), &error);
+  CHECK(written.has_value());
+  if (!written.has_value()) return;
+  CHECK(written->substr(0, 4) == "IDXU");
+
+  std::optional<Bitstream> parsed = ParseBitstream(*written, &error);
+  CHECK(parsed.has_value());
+  if (!parsed.has_value()) return;
+  CHECK(parsed->blocks.size() == 5);
+  const BitstreamBlock* info = parsed->FindBlock(9);
+  CHECK(info != nullptr && info->records.size() == 1 &&
+        info->records[0].abbrev_id == 4 &&
+        info->records[0].blob == std::optional<std::string>("swift"));
+
+  // Writing the parsed stream again reproduces it exactly.
+  std::optional<std::string> rewritten = WriteBitstream(*parsed, &error);
+  CHECK(rewritten.has_value() && *rewritten == *written);
+}
+
+void TestWriteBitstreamRejectsFieldsThatDontFit() {
+  Bitstream stream = MakeUnit();
+  stream.blocks[3].records[0].fields[0] = 4;  // A 2-bit fixed field.
+  std::string error;
+  CHECK(!WriteBitstream(stream, &error).has_value());
+  CHECK(!error.empty());
+}
+
+void TestParseIndexUnit() {
+  std::optional<std::string> data = WriteBitstream(MakeUnit());
+  CHECK(data.has_value());
+  if (!data.has_value()) return;
+  std::optional<IndexUnit> unit = ParseIndexUnit(*data);
+  CHECK(unit.has_value());
+  if (!unit.has_value()) return;
+  CHECK(unit->work_dir == kWorkDir);
+  CHECK(unit->output_file == kOutputFile);
+  CHECK(unit->dependencies.size() == 2);
+  CHECK(unit->dependencies[0].kind == IndexUnitDependencyKind::kRecord);
+  CHECK(unit->dependencies[0].name == "A.swift-1A2B3C");
+  CHECK(unit->dependencies[1].kind == IndexUnitDependencyKind::kUnit);
+}
+
+void TestRemapIndexUnit() {
+  std::optional<std::string> data = WriteBitstream(MakeUnit());
+  CHECK(data.has_value());
+  if (!data.has_value()) return;
+
+  IndexPathRemapper remapper;
+  remapper.AddPrefixMapping(kWorkDir, "/PWD");
+  std::string output_file;
+  std::string error;
+  std::optional<std::string> remapped =
+      RemapIndexUnit(*data, remapper, &output_file, &error);
+  CHECK(remapped.has_value());
+  if (!remapped.has_value()) return;
+  CHECK(output_file == "/PWD/bazel-out/bin/A.swift.o");
+
+  std::optional<IndexUnit> unit = ParseIndexUnit(*remapped);
+  CHECK(unit.has_value());
+  if (!unit.has_value()) return;
+  CHECK(unit->work_dir == "/PWD");
+  CHECK(unit->output_file == "/PWD/bazel-out/bin/A.swift.o");
+  CHECK(unit->dependencies.size() == 2);
+
+  // Absolute directories are remapped; file names and directories relative to
+  // the working directory are not.
+  std::optional<Bitstream> stream = ParseBitstream(*remapped);
+  CHECK(stream.has_value());
+  if (!stream.has_value()) return;
+  const BitstreamBlock* paths = stream->FindBlock(12);
+  CHECK(paths != nullptr && paths->records.size() == 3);
+  if (paths == nullptr || paths->records.size() != 3) return;
+  CHECK(PathString(*stream, paths->records[0].fields, 1) == "/PWD/src");
+  CHECK(PathString(*stream, paths->records[0].fields, 3) == "A.swift");
+  CHECK(PathString(*stream, paths->records[1].fields, 1) ==
+        kRelativeSourceDir);
+  CHECK(PathString(*stream, paths->records[1].fields, 3) == "B.swift");
+
+  // The rest of the unit is untouched.
+  const BitstreamBlock* info = stream->FindBlock(9);
+  CHECK(info != nullptr &&
+        info->records[0].blob == std::optional<std::string>("swift"));
+}
+
+void TestRemapIndexUnitWithoutMappings() {
+  std::optional<std::string> data = WriteBitstream(MakeUnit());
+  CHECK(data.has_value());
+  if (!data.has_value()) return;
+
+  // The path buffer is laid out again, but every path keeps its value, and
+  // laying out the result again changes nothing.
+  IndexPathRemapper remapper;
+  std::string output_file;
+  std::optional<std::string> remapped =
+      RemapIndexUnit(*data, remapper, &output_file);
+  CHECK(remapped.has_value());
+  if (!remapped.has_value()) return;
+  CHECK(output_file == kOutputFile);
+
+  std::optional<IndexUnit> unit = ParseIndexUnit(*remapped);
+  CHECK(unit.has_value() && unit->work_dir == kWorkDir &&
+        unit->output_file == kOutputFile);
+  std::optional<Bitstream> stream = ParseBitstream(*remapped);
+  CHECK(stream.has_value());
+  if (!stream.has_value()) return;
+  const BitstreamBlock* paths = stream->FindBlock(12);
+  CHECK(paths != nullptr && paths->records.size() == 3);
+  if (paths == nullptr || paths->records.size() != 3) return;
+  CHECK(PathString(*stream, paths->records[0].fields, 1) == kSourceDir);
+  CHECK(PathString(*stream, paths->records[1].fields, 3) == "B.swift");
+
+  std::optional<std::string> again =
+      RemapIndexUnit(*remapped, remapper, /*output_file=*/nullptr);
+  CHECK(again.has_value() && *again == *remapped);
+}
+
+}  // namespace
+}  // namespace bazel_rules_swift
+
+int main() {
+  bazel_rules_swift::TestBitstreamRoundTrip();
+  bazel_rules_swift::TestWriteBitstreamRejectsFieldsThatDontFit();
+  bazel_rules_swift::TestParseIndexUnit();
+  bazel_rules_swift::TestRemapIndexUnit();
+  bazel_rules_swift::TestRemapIndexUnitWithoutMappings();
+  return bazel_rules_swift::testing::TestExitCode();
+}
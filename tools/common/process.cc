@@ -254,6 +254,7 @@ int RunSubProcess(const std::vector<std::string>& args,
 #include <unistd.h>
 
 #include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include <filesystem>
 #include <memory>
@@ -268,10 +269,22 @@ class PosixSpawnIORedirector {
   // Create an I/O redirector that can be used with posix_spawn to capture
   // stderr.
   static std::unique_ptr<PosixSpawnIORedirector> Create(bool stdoutToStderr) {
+    // The pipe is close-on-exec so that children spawned concurrently on other
+    // threads don't inherit its write end, which would keep this child's
+    // output open until they exit; `posix_spawn`'s dup2 clears the flag on
+    // the copies that the child is meant to have.
     int stderr_pipe[2];
+#if defined(__linux__)
+    if (pipe2(stderr_pipe, O_CLOEXEC) != 0) {
+      return nullptr;
+    }
+#else
     if (pipe(stderr_pipe) != 0) {
       return nullptr;
     }
+    fcntl(stderr_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(stderr_pipe[1], F_SETFD, FD_CLOEXEC);
+#endif
 
     return std::unique_ptr<PosixSpawnIORedirector>(
         new PosixSpawnIORedirector(stderr_pipe, stdoutToStderr));
@@ -297,6 +310,13 @@ class PosixSpawnIORedirector {
   // pipe.
   int* StderrPipe() { return stderr_pipe_; }
 
+  // Lets the child inherit the in-memory response files named by `args`, which
+  // are passed as `@/proc/self/fd/N` (see `TempFile::CreatePreferringMemory`).
+  // Their descriptors are close-on-exec so that children spawned concurrently
+  // don't inherit files meant for other requests; `posix_spawn`'s dup2 of a
+  // descriptor onto itself clears the flag in this child only.
+  void InheritResponseFiles(const std::vector<std::string>& args);
+
   // Consumes all the data output to stderr by the subprocess and writes it to
   // the given output stream.
   void ConsumeAllSubprocessOutput(std::ostream* stderr_stream);
@@ -347,6 +367,25 @@ void PosixSpawnIORedirector::ConsumeAllSubprocessOutput(
   }
 }
 
+void PosixSpawnIORedirector::InheritResponseFiles(
+    const std::vector<std::string>& args) {
+  static constexpr char kPrefix[] = "@/proc/self/fd/";
+  constexpr size_t kPrefixLength = sizeof(kPrefix) - 1;
+  for (const std::string& arg : args) {
+    if (arg.size() <= kPrefixLength ||
+        arg.compare(0, kPrefixLength, kPrefix) != 0) {
+      continue;
+    }
+    const char* digits = arg.c_str() + kPrefixLength;
+    char* end;
+    long fd = strtol(digits, &end, 10);
+    if (*end == '\0' && fd > STDERR_FILENO && fd != stderr_pipe_[0] &&
+        fd != stderr_pipe_[1]) {
+      posix_spawn_file_actions_adddup2(&file_actions_, fd, fd);
+    }
+  }
+}
+
 // Converts an array of string arguments to char *arguments, terminated by a
 // nullptr.
 // It is the responsibility of the caller to free the elements of the returned
@@ -376,6 +415,7 @@ int RunSubProcess(const std::vector<std::string>& args,
     (*stderr_stream) << "Error creating stderr pipe for child process.\n";
     return 254;
   }
+  redirector->InheritResponseFiles(args);
 
   char** envp;
   std::vector<char*> new_environ;
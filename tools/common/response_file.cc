@@ -0,0 +1,171 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/common/response_file.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace bazel_rules_swift {
+
+namespace {
+
+// Returns the first occurrence of `ch` in [`begin`, `end`), or `end`.
+const char* Find(const char* begin, const char* end, char ch) {
+  const void* found = memchr(begin, ch, end - begin);
+  return found != nullptr ? static_cast<const char*>(found) : end;
+}
+
+}  // namespace
+
+std::unique_ptr<ResponseFile> ResponseFile::Open(const std::string& path) {
+  std::unique_ptr<ResponseFile> file(new ResponseFile());
+#if !defined(_WIN32)
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) != 0 || !S_ISREG(stat_buf.st_mode)) {
+    close(fd);
+    return nullptr;
+  }
+  if (stat_buf.st_size > 0) {
+    void* mapping = mmap(nullptr, stat_buf.st_size, PROT_READ, MAP_PRIVATE, fd,
+                         0);
+    if (mapping != MAP_FAILED) {
+      file->mapping_ = mapping;
+      file->mapping_size_ = stat_buf.st_size;
+      file->contents_ = absl::string_view(static_cast<const char*>(mapping),
+                                          stat_buf.st_size);
+    }
+  }
+  close(fd);
+  if (stat_buf.st_size > 0 && file->mapping_ == nullptr) {
+    return nullptr;
+  }
+#else
+  std::ifstream stream(path, std::ios::binary);
+  if (!stream.good()) {
+    return nullptr;
+  }
+  file->buffer_.assign(std::istreambuf_iterator<char>(stream),
+                       std::istreambuf_iterator<char>());
+  file->contents_ = file->buffer_;
+#endif
+  file->SplitLines();
+  return file;
+}
+
+ResponseFile::~ResponseFile() {
+#if !defined(_WIN32)
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+  }
+#endif
+}
+
+void ResponseFile::SplitLines() {
+  const char* begin = contents_.data();
+  const char* end = begin + contents_.size();
+
+  // The next quote or backslash of each kind is found once and reused for
+  // every line before it, so the whole file is scanned for each character only
+  // once, rather than every line being scanned character by character.
+  const char* next_backslash = Find(begin, end, '\\');
+  const char* next_double_quote = Find(begin, end, '"');
+  const char* next_single_quote = Find(begin, end, '\'');
+
+  for (const char* line = begin; line < end;) {
+    const char* line_end = Find(line, end, '\n');
+    if (next_backslash < line) next_backslash = Find(line, end, '\\');
+    if (next_double_quote < line) next_double_quote = Find(line, end, '"');
+    if (next_single_quote < line) next_single_quote = Find(line, end, '\'');
+
+    lines_.emplace_back(line, line_end - line);
+    needs_unescaping_.push_back(next_backslash < line_end ||
+                                next_double_quote < line_end ||
+                                next_single_quote < line_end);
+    line = line_end + 1;
+  }
+}
+
+std::vector<absl::string_view> ResponseFile::UnescapedArguments() {
+  std::vector<absl::string_view> arguments;
+  arguments.reserve(lines_.size());
+  for (size_t i = 0; i < lines_.size(); ++i) {
+    if (needs_unescaping_[i]) {
+      arguments.push_back(
+          unescaped_.emplace_back(UnescapeResponseFileArgument(lines_[i])));
+    } else {
+      arguments.push_back(lines_[i]);
+    }
+  }
+  return arguments;
+}
+
+std::string UnescapeResponseFileArgument(absl::string_view arg) {
+  std::string result;
+  result.reserve(arg.size());
+  auto length = arg.size();
+  for (size_t i = 0; i < length; ++i) {
+    auto ch = arg[i];
+
+    // If it's a backslash, consume it and append the character that follows.
+    if (ch == '\\' && i + 1 < length) {
+      ++i;
+      result.push_back(arg[i]);
+      continue;
+    }
+
+    // If it's a quote, process everything up to the matching quote, unescaping
+    // backslashed characters as needed.
+    if (ch == '"' || ch == '\'') {
+      auto quote = ch;
+      ++i;
+      while (i != length && arg[i] != quote) {
+        if (arg[i] == '\\' && i + 1 < length) {
+          ++i;
+        }
+        result.push_back(arg[i]);
+        ++i;
+      }
+      if (i == length) {
+        break;
+      }
+      continue;
+    }
+
+    // It's a regular character.
+    result.push_back(ch);
+  }
+
+  return result;
+}
+
+}  // namespace bazel_rules_swift
@@ -0,0 +1,79 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_RESPONSE_FILE_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_RESPONSE_FILE_H_
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace bazel_rules_swift {
+
+// A response (params) file with one argument per line, mapped into memory.
+//
+// Lines are found with `memchr`, which the C library vectorizes, and most
+// arguments are returned as views directly into the mapping. Only arguments
+// that contain quotes or backslashes are copied, when they are unescaped. All
+// of the views remain valid for the lifetime of the object.
+class ResponseFile {
+ public:
+  // Opens the response file at `path`. Returns nullptr if it can't be read
+  // (for example, because the argument that named it was something like
+  // `@loader_path/...` rather than a response file).
+  static std::unique_ptr<ResponseFile> Open(const std::string& path);
+
+  ~ResponseFile();
+  ResponseFile(const ResponseFile&) = delete;
+  ResponseFile& operator=(const ResponseFile&) = delete;
+
+  // Returns the lines of the file, exactly as written.
+  const std::vector<absl::string_view>& lines() const { return lines_; }
+
+  // Returns the arguments in the file, with quotes removed and backslash
+  // escapes resolved.
+  std::vector<absl::string_view> UnescapedArguments();
+
+ private:
+  ResponseFile() = default;
+
+  // Splits `contents_` into `lines_`, and records which of them need to be
+  // unescaped.
+  void SplitLines();
+
+  // The file's contents, which are either mapped or, where mapping isn't
+  // available, read into `buffer_`.
+  absl::string_view contents_;
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+  std::string buffer_;
+
+  std::vector<absl::string_view> lines_;
+  std::vector<bool> needs_unescaping_;
+
+  // Unescaped copies of the lines that needed them. A deque never moves its
+  // elements, so views of them stay valid.
+  std::deque<std::string> unescaped_;
+};
+
+// Unescapes and unquotes an argument read from a line of a response file.
+std::string UnescapeResponseFileArgument(absl::string_view arg);
+
+}  // namespace bazel_rules_swift
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_RESPONSE_FILE_H_
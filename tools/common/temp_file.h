@@ -17,6 +17,8 @@
 
 #include <cassert>
 #include <cerrno>
+#include <cinttypes>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -24,14 +26,19 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <utility>
 
 #if defined(_WIN32)
 #include <direct.h>
 #include <io.h>
 #endif
 #if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#include <sys/statvfs.h>
 #include <unistd.h>
 #endif
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 // An RAII temporary file.
 class TempFile {
@@ -39,8 +46,13 @@ class TempFile {
   // Explicitly make TempFile non-copyable and movable.
   TempFile(const TempFile&) = delete;
   TempFile& operator=(const TempFile&) = delete;
-  TempFile(TempFile&&) = default;
-  TempFile& operator=(TempFile&&) = default;
+  TempFile(TempFile&& other)
+      : path_(std::move(other.path_)), fd_(std::exchange(other.fd_, -1)) {}
+  TempFile& operator=(TempFile&& other) {
+    std::swap(path_, other.path_);
+    std::swap(fd_, other.fd_);
+    return *this;
+  }
 
   // Create a new temporary file using the given path template string (the same
   // form used by `mkstemp`). The file will automatically be deleted when the
@@ -60,17 +72,53 @@ class TempFile {
       return nullptr;
     }
 #else
-    if (::mkstemp(path.data()) < 0) {
+    int fd = ::mkstemp(path.data());
+    if (fd < 0) {
       std::cerr << "Failed to create temporary file '" << temporary
                 << "': " << strerror(errno) << "\n";
       return nullptr;
     }
+    // The file is reopened by path when it is written, so the descriptor
+    // would only leak for the lifetime of a persistent worker.
+    ::close(fd);
 #endif
 
     return std::unique_ptr<TempFile>(new TempFile(path));
   }
 
+  // Creates a new temporary file like `Create`, but keeps it in memory if the
+  // `RULES_SWIFT_PARAMS_FILE_BACKEND` environment variable is `memfd` and the
+  // platform supports it.
+  //
+  // An in-memory file is an anonymous `memfd_create` file whose path is
+  // `/proc/self/fd/N`. Its descriptor is close-on-exec; `RunSubProcess` makes
+  // it inheritable only in a child whose arguments name it as a response file
+  // (`@/proc/self/fd/N`), where the path names the same file. Only that child
+  // (or descendants that don't close inherited descriptors) can open it, which
+  // is enough for response files. If the file can't be created, it is created
+  // on disk instead.
+  static std::unique_ptr<TempFile> CreatePreferringMemory(
+      const std::string& path_template) {
+#if defined(__linux__)
+    const char* backend = std::getenv("RULES_SWIFT_PARAMS_FILE_BACKEND");
+    if (backend != nullptr && strcmp(backend, "memfd") == 0) {
+      int fd = ::memfd_create(path_template.c_str(), MFD_CLOEXEC);
+      if (fd >= 0) {
+        return std::unique_ptr<TempFile>(
+            new TempFile("/proc/self/fd/" + std::to_string(fd), fd));
+      }
+    }
+#endif
+    return Create(path_template);
+  }
+
   ~TempFile() {
+    if (fd_ >= 0) {
+#if !defined(_WIN32)
+      ::close(fd_);
+#endif
+      return;
+    }
     std::error_code ec;
     std::filesystem::remove(path_, ec);
   }
@@ -79,9 +127,14 @@ class TempFile {
   std::string GetPath() const { return path_; }
 
  private:
-  explicit TempFile(const std::string& path) : path_(path) {}
+  explicit TempFile(const std::string& path, int fd = -1)
+      : path_(path), fd_(fd) {}
 
   std::string path_;
+
+  // The descriptor that keeps an in-memory file alive, or -1 if the file is on
+  // disk.
+  int fd_;
 };
 
 // An RAII temporary directory that is recursively deleted.
@@ -99,10 +152,87 @@ class TempDirectory {
   static std::unique_ptr<TempDirectory> Create(
       const std::string& path_template) {
     std::error_code ec;
-    std::filesystem::path temporary{std::filesystem::temp_directory_path(ec) /
-                                    path_template};
+    std::filesystem::path parent = std::filesystem::temp_directory_path(ec);
     if (ec) return nullptr;
+    return CreateIn(parent, path_template);
+  }
 
+  // Creates a new temporary directory like `Create`, but in the memory-backed
+  // directory (for example, a tmpfs mount) named by the
+  // `RULES_SWIFT_RAM_TEMP_DIR` environment variable, if it is set and the
+  // directory isn't full.
+  //
+  // The directory is considered full when its file system has no space left
+  // or, if `RULES_SWIFT_RAM_TEMP_DIR_LIMIT` is set (in bytes, optionally
+  // followed by `K`, `M`, or `G`), when at least that much of the file system
+  // is in use.
+  // In either case, or if the directory can't be created there, it is created
+  // in the default temporary directory instead. The check is made only when the
+  // directory is created; whatever is written to it afterwards must fit.
+  static std::unique_ptr<TempDirectory> CreatePreferringMemory(
+      const std::string& path_template) {
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+    const char* ram_dir = std::getenv("RULES_SWIFT_RAM_TEMP_DIR");
+    struct statvfs stats;
+    if (ram_dir != nullptr && ram_dir[0] != '\0' &&
+        ::statvfs(ram_dir, &stats) == 0) {
+      uintmax_t available = uintmax_t{stats.f_bavail} * stats.f_frsize;
+      uintmax_t used =
+          uintmax_t{stats.f_blocks - stats.f_bfree} * stats.f_frsize;
+      uintmax_t limit =
+          ParseSize(std::getenv("RULES_SWIFT_RAM_TEMP_DIR_LIMIT"));
+      if (available > 0 && (limit == 0 || used < limit)) {
+        if (auto directory = CreateIn(ram_dir, path_template)) {
+          return directory;
+        }
+      }
+    }
+#endif
+    return Create(path_template);
+  }
+
+  ~TempDirectory() {
+    if (path_.empty()) return;
+    std::error_code ec;
+    std::filesystem::remove_all(path_, ec);
+  }
+
+  // Gets the path to the temporary directory.
+  std::string GetPath() const { return path_; }
+
+  // Gives up ownership of the directory, which will no longer be deleted when
+  // the object goes out of scope, and returns its path.
+  std::string Release() { return std::exchange(path_, std::string()); }
+
+ private:
+  explicit TempDirectory(const std::string& path) : path_(path) {}
+
+  // Returns the number of bytes in `value`, a decimal number optionally
+  // followed by `K`, `M`, or `G`, or 0 if it is null or malformed.
+  static uintmax_t ParseSize(const char* value) {
+    if (value == nullptr) return 0;
+    char* suffix;
+    uintmax_t amount = std::strtoumax(value, &suffix, 10);
+    if (suffix == value) return 0;
+    switch (*suffix) {
+      case '\0':
+        return amount;
+      case 'K':
+        return amount << 10;
+      case 'M':
+        return amount << 20;
+      case 'G':
+        return amount << 30;
+      default:
+        return 0;
+    }
+  }
+
+  // Creates a new temporary directory in `parent` using the given path template
+  // string.
+  static std::unique_ptr<TempDirectory> CreateIn(
+      const std::filesystem::path& parent, const std::string& path_template) {
+    std::filesystem::path temporary{parent / path_template};
     std::string path = temporary.string();
 
 #if defined(_WIN32)
@@ -137,17 +267,6 @@ class TempDirectory {
     return std::unique_ptr<TempDirectory>(new TempDirectory(path));
   }
 
-  ~TempDirectory() {
-    std::error_code ec;
-    std::filesystem::remove_all(path_, ec);
-  }
-
-  // Gets the path to the temporary directory.
-  std::string GetPath() const { return path_; }
-
- private:
-  explicit TempDirectory(const std::string& path) : path_(path) {}
-
   std::string path_;
 };
 
@@ -0,0 +1,74 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_TEST_SUPPORT_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_TEST_SUPPORT_H_
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+// Support for the tools' C++ unit tests, which are plain `cc_test` binaries
+// with their own `main` so that the tools don't depend on a test framework.
+// A test calls its test functions from `main`, which returns `TestExitCode()`.
+
+namespace bazel_rules_swift {
+namespace testing {
+
+// The number of checks that have failed so far in this test binary.
+inline int& TestFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+// Returns an empty directory named `name` under the test's temporary
+// directory, which is `TEST_TMPDIR` when run by Bazel.
+inline std::filesystem::path MakeTestDirectory(const std::string& name) {
+  const char* test_tmpdir = std::getenv("TEST_TMPDIR");
+  std::filesystem::path directory =
+      std::filesystem::path(test_tmpdir != nullptr
+                                ? test_tmpdir
+                                : std::filesystem::temp_directory_path()) /
+      name;
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  return directory;
+}
+
+// Returns the exit status for the test's `main`, after reporting how many
+// checks failed.
+inline int TestExitCode() {
+  if (TestFailures() > 0) {
+    std::cerr << TestFailures() << " check(s) failed\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+}  // namespace testing
+}  // namespace bazel_rules_swift
+
+// Records a failure, with the location and text of `condition`, if it is
+// false. The test keeps running so that one binary reports every failure.
+#define CHECK(condition)                                                 \
+  do {                                                                   \
+    if (!(condition)) {                                                  \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: "     \
+                << #condition << "\n";                                   \
+      ++::bazel_rules_swift::testing::TestFailures();                    \
+    }                                                                    \
+  } while (false)
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_TEST_SUPPORT_H_
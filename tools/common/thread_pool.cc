@@ -0,0 +1,83 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/common/thread_pool.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+namespace bazel_rules_swift {
+
+ThreadPool& ThreadPool::Shared() {
+  static ThreadPool* pool = new ThreadPool();
+  return *pool;
+}
+
+void ThreadPool::ParallelFor(size_t count, unsigned helpers,
+                             std::function<void(size_t)> task) {
+  auto job = std::make_shared<Job>(count, std::move(task));
+  helpers = std::min(helpers, kMaxThreads - 1);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (unsigned i = 0; i < helpers; ++i) {
+      queue_.push_back(job);
+    }
+    for (; thread_count_ < helpers; ++thread_count_) {
+      std::thread([this]() { Work(); }).detach();
+    }
+  }
+  queue_changed_.notify_all();
+
+  job->Drain();
+  std::unique_lock<std::mutex> lock(job->mutex);
+  job->all_finished.wait(lock, [&]() { return job->finished == count; });
+}
+
+void ThreadPool::ParallelFor(size_t count, std::function<void(size_t)> task) {
+  unsigned thread_count = std::min<size_t>(
+      {count, std::max(1u, std::thread::hardware_concurrency()), kMaxThreads});
+  if (thread_count <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      task(i);
+    }
+    return;
+  }
+  ParallelFor(count, thread_count - 1, std::move(task));
+}
+
+void ThreadPool::Job::Drain() {
+  for (size_t i = next++; i < count; i = next++) {
+    task(i);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (++finished == count) {
+      all_finished.notify_all();
+    }
+  }
+}
+
+void ThreadPool::Work() {
+  while (true) {
+    std::shared_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queue_changed_.wait(lock, [this]() { return !queue_.empty(); });
+      job = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    job->Drain();
+  }
+}
+
+}  // namespace bazel_rules_swift
@@ -0,0 +1,84 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_THREAD_POOL_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace bazel_rules_swift {
+
+// Threads shared by everything in the process that fans work out, so that a
+// worker that handles many small requests doesn't start and join threads for
+// each of them. Threads are started the first time they are needed and live
+// as long as the process.
+class ThreadPool {
+ public:
+  // The most threads, counting the calling thread, that one call uses. The
+  // work handed to the pool is mostly waiting on the file system, not the CPU,
+  // so this doesn't need to track the core count closely; it only keeps a
+  // large call from creating hundreds of threads.
+  static constexpr unsigned kMaxThreads = 16;
+
+  static ThreadPool& Shared();
+
+  // Calls `task` with every index in `[0, count)`, on the calling thread and
+  // on up to `helpers` pool threads, and returns once every call has finished.
+  // Since the calling thread does the work that no pool thread picks up,
+  // callers running concurrently never wait on each other.
+  void ParallelFor(size_t count, unsigned helpers,
+                   std::function<void(size_t)> task);
+
+  // Like `ParallelFor`, but uses as many helpers as the machine and the
+  // number of calls warrant, and runs everything on the calling thread when
+  // there is only one call to make.
+  void ParallelFor(size_t count, std::function<void(size_t)> task);
+
+ private:
+  struct Job {
+    Job(size_t count, std::function<void(size_t)> task)
+        : count(count), task(std::move(task)) {}
+
+    // Runs the calls that no other thread has claimed yet. A thread that gets
+    // to the job after every call was claimed returns without touching `task`,
+    // whose captures may no longer be valid.
+    void Drain();
+
+    const size_t count;
+    const std::function<void(size_t)> task;
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable all_finished;
+    size_t finished = 0;
+  };
+
+  ThreadPool() = default;
+
+  void Work();
+
+  std::mutex mutex_;
+  std::condition_variable queue_changed_;
+  std::deque<std::shared_ptr<Job>> queue_;
+  unsigned thread_count_ = 0;
+};
+
+}  // namespace bazel_rules_swift
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_COMMON_THREAD_POOL_H_
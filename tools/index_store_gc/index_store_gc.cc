@@ -0,0 +1,468 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Prunes stale units and records from the global index store that
+// `swift.use_global_index_store` compiles into (the path passed to the worker
+// as `-Xwrapped-swift=-global-index-store-import-path=`).
+//
+// Every compile writes a unit per output file plus the records for the symbols
+// in its sources. Nothing in the build removes them again, so the store grows
+// without bound. This tool keeps a unit only if the output file it describes
+// still exists (or it was written recently, or it is referenced by another
+// unit that is kept), and keeps a record only if some kept unit references it.
+// Everything else is deleted.
+//
+// Usage: index_store_gc [options] <index-store-path>
+//
+// Options:
+//   --dry-run            Print what would be deleted without deleting it.
+//   --exec-root=<path>   The directory that relative unit output paths are
+//                        resolved against. Defaults to the unit's recorded
+//                        working directory, then the current directory.
+//   --grace-period=<d>   Never delete a file modified more recently than this
+//                        (default: 10m). This protects the records and units
+//                        that an in-flight build is writing.
+//   --max-age=<d>        Also prune units that haven't been rewritten within
+//                        this duration, even if their output file exists.
+//   --max-size=<n>       If the surviving units and records are larger than
+//                        this, prune the least recently written units until
+//                        they fit.
+//   -v, --verbose        Print every file that is (or would be) deleted.
+//
+// Durations accept an `s`, `m`, `h`, or `d` suffix (seconds by default); sizes
+// accept a `K`, `M`, or `G` suffix (bytes by default).
+//
+// The tool is safe to run while builds are writing to the store: besides the
+// grace period, units are deleted before the records they reference, and the
+// units directory is scanned again right before records are deleted so that
+// records picked up by units written in the meantime are kept.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "tools/common/index_store.h"
+
+namespace {
+
+using bazel_rules_swift::IndexStoreRecordsDirectory;
+using bazel_rules_swift::IndexStoreUnitsDirectory;
+using bazel_rules_swift::IndexUnit;
+using bazel_rules_swift::IndexUnitDependencyKind;
+
+using Clock = std::filesystem::file_time_type::clock;
+
+struct Options {
+  bool dry_run = false;
+  bool verbose = false;
+  std::filesystem::path exec_root;
+  std::chrono::seconds grace_period = std::chrono::minutes(10);
+  std::optional<std::chrono::seconds> max_age;
+  std::optional<uint64_t> max_size;
+  std::filesystem::path store_path;
+};
+
+// A unit or record file found in the store.
+struct StoreFile {
+  std::filesystem::path path;
+  uint64_t size = 0;
+  std::filesystem::file_time_type mtime;
+};
+
+// A unit file along with what we learned from parsing it.
+struct UnitEntry {
+  StoreFile file;
+
+  // The parsed unit, or nullopt if it couldn't be parsed.
+  std::optional<IndexUnit> unit;
+
+  // Names of the records and units this unit keeps alive.
+  std::vector<std::string> referenced_records;
+  std::vector<std::string> referenced_units;
+};
+
+void PrintUsage() {
+  std::cerr << "usage: index_store_gc [--dry-run] [--exec-root=<path>] "
+               "[--grace-period=<duration>] [--max-age=<duration>] "
+               "[--max-size=<bytes>] [-v] <index-store-path>\n";
+}
+
+// Parses a duration like "90", "45m", "12h", or "30d".
+std::optional<std::chrono::seconds> ParseDuration(absl::string_view value) {
+  int64_t multiplier = 1;
+  if (absl::ConsumeSuffix(&value, "d")) {
+    multiplier = 24 * 60 * 60;
+  } else if (absl::ConsumeSuffix(&value, "h")) {
+    multiplier = 60 * 60;
+  } else if (absl::ConsumeSuffix(&value, "m")) {
+    multiplier = 60;
+  } else {
+    absl::ConsumeSuffix(&value, "s");
+  }
+  int64_t amount;
+  if (!absl::SimpleAtoi(value, &amount) || amount < 0) {
+    return std::nullopt;
+  }
+  return std::chrono::seconds(amount * multiplier);
+}
+
+// Parses a size like "1048576", "512M", or "20G".
+std::optional<uint64_t> ParseSize(absl::string_view value) {
+  uint64_t multiplier = 1;
+  if (absl::ConsumeSuffix(&value, "G")) {
+    multiplier = uint64_t{1} << 30;
+  } else if (absl::ConsumeSuffix(&value, "M")) {
+    multiplier = uint64_t{1} << 20;
+  } else if (absl::ConsumeSuffix(&value, "K")) {
+    multiplier = uint64_t{1} << 10;
+  }
+  uint64_t amount;
+  if (!absl::SimpleAtoi(value, &amount)) {
+    return std::nullopt;
+  }
+  return amount * multiplier;
+}
+
+std::optional<Options> ParseOptions(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    absl::string_view arg = argv[i];
+    if (arg == "--dry-run") {
+      options.dry_run = true;
+    } else if (arg == "-v" || arg == "--verbose") {
+      options.verbose = true;
+    } else if (absl::ConsumePrefix(&arg, "--exec-root=")) {
+      options.exec_root = std::string(arg);
+    } else if (absl::ConsumePrefix(&arg, "--grace-period=")) {
+      std::optional<std::chrono::seconds> duration = ParseDuration(arg);
+      if (!duration.has_value()) return std::nullopt;
+      options.grace_period = *duration;
+    } else if (absl::ConsumePrefix(&arg, "--max-age=")) {
+      options.max_age = ParseDuration(arg);
+      if (!options.max_age.has_value()) return std::nullopt;
+    } else if (absl::ConsumePrefix(&arg, "--max-size=")) {
+      options.max_size = ParseSize(arg);
+      if (!options.max_size.has_value()) return std::nullopt;
+    } else if (absl::StartsWith(arg, "-") || !options.store_path.empty()) {
+      return std::nullopt;
+    } else {
+      options.store_path = std::string(arg);
+    }
+  }
+  if (options.store_path.empty()) {
+    return std::nullopt;
+  }
+  return options;
+}
+
+// Returns the regular files directly inside `dir` (or, if `bucketed` is true,
+// inside its immediate subdirectories), keyed by file name.
+absl::flat_hash_map<std::string, StoreFile> ListStoreFiles(
+    const std::filesystem::path& dir, bool bucketed) {
+  absl::flat_hash_map<std::string, StoreFile> files;
+  std::vector<std::filesystem::path> dirs;
+  std::error_code ec;
+  if (bucketed) {
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+      if (entry.is_directory(ec)) {
+        dirs.push_back(entry.path());
+      }
+    }
+  } else {
+    dirs.push_back(dir);
+  }
+
+  for (const std::filesystem::path& current : dirs) {
+    for (const auto& entry :
+         std::filesystem::directory_iterator(current, ec)) {
+      // Files can disappear while we're scanning if a build replaces them;
+      // skip anything we can't stat.
+      std::error_code stat_ec;
+      if (!entry.is_regular_file(stat_ec) || stat_ec) continue;
+      StoreFile file;
+      file.path = entry.path();
+      file.size = entry.file_size(stat_ec);
+      if (stat_ec) continue;
+      file.mtime = entry.last_write_time(stat_ec);
+      if (stat_ec) continue;
+      files[entry.path().filename().string()] = std::move(file);
+    }
+  }
+  return files;
+}
+
+std::string ReadFileContents(const std::filesystem::path& path) {
+  std::ifstream stream(path, std::ios::binary);
+  std::ostringstream contents;
+  contents << stream.rdbuf();
+  return contents.str();
+}
+
+// Returns true if the output file that the unit describes still exists. The
+// unit must name an output file.
+bool UnitOutputExists(const IndexUnit& unit, const Options& options) {
+  std::filesystem::path output(unit.output_file);
+  std::error_code ec;
+  if (output.is_absolute()) {
+    return std::filesystem::exists(output, ec);
+  }
+  if (!options.exec_root.empty()) {
+    return std::filesystem::exists(options.exec_root / output, ec);
+  }
+  std::filesystem::path work_dir(unit.work_dir);
+  if (work_dir.is_absolute() &&
+      std::filesystem::exists(work_dir / output, ec)) {
+    return true;
+  }
+  return std::filesystem::exists(output, ec);
+}
+
+// Populates the referenced record and unit names of the given entry. If the
+// unit couldn't be parsed, we fall back to treating every record or unit whose
+// name appears anywhere in the file as referenced, which can only keep too
+// much, never too little.
+void CollectReferences(
+    UnitEntry& entry,
+    const absl::flat_hash_map<std::string, StoreFile>& records,
+    const absl::flat_hash_map<std::string, StoreFile>& units) {
+  if (entry.unit.has_value()) {
+    for (const auto& dependency : entry.unit->dependencies) {
+      if (dependency.name.empty()) continue;
+      if (dependency.kind == IndexUnitDependencyKind::kUnit ||
+          units.contains(dependency.name)) {
+        entry.referenced_units.push_back(dependency.name);
+      }
+      if (dependency.kind == IndexUnitDependencyKind::kRecord ||
+          records.contains(dependency.name)) {
+        entry.referenced_records.push_back(dependency.name);
+      }
+    }
+    return;
+  }
+
+  std::string contents = ReadFileContents(entry.file.path);
+  for (const auto& [name, file] : records) {
+    if (contents.find(name) != std::string::npos) {
+      entry.referenced_records.push_back(name);
+    }
+  }
+  for (const auto& [name, file] : units) {
+    if (contents.find(name) != std::string::npos) {
+      entry.referenced_units.push_back(name);
+    }
+  }
+}
+
+// Marks `root` and every unit reachable from it as live. Returns the number of
+// bytes of units and records that became live as a result.
+uint64_t MarkLive(const std::string& root,
+                  absl::flat_hash_map<std::string, UnitEntry>& units,
+                  const absl::flat_hash_map<std::string, StoreFile>& records,
+                  absl::flat_hash_set<std::string>& live_units,
+                  absl::flat_hash_set<std::string>& live_records) {
+  uint64_t added_bytes = 0;
+  std::vector<std::string> worklist = {root};
+  while (!worklist.empty()) {
+    std::string name = std::move(worklist.back());
+    worklist.pop_back();
+    auto unit_it = units.find(name);
+    if (unit_it == units.end() || !live_units.insert(name).second) {
+      continue;
+    }
+    added_bytes += unit_it->second.file.size;
+    for (const std::string& record : unit_it->second.referenced_records) {
+      if (auto record_it = records.find(record);
+          record_it != records.end() && live_records.insert(record).second) {
+        added_bytes += record_it->second.size;
+      }
+    }
+    for (const std::string& unit : unit_it->second.referenced_units) {
+      worklist.push_back(unit);
+    }
+  }
+  return added_bytes;
+}
+
+// Deletes (or reports) a file, returning true if it was deleted or would have
+// been in dry-run mode.
+bool Prune(const StoreFile& file, const Options& options) {
+  if (options.verbose) {
+    std::cout << (options.dry_run ? "would prune " : "pruning ")
+              << file.path.string() << "\n";
+  }
+  if (options.dry_run) {
+    return true;
+  }
+  std::error_code ec;
+  std::filesystem::remove(file.path, ec);
+  if (ec && ec != std::errc::no_such_file_or_directory) {
+    std::cerr << "index_store_gc: could not remove " << file.path << " ("
+              << ec.message() << ")\n";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::optional<Options> parsed_options = ParseOptions(argc, argv);
+  if (!parsed_options.has_value()) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+  const Options& options = *parsed_options;
+
+  std::filesystem::path units_dir =
+      IndexStoreUnitsDirectory(options.store_path);
+  std::filesystem::path records_dir =
+      IndexStoreRecordsDirectory(options.store_path);
+  std::error_code ec;
+  if (!std::filesystem::is_directory(units_dir, ec)) {
+    std::cerr << "index_store_gc: " << options.store_path
+              << " does not look like an index store (missing " << units_dir
+              << ")\n";
+    return EXIT_FAILURE;
+  }
+
+  auto now = Clock::now();
+  auto grace_cutoff = now - options.grace_period;
+  std::optional<std::filesystem::file_time_type> age_cutoff;
+  if (options.max_age.has_value()) {
+    age_cutoff = now - *options.max_age;
+  }
+
+  absl::flat_hash_map<std::string, StoreFile> unit_files =
+      ListStoreFiles(units_dir, /*bucketed=*/false);
+  absl::flat_hash_map<std::string, StoreFile> records =
+      ListStoreFiles(records_dir, /*bucketed=*/true);
+
+  absl::flat_hash_map<std::string, UnitEntry> units;
+  size_t unparseable_units = 0;
+  for (auto& [name, file] : unit_files) {
+    UnitEntry entry;
+    entry.file = file;
+    entry.unit = bazel_rules_swift::ReadIndexUnit(file.path);
+    if (!entry.unit.has_value()) {
+      ++unparseable_units;
+    }
+    CollectReferences(entry, records, unit_files);
+    units[name] = std::move(entry);
+  }
+
+  // Decide which units are roots. Recently written units are always kept, and
+  // units we couldn't parse or that don't name an output file are kept since
+  // we can't tell whether what they describe still exists.
+  std::vector<std::string> protected_roots;
+  std::vector<std::string> roots;
+  for (const auto& [name, entry] : units) {
+    if (entry.file.mtime >= grace_cutoff || !entry.unit.has_value() ||
+        entry.unit->output_file.empty()) {
+      protected_roots.push_back(name);
+    } else if ((!age_cutoff.has_value() || entry.file.mtime >= *age_cutoff) &&
+               UnitOutputExists(*entry.unit, options)) {
+      roots.push_back(name);
+    }
+  }
+
+  // When there is a size budget, keep the most recently written roots first
+  // so that the least recently used ones are the ones that don't fit.
+  std::sort(roots.begin(), roots.end(),
+            [&](const std::string& lhs, const std::string& rhs) {
+              return units[lhs].file.mtime > units[rhs].file.mtime;
+            });
+
+  absl::flat_hash_set<std::string> live_units;
+  absl::flat_hash_set<std::string> live_records;
+  uint64_t live_bytes = 0;
+  for (const std::string& root : protected_roots) {
+    live_bytes += MarkLive(root, units, records, live_units, live_records);
+  }
+  for (const std::string& root : roots) {
+    if (options.max_size.has_value() && live_bytes >= *options.max_size) {
+      break;
+    }
+    live_bytes += MarkLive(root, units, records, live_units, live_records);
+  }
+
+  uint64_t pruned_unit_count = 0;
+  uint64_t pruned_unit_bytes = 0;
+  for (const auto& [name, entry] : units) {
+    if (live_units.contains(name) || entry.file.mtime >= grace_cutoff) {
+      continue;
+    }
+    if (Prune(entry.file, options)) {
+      ++pruned_unit_count;
+      pruned_unit_bytes += entry.file.size;
+    }
+  }
+
+  // Builds that ran while we were working may have written units that refer to
+  // records we haven't seen referenced yet (Clang reuses an existing record
+  // rather than rewriting it), so pick those up before deleting any records.
+  absl::flat_hash_map<std::string, StoreFile> new_unit_files =
+      ListStoreFiles(units_dir, /*bucketed=*/false);
+  for (auto& [name, file] : new_unit_files) {
+    if (auto it = unit_files.find(name);
+        it != unit_files.end() && it->second.mtime == file.mtime) {
+      continue;
+    }
+    UnitEntry entry;
+    entry.file = file;
+    entry.unit = bazel_rules_swift::ReadIndexUnit(file.path);
+    CollectReferences(entry, records, new_unit_files);
+    for (const std::string& record : entry.referenced_records) {
+      live_records.insert(record);
+    }
+  }
+
+  uint64_t pruned_record_count = 0;
+  uint64_t pruned_record_bytes = 0;
+  for (const auto& [name, file] : records) {
+    if (live_records.contains(name) || file.mtime >= grace_cutoff) {
+      continue;
+    }
+    if (Prune(file, options)) {
+      ++pruned_record_count;
+      pruned_record_bytes += file.size;
+    }
+  }
+
+  if (unparseable_units > 0) {
+    std::cerr << "index_store_gc: warning: kept " << unparseable_units
+              << " unit(s) that could not be parsed\n";
+  }
+  std::cout << (options.dry_run ? "Would prune " : "Pruned ")
+            << pruned_unit_count << " unit(s) (" << pruned_unit_bytes
+            << " bytes) and " << pruned_record_count << " record(s) ("
+            << pruned_record_bytes << " bytes); " << live_units.size()
+            << " unit(s) and " << live_records.size()
+            << " record(s) remain live (" << live_bytes << " bytes).\n";
+  return EXIT_SUCCESS;
+}
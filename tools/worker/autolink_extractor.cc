@@ -0,0 +1,427 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/worker/autolink_extractor.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "tools/common/path_utils.h"
+#include "tools/common/thread_pool.h"
+
+using bazel_rules_swift::Basename;
+using bazel_rules_swift::ThreadPool;
+
+namespace {
+
+// The section in which the Swift compiler records the linker flags that an
+// object file needs.
+constexpr absl::string_view kAutolinkSectionName = ".swift1_autolink_entries";
+
+// The flag that makes the driver behave as `swift-autolink-extract`.
+constexpr absl::string_view kDriverModeFlag =
+    "--driver-mode=swift-autolink-extract";
+
+// The Swift runtime libraries and common system libraries, which
+// `swift-autolink-extract` writes after every other flag, in this order,
+// rather than where they were first seen.
+constexpr absl::string_view kRuntimeLibrariesInOrder[] = {
+    "-lswiftSwiftOnoneSupport",
+    "-lswiftCore",
+    "-lswift_Concurrency",
+    "-lswift_StringProcessing",
+    "-lswift_RegexBuilder",
+    "-lswift_RegexParser",
+    "-lswift_Backtracing",
+    "-lswiftGlibc",
+    "-lBlocksRuntime",
+    "-ldispatch",
+    "-lDispatchStubs",
+    "-lswiftDispatch",
+    "-lCoreFoundation",
+    "-lFoundation",
+    "-lFoundationNetworking",
+    "-lFoundationXML",
+    "-lcurl",
+    "-lxml2",
+    "-luuid",
+    "-lXCTest",
+    "-licui18nswift",
+    "-licuucswift",
+    "-licudataswift",
+    "-lm",
+    "-lpthread",
+    "-lutil",
+    "-ldl",
+    "-lz",
+};
+
+#if !defined(_WIN32)
+
+// A file mapped read-only into memory.
+class MappedFile {
+ public:
+  // Maps the file at `path`, or returns nullptr if it can't be read.
+  static std::unique_ptr<MappedFile> Open(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return nullptr;
+    }
+    struct stat stat_buf;
+    if (fstat(fd, &stat_buf) != 0 || !S_ISREG(stat_buf.st_mode)) {
+      close(fd);
+      return nullptr;
+    }
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    if (stat_buf.st_size > 0) {
+      void* mapping =
+          mmap(nullptr, stat_buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+      }
+      file->mapping_ = mapping;
+      file->contents_ = absl::string_view(static_cast<const char*>(mapping),
+                                          stat_buf.st_size);
+    }
+    close(fd);
+    return file;
+  }
+
+  ~MappedFile() {
+    if (mapping_ != nullptr) {
+      munmap(mapping_, contents_.size());
+    }
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  absl::string_view contents() const { return contents_; }
+
+ private:
+  MappedFile() = default;
+
+  void* mapping_ = nullptr;
+  absl::string_view contents_;
+};
+
+// Reads the `size`-byte integer at `offset` in `data` into `value`. Returns
+// false if it is out of bounds.
+bool ReadInteger(absl::string_view data, uint64_t offset, size_t size,
+                 bool big_endian, uint64_t& value) {
+  if (offset > data.size() || data.size() - offset < size) {
+    return false;
+  }
+  value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    uint8_t byte = data[offset + (big_endian ? i : size - 1 - i)];
+    value = (value << 8) | byte;
+  }
+  return true;
+}
+
+// The parts of an ELF section header that are needed to find a section.
+struct ElfSection {
+  uint64_t name = 0;
+  uint64_t type = 0;
+  uint64_t flags = 0;
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  uint64_t link = 0;
+};
+
+// Appends the entries of the autolink section of the ELF object in `data` to
+// `entries`. Returns false if `data` isn't an ELF object that can be read.
+bool ExtractFromElf(absl::string_view data,
+                    std::vector<absl::string_view>& entries) {
+  constexpr uint64_t kSectionTypeNoBits = 8;
+  constexpr uint64_t kSectionFlagCompressed = 0x800;
+  constexpr uint64_t kExtendedSectionIndex = 0xffff;
+
+  if (!absl::StartsWith(data, "\x7f" "ELF") || data.size() < 6) {
+    return false;
+  }
+  bool is_64_bit = data[4] == 2;
+  bool big_endian = data[5] == 2;
+  if ((data[4] != 1 && data[4] != 2) || (data[5] != 1 && data[5] != 2)) {
+    return false;
+  }
+
+  uint64_t section_offset, section_entry_size, section_count, names_index;
+  size_t word = is_64_bit ? 8 : 4;
+  uint64_t header_fields = is_64_bit ? 0x3a : 0x2e;
+  if (!ReadInteger(data, is_64_bit ? 0x28 : 0x20, word, big_endian,
+                   section_offset) ||
+      !ReadInteger(data, header_fields, 2, big_endian, section_entry_size) ||
+      !ReadInteger(data, header_fields + 2, 2, big_endian, section_count) ||
+      !ReadInteger(data, header_fields + 4, 2, big_endian, names_index)) {
+    return false;
+  }
+  if (section_offset == 0) {
+    return true;
+  }
+  // Section headers are read in full below, so they can't be smaller than the
+  // ones the ELF format defines.
+  if (section_entry_size < (is_64_bit ? 0x40 : 0x28) ||
+      section_offset > data.size()) {
+    return false;
+  }
+
+  auto read_section = [&](uint64_t index, ElfSection& section) {
+    // The section count and index come from the object, so check that the
+    // header lies within it before computing its offset.
+    if (index > (data.size() - section_offset) / section_entry_size) {
+      return false;
+    }
+    uint64_t header = section_offset + index * section_entry_size;
+    if (is_64_bit) {
+      return ReadInteger(data, header, 4, big_endian, section.name) &&
+             ReadInteger(data, header + 4, 4, big_endian, section.type) &&
+             ReadInteger(data, header + 8, 8, big_endian, section.flags) &&
+             ReadInteger(data, header + 24, 8, big_endian, section.offset) &&
+             ReadInteger(data, header + 32, 8, big_endian, section.size) &&
+             ReadInteger(data, header + 40, 4, big_endian, section.link);
+    }
+    return ReadInteger(data, header, 4, big_endian, section.name) &&
+           ReadInteger(data, header + 4, 4, big_endian, section.type) &&
+           ReadInteger(data, header + 8, 4, big_endian, section.flags) &&
+           ReadInteger(data, header + 16, 4, big_endian, section.offset) &&
+           ReadInteger(data, header + 20, 4, big_endian, section.size) &&
+           ReadInteger(data, header + 24, 4, big_endian, section.link);
+  };
+  auto section_contents = [&](const ElfSection& section,
+                              absl::string_view& contents) {
+    if (section.type == kSectionTypeNoBits ||
+        section.offset > data.size() ||
+        data.size() - section.offset < section.size) {
+      return false;
+    }
+    contents = data.substr(section.offset, section.size);
+    return true;
+  };
+
+  // Objects with too many sections to count in the header keep the real count
+  // and the index of the section names in the first section header.
+  ElfSection first_section;
+  if (!read_section(0, first_section)) {
+    return false;
+  }
+  if (section_count == 0) {
+    section_count = first_section.size;
+  }
+  if (names_index == kExtendedSectionIndex) {
+    names_index = first_section.link;
+  }
+
+  ElfSection names_section;
+  absl::string_view names;
+  if (!read_section(names_index, names_section) ||
+      !section_contents(names_section, names)) {
+    return false;
+  }
+
+  for (uint64_t i = 1; i < section_count; ++i) {
+    ElfSection section;
+    if (!read_section(i, section) || section.name >= names.size()) {
+      return false;
+    }
+    absl::string_view name = names.substr(section.name);
+    name = name.substr(0, name.find('\0'));
+    if (name != kAutolinkSectionName) {
+      continue;
+    }
+    absl::string_view contents;
+    if ((section.flags & kSectionFlagCompressed) != 0 ||
+        !section_contents(section, contents)) {
+      return false;
+    }
+    for (absl::string_view entry :
+         absl::StrSplit(contents, '\0', absl::SkipEmpty())) {
+      entries.push_back(entry);
+    }
+  }
+  return true;
+}
+
+// Appends the autolink entries of every object in the archive in `data` to
+// `entries`. Returns false if the archive or any object in it can't be read.
+bool ExtractFromArchive(absl::string_view data,
+                        std::vector<absl::string_view>& entries) {
+  constexpr size_t kMagicSize = 8;
+  constexpr size_t kHeaderSize = 60;
+
+  uint64_t offset = kMagicSize;
+  while (offset < data.size()) {
+    if (data.size() - offset < kHeaderSize) {
+      return false;
+    }
+    absl::string_view header = data.substr(offset, kHeaderSize);
+    absl::string_view name = absl::StripTrailingAsciiWhitespace(
+        header.substr(0, 16));
+    uint64_t size;
+    if (header.substr(58, 2) != "`\n" ||
+        !absl::SimpleAtoi(absl::StripAsciiWhitespace(header.substr(48, 10)),
+                          &size) ||
+        data.size() - offset - kHeaderSize < size) {
+      return false;
+    }
+    absl::string_view member = data.substr(offset + kHeaderSize, size);
+    offset += kHeaderSize + size + (size % 2);
+
+    // Skip the symbol tables and the GNU table of long member names.
+    if (name == "/" || name == "/SYM64/" || name == "//" ||
+        name == "__.SYMDEF" || name == "__.SYMDEF SORTED") {
+      continue;
+    }
+
+    // BSD archives store long member names at the start of the member.
+    absl::string_view bsd_name_length = name;
+    if (absl::ConsumePrefix(&bsd_name_length, "#1/")) {
+      uint64_t name_length;
+      if (!absl::SimpleAtoi(bsd_name_length, &name_length) ||
+          name_length > member.size()) {
+        return false;
+      }
+      absl::string_view bsd_name = member.substr(0, name_length);
+      member.remove_prefix(name_length);
+      if (absl::StartsWith(bsd_name, "__.SYMDEF")) {
+        continue;
+      }
+    }
+
+    if (!ExtractFromElf(member, entries)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The autolink entries of one input.
+struct InputEntries {
+  std::unique_ptr<MappedFile> file;
+  std::vector<absl::string_view> entries;
+  bool succeeded = false;
+};
+
+// Reads the autolink entries of the object file or archive at `path`.
+void ExtractFromInput(const std::string& path, InputEntries& result) {
+  result.file = MappedFile::Open(path);
+  if (result.file == nullptr) {
+    return;
+  }
+  absl::string_view contents = result.file->contents();
+  if (absl::StartsWith(contents, "!<arch>\n")) {
+    result.succeeded = ExtractFromArchive(contents, result.entries);
+  } else {
+    result.succeeded = ExtractFromElf(contents, result.entries);
+  }
+}
+
+#endif
+
+}  // namespace
+
+bool UseNativeAutolinkExtract(const std::string& tool,
+                              const std::vector<std::string>& args) {
+#if defined(_WIN32)
+  return false;
+#else
+  if (Basename(tool) != "swift-autolink-extract" &&
+      std::find(args.begin(), args.end(), kDriverModeFlag) == args.end()) {
+    return false;
+  }
+  const char* setting = std::getenv("RULES_SWIFT_NATIVE_AUTOLINK_EXTRACT");
+  return setting == nullptr || std::strcmp(setting, "0") != 0;
+#endif
+}
+
+bool ExtractAutolinkEntries(const std::vector<std::string>& args) {
+#if defined(_WIN32)
+  return false;
+#else
+  std::vector<std::string> inputs;
+  std::string output_path;
+  for (auto it = args.begin(); it != args.end(); ++it) {
+    if (*it == kDriverModeFlag) {
+      continue;
+    } else if (*it == "-o" && it + 1 != args.end()) {
+      output_path = *++it;
+    } else if (absl::StartsWith(*it, "-")) {
+      return false;
+    } else {
+      inputs.push_back(*it);
+    }
+  }
+  if (output_path.empty()) {
+    return false;
+  }
+
+  std::vector<InputEntries> results(inputs.size());
+  ThreadPool::Shared().ParallelFor(inputs.size(), [&](size_t index) {
+    ExtractFromInput(inputs[index], results[index]);
+  });
+
+  absl::flat_hash_set<absl::string_view> runtime_libraries(
+      std::begin(kRuntimeLibrariesInOrder), std::end(kRuntimeLibrariesInOrder));
+  absl::flat_hash_set<absl::string_view> seen;
+  absl::flat_hash_set<absl::string_view> used_runtime_libraries;
+  std::string contents;
+  for (const InputEntries& result : results) {
+    if (!result.succeeded) {
+      return false;
+    }
+    for (absl::string_view entry : result.entries) {
+      if (runtime_libraries.contains(entry)) {
+        used_runtime_libraries.insert(entry);
+        continue;
+      }
+      if (seen.insert(entry).second) {
+        contents.append(entry.data(), entry.size());
+        contents.push_back('\n');
+      }
+    }
+  }
+  for (absl::string_view library : kRuntimeLibrariesInOrder) {
+    if (used_runtime_libraries.contains(library)) {
+      contents.append(library.data(), library.size());
+      contents.push_back('\n');
+    }
+  }
+
+  std::ofstream output(output_path, std::ios::binary | std::ios::trunc);
+  output.write(contents.data(), contents.size());
+  return output.good();
+#endif
+}
@@ -0,0 +1,41 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_AUTOLINK_EXTRACTOR_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_AUTOLINK_EXTRACTOR_H_
+
+#include <string>
+#include <vector>
+
+// Returns true if `tool` and `args` run `swift-autolink-extract` (directly or
+// through the driver's `--driver-mode=swift-autolink-extract`) and the worker
+// should perform the extraction itself rather than spawning it, which it does
+// unless `RULES_SWIFT_NATIVE_AUTOLINK_EXTRACT` is set to `0`.
+bool UseNativeAutolinkExtract(const std::string& tool,
+                              const std::vector<std::string>& args);
+
+// Does what `swift-autolink-extract` does for the given arguments, which are
+// the ELF object files and archives to read and `-o <output>`: writes the
+// linker flags in the `.swift1_autolink_entries` sections of the objects to the
+// output file, one per line. Flags appear in the order they were first seen,
+// once each, except that the Swift runtime libraries come last, in the order
+// the tool uses.
+//
+// Inputs are mapped into memory and read in parallel. Returns false without
+// writing anything if the arguments or any input aren't ones it understands
+// (for example, a thin archive or a non-ELF object), in which case the tool
+// should be run instead.
+bool ExtractAutolinkEntries(const std::vector<std::string>& args);
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_AUTOLINK_EXTRACTOR_H_
@@ -0,0 +1,108 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests for reading autolink entries in the worker. The inputs are objects and
+// archives made by `testdata/autolink/generate.sh`, and the expected outputs
+// are what `swift-autolink-extract` writes for the same inputs.
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "tools/common/test_support.h"
+#include "tools/worker/autolink_extractor.h"
+
+namespace {
+
+constexpr char kTestData[] = "tools/worker/testdata/autolink/";
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream stream(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(stream),
+                     std::istreambuf_iterator<char>());
+}
+
+// Returns the path of the test data file `name`.
+std::string TestData(const std::string& name) {
+  return std::string(kTestData) + name;
+}
+
+// Extracts the entries of the inputs in `args` into a new file and returns its
+// path, or an empty string if the worker declined to extract them.
+std::string Extract(const std::string& test_name,
+                    std::vector<std::string> args) {
+  std::filesystem::path directory =
+      bazel_rules_swift::testing::MakeTestDirectory(test_name);
+  std::string output = (directory / "out.autolink").string();
+  args.push_back("-o");
+  args.push_back(output);
+  if (!ExtractAutolinkEntries(args)) {
+    CHECK(!std::filesystem::exists(output));
+    return "";
+  }
+  return output;
+}
+
+void TestMatchesSwiftAutolinkExtract() {
+  // Objects of both byte orders and ELF classes, and a GNU archive with a long
+  // member name and a member without an autolink section.
+  std::string output =
+      Extract("autolink_extractor_test_gnu",
+              {TestData("le64.o"), TestData("libgnu.a"), TestData("be32.o")});
+  CHECK(!output.empty());
+  CHECK(ReadFile(output) == ReadFile(TestData("le64_libgnu_be32.autolink")));
+}
+
+void TestReadsBsdArchive() {
+  std::string output = Extract(
+      "autolink_extractor_test_bsd",
+      {"--driver-mode=swift-autolink-extract", TestData("libbsd.a")});
+  CHECK(!output.empty());
+  CHECK(ReadFile(output) == ReadFile(TestData("libbsd.autolink")));
+}
+
+void TestDeclinesWhatItDoesntUnderstand() {
+  // A thin archive names its members rather than containing them.
+  CHECK(Extract("autolink_extractor_test_thin", {TestData("libthin.a")})
+            .empty());
+  CHECK(Extract("autolink_extractor_test_text",
+                {TestData("le64.o"), TestData("generate.sh")})
+            .empty());
+  CHECK(Extract("autolink_extractor_test_missing",
+                {TestData("le64.o"), TestData("missing.o")})
+            .empty());
+  CHECK(Extract("autolink_extractor_test_flag",
+                {"-some-flag", TestData("le64.o")})
+            .empty());
+  CHECK(!ExtractAutolinkEntries({TestData("le64.o")}));
+}
+
+void TestUseNativeAutolinkExtract() {
+  CHECK(UseNativeAutolinkExtract("/usr/bin/swift-autolink-extract", {}));
+  CHECK(UseNativeAutolinkExtract(
+      "swiftc", {"--driver-mode=swift-autolink-extract", "a.o"}));
+  CHECK(!UseNativeAutolinkExtract("swiftc", {"a.o"}));
+}
+
+}  // namespace
+
+int main() {
+  TestMatchesSwiftAutolinkExtract();
+  TestReadsBsdArchive();
+  TestDeclinesWhatItDoesntUnderstand();
+  TestUseNativeAutolinkExtract();
+  return bazel_rules_swift::testing::TestExitCode();
+}
@@ -17,6 +17,7 @@
 #include <iostream>
 #include <optional>
 
+#include "tools/common/directory_reaper.h"
 #include "tools/worker/work_processor.h"
 #include "tools/worker/worker_protocol.h"
 
@@ -80,6 +81,10 @@ int CompileWithWorker(const std::vector<std::string>& args,
   // tool itself (i.e., "swiftc").
   WorkProcessor swift_worker(args, index_import_path);
 
+  // Temporary directories are deleted in the background between requests,
+  // rather than on the way to each response.
+  bazel_rules_swift::DirectoryReaper::Shared().Start();
+
   while (true) {
     std::optional<bazel_rules_swift::worker_protocol::WorkRequest> request =
         bazel_rules_swift::worker_protocol::ReadWorkRequest(std::cin);
@@ -0,0 +1,121 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/worker/file_snapshot.h"
+
+#include <sys/stat.h>
+
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+
+#include "tools/common/file_digest.h"
+#include "tools/common/file_system.h"
+
+using bazel_rules_swift::DigestFile;
+using bazel_rules_swift::LongPath;
+
+FileSnapshotCache& FileSnapshotCache::Shared() {
+  static FileSnapshotCache* cache = new FileSnapshotCache();
+  return *cache;
+}
+
+std::optional<FileSnapshot> FileSnapshotCache::Stat(
+    const std::filesystem::path& path) {
+  FileSnapshot snapshot;
+  std::error_code ec;
+  snapshot.size = std::filesystem::file_size(LongPath(path), ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  snapshot.mtime = std::filesystem::last_write_time(LongPath(path), ec);
+  if (ec) {
+    return std::nullopt;
+  }
+#if !defined(_WIN32)
+  struct stat stats;
+  if (stat(path.c_str(), &stats) == 0) {
+    snapshot.device = stats.st_dev;
+    snapshot.inode = stats.st_ino;
+  }
+#endif
+  return snapshot;
+}
+
+std::optional<FileSnapshot> FileSnapshotCache::Snapshot(
+    const std::filesystem::path& path) {
+  std::optional<FileSnapshot> current = Stat(path);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!current.has_value()) {
+      snapshots_.erase(path.string());
+      return std::nullopt;
+    }
+    auto it = snapshots_.find(path.string());
+    if (it != snapshots_.end() && it->second.SameFileAs(*current)) {
+      return it->second;
+    }
+  }
+
+  // Hash without holding the lock so that files can be hashed concurrently.
+  std::optional<uint64_t> digest = DigestFile(path);
+  if (!digest.has_value()) {
+    return std::nullopt;
+  }
+  current->digest = *digest;
+  std::lock_guard<std::mutex> lock(mutex_);
+  snapshots_[path.string()] = *current;
+  return current;
+}
+
+bool FileSnapshotCache::HaveSameContents(const std::filesystem::path& a,
+                                         const std::filesystem::path& b) {
+  std::optional<FileSnapshot> a_stat = Stat(a);
+  std::optional<FileSnapshot> b_stat = Stat(b);
+  if (!a_stat.has_value() || !b_stat.has_value() ||
+      a_stat->size != b_stat->size) {
+    return false;
+  }
+  if (a_stat->SameFileAs(*b_stat)) {
+    return true;
+  }
+  std::optional<FileSnapshot> a_snapshot = Snapshot(a);
+  std::optional<FileSnapshot> b_snapshot = Snapshot(b);
+  return a_snapshot.has_value() && b_snapshot.has_value() &&
+         a_snapshot->SameContentsAs(*b_snapshot);
+}
+
+void FileSnapshotCache::RecordCopy(const std::filesystem::path& from,
+                                   const std::filesystem::path& to) {
+  std::optional<FileSnapshot> source = Stat(from);
+  std::optional<FileSnapshot> destination = Stat(to);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!destination.has_value()) {
+    snapshots_.erase(to.string());
+    return;
+  }
+
+  // Only trust the source's digest if it is still describing the same file.
+  auto it = snapshots_.find(from.string());
+  if (!source.has_value() || it == snapshots_.end() ||
+      !it->second.SameFileAs(*source) ||
+      destination->size != it->second.size) {
+    snapshots_.erase(to.string());
+    return;
+  }
+  destination->digest = it->second.digest;
+  snapshots_[to.string()] = *destination;
+}
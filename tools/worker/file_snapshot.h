@@ -0,0 +1,86 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_FILE_SNAPSHOT_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_FILE_SNAPSHOT_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+
+// The state of a file at the time it was looked at.
+struct FileSnapshot {
+  uintmax_t size = 0;
+  std::filesystem::file_time_type mtime;
+
+  // The device and inode of the file, or zero where the platform doesn't
+  // report them. Two paths with the same nonzero identity are the same file.
+  uint64_t device = 0;
+  uint64_t inode = 0;
+
+  // The XXH64 digest of the file's contents.
+  uint64_t digest = 0;
+
+  // Returns true if `other` was taken of the same, unmodified file.
+  bool SameFileAs(const FileSnapshot& other) const {
+    return inode != 0 && device == other.device && inode == other.inode &&
+           size == other.size && mtime == other.mtime;
+  }
+
+  // Returns true if `other` has the same contents as this file.
+  bool SameContentsAs(const FileSnapshot& other) const {
+    return size == other.size && digest == other.digest;
+  }
+};
+
+// Remembers the digests of files that the worker has seen, so that a file only
+// has to be read again when its size, modification time, or identity changes.
+//
+// A single cache is shared by every request that a worker handles; most files
+// in the incremental storage area are untouched from one compile to the next,
+// so after the first build of a module only the files the compiler rewrote are
+// hashed again.
+class FileSnapshotCache {
+ public:
+  // Returns the cache shared by the whole process.
+  static FileSnapshotCache& Shared();
+
+  // Returns a snapshot of the file at `path`, or nullopt if it doesn't exist or
+  // can't be read.
+  std::optional<FileSnapshot> Snapshot(const std::filesystem::path& path);
+
+  // Returns true if the files at `a` and `b` have the same contents. The files
+  // are only hashed if they have the same size and aren't the same file.
+  bool HaveSameContents(const std::filesystem::path& a,
+                        const std::filesystem::path& b);
+
+  // Records that `to` was just created as a copy of `from`, so that its digest
+  // doesn't have to be computed by reading it back.
+  void RecordCopy(const std::filesystem::path& from,
+                  const std::filesystem::path& to);
+
+  // Returns the size, modification time, and identity of the file at `path`,
+  // without its digest, or nullopt if it doesn't exist.
+  static std::optional<FileSnapshot> Stat(const std::filesystem::path& path);
+
+ private:
+  std::mutex mutex_;
+  absl::flat_hash_map<std::string, FileSnapshot> snapshots_;
+};
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_FILE_SNAPSHOT_H_
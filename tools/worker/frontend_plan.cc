@@ -0,0 +1,273 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/worker/frontend_plan.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_replace.h"
+#include "tools/common/file_digest.h"
+#include "tools/common/process.h"
+
+namespace {
+
+// How many times a frontend command is reused before it is checked against a
+// fresh plan from the driver.
+constexpr uint32_t kValidationInterval = 50;
+
+// The number of invocations whose plans are remembered.
+constexpr size_t kMaxPlans = 256;
+
+// Stands for the per-request module cache directory in invocation keys and
+// cached frontend commands.
+constexpr char kModuleCachePlaceholder[] = "__RULES_SWIFT_MODULE_CACHE__";
+
+// Returns the arguments with every occurrence of `path` replaced by `with`, or
+// the arguments unchanged if `path` is empty.
+std::vector<std::string> ReplacePath(const std::vector<std::string>& args,
+                                     const std::string& path,
+                                     const std::string& with) {
+  if (path.empty()) {
+    return args;
+  }
+  std::vector<std::string> replaced;
+  replaced.reserve(args.size());
+  for (const std::string& arg : args) {
+    replaced.push_back(absl::StrReplaceAll(arg, {{path, with}}));
+  }
+  return replaced;
+}
+
+// Splits a command printed by the driver into its arguments.
+std::vector<std::string> TokenizeShellLine(const std::string& line) {
+  std::vector<std::string> tokens;
+  std::string token;
+  bool in_quotes = false;
+  for (size_t i = 0; i < line.size(); ++i) {
+    char c = line[i];
+    if (c == '\\' && i + 1 < line.size()) {
+      token.push_back(line[i + 1]);
+      ++i;
+      continue;
+    }
+    if (c == '"') {
+      in_quotes = !in_quotes;
+      continue;
+    }
+    if (!in_quotes && (c == ' ' || c == '\t')) {
+      if (!token.empty()) {
+        tokens.push_back(std::move(token));
+        token.clear();
+      }
+      continue;
+    }
+    if (!in_quotes && c == '#' && token.empty()) {
+      break;
+    }
+    token.push_back(c);
+  }
+  if (!token.empty()) {
+    tokens.push_back(std::move(token));
+  }
+  return tokens;
+}
+
+// Returns true if the frontend command refers to files that the driver creates
+// only for the jobs it runs itself, and deletes when it exits.
+bool UsesDriverTemporaryFiles(const std::vector<std::string>& command) {
+  for (const std::string& arg : command) {
+    if (absl::StartsWith(arg, "@") || absl::EndsWith(arg, "-filelist") ||
+        arg == "-supplementary-output-file-map") {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+std::optional<std::vector<std::vector<std::string>>> CaptureDriverJobs(
+    const std::vector<std::string>& spawn_args,
+    std::map<std::string, std::string>* env, std::ostream* stderr_stream,
+    const std::string& error_prefix, int& exit_code) {
+  std::vector<std::string> driver_args = spawn_args;
+  driver_args.push_back("-###");
+
+  std::stringstream sink;
+  exit_code =
+      RunSubProcess(driver_args, env, &sink, /*stdout_to_stderr=*/true);
+  std::string captured = sink.str();
+  if (exit_code != 0) {
+    (*stderr_stream) << "error: " << error_prefix << ": swiftc -### exited "
+                     << exit_code << ":\n"
+                     << captured;
+    return std::nullopt;
+  }
+
+  std::vector<std::vector<std::string>> jobs;
+  std::string line;
+  std::istringstream lines(captured);
+  while (std::getline(lines, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    std::vector<std::string> tokens = TokenizeShellLine(line);
+    if (!tokens.empty()) {
+      jobs.push_back(std::move(tokens));
+    }
+  }
+  if (jobs.empty()) {
+    (*stderr_stream) << "error: " << error_prefix
+                     << ": could not parse frontend command from:\n"
+                     << captured;
+    exit_code = 1;
+    return std::nullopt;
+  }
+  return jobs;
+}
+
+DriverBypass& DriverBypass::Shared() {
+  static DriverBypass* bypass = new DriverBypass();
+  return *bypass;
+}
+
+bool DriverBypass::Enabled() {
+  const char* value = std::getenv("RULES_SWIFT_DRIVER_BYPASS");
+  return value != nullptr && std::string(value) == "1";
+}
+
+std::optional<std::vector<std::string>> DriverBypass::FrontendCommand(
+    const std::vector<std::string>& spawn_args,
+    const std::vector<std::string>& tool_args,
+    const std::vector<std::string>& args,
+    const std::string& module_cache_path,
+    std::map<std::string, std::string>* env) {
+  std::optional<std::string> key =
+      InvocationKey(tool_args, ReplacePath(args, module_cache_path,
+                                           kModuleCachePlaceholder));
+  if (!key.has_value()) {
+    return std::nullopt;
+  }
+
+  std::optional<std::vector<std::string>> previous_command;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = plans_.find(*key);
+    if (it != plans_.end()) {
+      Plan& plan = it->second;
+      plan.last_use = ++use_counter_;
+      if (!plan.command.has_value()) {
+        return std::nullopt;
+      }
+      if (++plan.uses_since_validation < kValidationInterval) {
+        return ReplacePath(*plan.command, kModuleCachePlaceholder,
+                           module_cache_path);
+      }
+      previous_command = plan.command;
+    }
+  }
+
+  std::optional<std::vector<std::string>> command =
+      PlanFromDriver(spawn_args, env);
+  if (!command.has_value()) {
+    Put(*key, Plan{std::nullopt});
+    return std::nullopt;
+  }
+  std::vector<std::string> cached_command =
+      ReplacePath(*command, module_cache_path, kModuleCachePlaceholder);
+  if (previous_command.has_value() && cached_command != *previous_command) {
+    std::cerr << "swift_worker: The driver's plan for a bypassed invocation "
+              << "changed; replacing the cached frontend command\n";
+  }
+  Put(*key, Plan{std::move(cached_command)});
+  return command;
+}
+
+std::optional<std::string> DriverBypass::InvocationKey(
+    const std::vector<std::string>& tool_args,
+    const std::vector<std::string>& args) {
+  std::string key;
+  const char* developer_dir = std::getenv("DEVELOPER_DIR");
+  if (developer_dir != nullptr) {
+    key += developer_dir;
+  }
+  key += '\0';
+  for (const std::string& arg : tool_args) {
+    key += arg;
+    key += '\0';
+  }
+
+  // The driver reads these files while planning, so the plan depends on their
+  // contents as well as their paths.
+  for (size_t i = 0; i < args.size(); ++i) {
+    key += args[i];
+    key += '\0';
+    if ((args[i] == "-output-file-map" ||
+         args[i] == "-explicit-swift-module-map-file") &&
+        i + 1 < args.size()) {
+      std::optional<uint64_t> digest =
+          bazel_rules_swift::DigestFile(args[i + 1]);
+      if (!digest.has_value()) {
+        return std::nullopt;
+      }
+      key += std::to_string(*digest);
+      key += '\0';
+    }
+  }
+  return key;
+}
+
+std::optional<std::vector<std::string>> DriverBypass::PlanFromDriver(
+    const std::vector<std::string>& spawn_args,
+    std::map<std::string, std::string>* env) {
+  // Failures are reported by the driver when it is run as usual.
+  std::ostringstream ignored;
+  int exit_code;
+  std::optional<std::vector<std::vector<std::string>>> jobs =
+      CaptureDriverJobs(spawn_args, env, &ignored, "driver-bypass", exit_code);
+  if (!jobs.has_value() || jobs->size() != 1) {
+    return std::nullopt;
+  }
+  std::vector<std::string>& command = jobs->front();
+  if (command.size() < 2 || command[1] != "-frontend" ||
+      UsesDriverTemporaryFiles(command)) {
+    return std::nullopt;
+  }
+  return std::move(command);
+}
+
+void DriverBypass::Put(const std::string& key, Plan plan) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  plan.last_use = ++use_counter_;
+  plans_[key] = std::move(plan);
+  if (plans_.size() > kMaxPlans) {
+    auto oldest = plans_.begin();
+    for (auto it = plans_.begin(); it != plans_.end(); ++it) {
+      if (it->second.last_use < oldest->second.last_use) {
+        oldest = it;
+      }
+    }
+    plans_.erase(oldest);
+  }
+}
@@ -0,0 +1,114 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_FRONTEND_PLAN_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_FRONTEND_PLAN_H_
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+// Runs the driver command line in `spawn_args` with `-###` appended, so that
+// it prints the commands of the jobs it plans without running them, and
+// returns each job's command split into arguments.
+//
+// Returns nothing if the driver fails or prints nothing that can be parsed,
+// after describing the failure in `stderr_stream` (prefixed with
+// `error_prefix`); `exit_code` is set to the driver's exit code, or 1 if its
+// output couldn't be parsed.
+std::optional<std::vector<std::vector<std::string>>> CaptureDriverJobs(
+    const std::vector<std::string>& spawn_args,
+    std::map<std::string, std::string>* env, std::ostream* stderr_stream,
+    const std::string& error_prefix, int& exit_code);
+
+// Launches `swift-frontend` directly for invocations whose driver plan is a
+// single frontend job, skipping the driver's startup and job planning.
+//
+// This is opt-in, with `RULES_SWIFT_DRIVER_BYPASS=1`. The frontend command is
+// captured from the driver (with `-###`) the first time an exact invocation is
+// seen, and reused when the same invocation (with the same contents of the
+// files the driver reads) comes again, which is common while a module is
+// rebuilt during development. Every so often, a reused command is checked
+// against a fresh plan from the driver, and replaced if the driver's plan has
+// drifted (for example, because the toolchain changed under the worker).
+class DriverBypass {
+ public:
+  // Returns the bypass shared by the whole process.
+  static DriverBypass& Shared();
+
+  // Returns true if the bypass has been enabled in the environment.
+  static bool Enabled();
+
+  DriverBypass(const DriverBypass&) = delete;
+  DriverBypass& operator=(const DriverBypass&) = delete;
+
+  // Returns the frontend command that the driver would run for the invocation
+  // with the given `spawn_args`, which runs the driver `tool_args` with `args`
+  // (possibly through response files). Returns nothing if the driver plans
+  // anything other than a single frontend job, or if the plan couldn't be
+  // determined, in which case the driver should be run as usual.
+  //
+  // `module_cache_path`, if not empty, is a module cache directory created for
+  // this request alone. It is left out of the invocation's key and the cached
+  // command, so that the plan is reused by later requests with their own
+  // directories.
+  std::optional<std::vector<std::string>> FrontendCommand(
+      const std::vector<std::string>& spawn_args,
+      const std::vector<std::string>& tool_args,
+      const std::vector<std::string>& args,
+      const std::string& module_cache_path,
+      std::map<std::string, std::string>* env);
+
+ private:
+  struct Plan {
+    // The frontend command, or nothing if the driver's plan for the invocation
+    // can't be bypassed.
+    std::optional<std::vector<std::string>> command;
+
+    // The number of times the command has been reused since it was last
+    // checked against the driver.
+    uint32_t uses_since_validation = 0;
+
+    uint64_t last_use = 0;
+  };
+
+  DriverBypass() = default;
+
+  // Returns the key of the invocation, or nothing if one of the files that the
+  // driver reads couldn't be read.
+  static std::optional<std::string> InvocationKey(
+      const std::vector<std::string>& tool_args,
+      const std::vector<std::string>& args);
+
+  // Asks the driver for its plan and returns the frontend command, if the plan
+  // is a single frontend job that can be run without the driver.
+  static std::optional<std::vector<std::string>> PlanFromDriver(
+      const std::vector<std::string>& spawn_args,
+      std::map<std::string, std::string>* env);
+
+  // Stores `plan` for `key`, making room for it if necessary.
+  void Put(const std::string& key, Plan plan);
+
+  std::mutex mutex_;
+  absl::flat_hash_map<std::string, Plan> plans_;
+  uint64_t use_counter_ = 0;
+};
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_FRONTEND_PLAN_H_
@@ -0,0 +1,164 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/worker/incremental_manifest.h"
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "tools/common/file_system.h"
+#include "tools/worker/file_snapshot.h"
+
+using bazel_rules_swift::LongPath;
+
+namespace {
+
+// The first line of every manifest. Bump the version if the format changes so
+// that older manifests are ignored rather than misread.
+constexpr char kManifestHeader[] = "rules_swift incremental manifest v1";
+
+int64_t MtimeTicks(const FileSnapshot& snapshot) {
+  return snapshot.mtime.time_since_epoch().count();
+}
+
+}  // namespace
+
+bool IncrementalManifest::ReadFromPath(const std::string& path) {
+  generation_ = 0;
+  entries_.clear();
+
+  std::ifstream stream(LongPath(path));
+  std::string line;
+  if (!std::getline(stream, line) || line != kManifestHeader) {
+    return false;
+  }
+  if (!std::getline(stream, line) ||
+      sscanf(line.c_str(), "generation %" SCNu64, &generation_) != 1) {
+    return false;
+  }
+
+  // Each entry is "<digest> <size> <mtime> <generation> <path>"; the path is
+  // last so that it may contain spaces.
+  while (std::getline(stream, line)) {
+    Entry entry;
+    uintmax_t size;
+    int consumed = 0;
+    if (sscanf(line.c_str(),
+               "%" SCNx64 " %ju %" SCNd64 " %" SCNu64 " %n", &entry.digest,
+               &size, &entry.mtime, &entry.generation, &consumed) != 4 ||
+        consumed == 0 || static_cast<size_t>(consumed) >= line.size()) {
+      generation_ = 0;
+      entries_.clear();
+      return false;
+    }
+    entry.size = size;
+    entries_[line.substr(consumed)] = entry;
+  }
+  return true;
+}
+
+bool IncrementalManifest::WriteToPath(const std::string& path) const {
+  std::ostringstream contents;
+  contents << kManifestHeader << "\n";
+  contents << "generation " << generation_ << "\n";
+  for (const auto& [entry_path, entry] : entries_) {
+    char digest[17];
+    snprintf(digest, sizeof(digest), "%016" PRIx64, entry.digest);
+    contents << digest << " " << entry.size << " " << entry.mtime << " "
+             << entry.generation << " " << entry_path << "\n";
+  }
+
+  std::string temp_path = path + ".tmp";
+  {
+    std::ofstream stream(LongPath(temp_path), std::ios::trunc);
+    stream << contents.str();
+    if (!stream.good()) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(LongPath(temp_path), LongPath(path), ec);
+  if (ec) {
+    std::filesystem::remove(LongPath(temp_path), ec);
+    return false;
+  }
+  return true;
+}
+
+bool IncrementalManifest::Matches(const std::string& path,
+                                  FileSnapshotCache& cache) const {
+  std::optional<FileSnapshot> current = FileSnapshotCache::Stat(path);
+  auto it = entries_.find(path);
+  if (it == entries_.end()) {
+    return !current.has_value();
+  }
+  const Entry& entry = it->second;
+  if (!current.has_value() || current->size != entry.size) {
+    return false;
+  }
+  if (MtimeTicks(*current) == entry.mtime) {
+    return true;
+  }
+  std::optional<FileSnapshot> snapshot = cache.Snapshot(path);
+  return snapshot.has_value() && snapshot->digest == entry.digest;
+}
+
+void IncrementalManifest::Record(const std::vector<std::string>& paths,
+                                 FileSnapshotCache& cache) {
+  uint64_t generation = generation_ + 1;
+  std::map<std::string, Entry> entries;
+  for (const std::string& path : paths) {
+    std::optional<FileSnapshot> current = FileSnapshotCache::Stat(path);
+    if (!current.has_value()) {
+      continue;
+    }
+
+    // Files whose size and modification time haven't changed keep their entry
+    // (and generation) without being hashed again.
+    auto previous = entries_.find(path);
+    if (previous != entries_.end() && previous->second.size == current->size &&
+        previous->second.mtime == MtimeTicks(*current)) {
+      entries[path] = previous->second;
+      continue;
+    }
+
+    std::optional<FileSnapshot> snapshot = cache.Snapshot(path);
+    if (!snapshot.has_value()) {
+      continue;
+    }
+    Entry entry;
+    entry.digest = snapshot->digest;
+    entry.size = snapshot->size;
+    entry.mtime = MtimeTicks(*snapshot);
+    entry.generation = generation;
+    if (previous != entries_.end() &&
+        previous->second.digest == entry.digest &&
+        previous->second.size == entry.size) {
+      entry.generation = previous->second.generation;
+    }
+    entries[path] = entry;
+  }
+  generation_ = generation;
+  entries_ = std::move(entries);
+}
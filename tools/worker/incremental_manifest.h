@@ -0,0 +1,75 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_INCREMENTAL_MANIFEST_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_INCREMENTAL_MANIFEST_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tools/worker/file_snapshot.h"
+
+// Records the files that a module's incremental storage area held at the end
+// of its last compile, whether or not it succeeded, so that the next compile
+// can tell exactly which of them have since gone missing or changed (for
+// example, because a build was interrupted) instead of discarding the whole
+// area.
+//
+// Each compile that finishes starts a new generation. Every entry remembers the
+// generation in which its contents last changed.
+class IncrementalManifest {
+ public:
+  struct Entry {
+    uint64_t digest = 0;
+    uintmax_t size = 0;
+
+    // The file's modification time, in `file_time_type` ticks. A file whose
+    // size and modification time both match is assumed not to have changed
+    // without hashing it.
+    int64_t mtime = 0;
+
+    uint64_t generation = 0;
+  };
+
+  // Reads the manifest at `path`. Returns false if it doesn't exist or can't
+  // be parsed, in which case nothing about the storage area is known.
+  bool ReadFromPath(const std::string& path);
+
+  // Writes the manifest to `path`, replacing any existing one atomically.
+  // Returns false if it could not be written.
+  bool WriteToPath(const std::string& path) const;
+
+  // Returns true if the file at `path` is in the state the manifest recorded:
+  // either it matches its entry, or it has no entry and doesn't exist.
+  bool Matches(const std::string& path, FileSnapshotCache& cache) const;
+
+  // Starts a new generation that records the current state of the files at
+  // `paths`, replacing all existing entries. Files that don't exist are left
+  // out.
+  void Record(const std::vector<std::string>& paths, FileSnapshotCache& cache);
+
+  // The generation of the last compile that finished.
+  uint64_t generation() const { return generation_; }
+
+  // The recorded files, keyed by path.
+  const std::map<std::string, Entry>& entries() const { return entries_; }
+
+ private:
+  uint64_t generation_ = 0;
+  std::map<std::string, Entry> entries_;
+};
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_INCREMENTAL_MANIFEST_H_
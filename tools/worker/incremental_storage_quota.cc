@@ -0,0 +1,332 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/worker/incremental_storage_quota.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "tools/common/file_system.h"
+#include "tools/worker/incremental_manifest.h"
+
+using bazel_rules_swift::LongPath;
+
+namespace {
+
+constexpr char kBudgetEnv[] = "RULES_SWIFT_INCREMENTAL_STORAGE_BUDGET";
+
+// The extension of the manifest that identifies a module's stored state.
+constexpr char kManifestExtension[] = ".incremental_manifest";
+
+// How often the storage areas are rescanned. Scanning walks every module's
+// storage directory, so it shouldn't happen on every request.
+constexpr std::chrono::seconds kScanInterval = std::chrono::minutes(1);
+
+// Modules used more recently than this are never evicted, even if the
+// in-flight lock can't be checked (for example, on Windows).
+constexpr std::chrono::seconds kGracePeriod = std::chrono::minutes(10);
+
+// The stored state of one module. With split derived file generation, a
+// module has a manifest in each storage area; both are kept or evicted
+// together.
+struct ModuleState {
+  std::vector<std::string> manifest_paths;
+  std::filesystem::file_time_type last_use;
+  uintmax_t size = 0;
+  std::vector<std::string> files;
+};
+
+// Parses a size like "1048576", "512M", or "20G".
+std::optional<uintmax_t> ParseSize(absl::string_view value) {
+  uintmax_t multiplier = 1;
+  if (absl::ConsumeSuffix(&value, "G")) {
+    multiplier = uintmax_t{1} << 30;
+  } else if (absl::ConsumeSuffix(&value, "M")) {
+    multiplier = uintmax_t{1} << 20;
+  } else if (absl::ConsumeSuffix(&value, "K")) {
+    multiplier = uintmax_t{1} << 10;
+  }
+  uint64_t amount;
+  if (!absl::SimpleAtoi(value, &amount)) {
+    return std::nullopt;
+  }
+  return amount * multiplier;
+}
+
+// Returns the storage area directory that contains `path`, or an empty string
+// if it isn't in one.
+std::string StorageRoot(const std::string& path) {
+  for (const char* area :
+       {"/_swift_incremental_derived/", "/_swift_incremental/"}) {
+    size_t index = path.find(area);
+    if (index != std::string::npos) {
+      return path.substr(0, index + strlen(area) - 1);
+    }
+  }
+  return "";
+}
+
+// Returns the key shared by the manifests of the compile and derived file
+// requests of the same module: the compile request's manifest path.
+std::string ModuleKey(const std::string& manifest_path) {
+  return IncrementalStorageQuota::SiblingManifestPath(manifest_path, false);
+}
+
+#if !defined(_WIN32)
+// Opens the lock file that guards the module whose manifest is at
+// `manifest_path`. Lock files are never deleted, so that every process that
+// opens one is locking the same inode.
+int OpenLockFile(const std::string& manifest_path) {
+  return open((manifest_path + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC,
+              0644);
+}
+#endif
+
+// Adds the stored state of every module in `root` to `modules`, keyed by
+// `ModuleKey`.
+void ScanStorageRoot(const std::string& root,
+                     std::map<std::string, ModuleState>& modules) {
+  std::error_code ec;
+  std::filesystem::recursive_directory_iterator it(
+      LongPath(root),
+      std::filesystem::directory_options::skip_permission_denied, ec);
+  for (; !ec && it != std::filesystem::recursive_directory_iterator();
+       it.increment(ec)) {
+    std::string path = it->path().string();
+    if (!absl::EndsWith(path, kManifestExtension)) {
+      continue;
+    }
+    IncrementalManifest manifest;
+    if (!manifest.ReadFromPath(path)) {
+      continue;
+    }
+    std::filesystem::file_time_type last_use =
+        std::filesystem::last_write_time(it->path(), ec);
+    if (ec) {
+      ec.clear();
+      continue;
+    }
+    ModuleState& state = modules[ModuleKey(path)];
+    if (state.manifest_paths.empty() || state.last_use < last_use) {
+      state.last_use = last_use;
+    }
+    state.manifest_paths.push_back(path);
+    for (const auto& [file, entry] : manifest.entries()) {
+      state.size += entry.size;
+      state.files.push_back(file);
+    }
+  }
+}
+
+}  // namespace
+
+IncrementalStorageQuota::Lease::Lease(IncrementalStorageQuota* quota,
+                                      std::string manifest_path)
+    : quota_(quota), manifest_path_(std::move(manifest_path)) {
+#if !defined(_WIN32)
+  std::error_code ec;
+  std::filesystem::create_directories(
+      std::filesystem::path(manifest_path_).parent_path(), ec);
+  lock_fd_ = OpenLockFile(manifest_path_);
+  if (lock_fd_ >= 0) {
+    // Waits for an eviction of this module in another worker to finish.
+    flock(lock_fd_, LOCK_SH);
+  }
+#endif
+}
+
+IncrementalStorageQuota::Lease::~Lease() {
+#if !defined(_WIN32)
+  if (lock_fd_ >= 0) close(lock_fd_);
+#endif
+  std::lock_guard<std::mutex> lock(quota_->mutex_);
+  auto it = quota_->in_flight_.find(manifest_path_);
+  if (it != quota_->in_flight_.end()) {
+    quota_->in_flight_.erase(it);
+  }
+}
+
+IncrementalStorageQuota::IncrementalStorageQuota() {
+  const char* budget = std::getenv(kBudgetEnv);
+  if (budget != nullptr && budget[0] != '\0') {
+    budget_ = ParseSize(budget);
+  }
+}
+
+IncrementalStorageQuota& IncrementalStorageQuota::Shared() {
+  static IncrementalStorageQuota* quota = new IncrementalStorageQuota();
+  return *quota;
+}
+
+std::string IncrementalStorageQuota::SiblingManifestPath(
+    const std::string& manifest_path, bool derived) {
+  std::string path = manifest_path;
+  const char* from_area =
+      derived ? "/_swift_incremental/" : "/_swift_incremental_derived/";
+  const char* to_area =
+      derived ? "/_swift_incremental_derived/" : "/_swift_incremental/";
+  const char* from_map =
+      derived ? ".output_file_map." : ".derived_output_file_map.";
+  const char* to_map =
+      derived ? ".derived_output_file_map." : ".output_file_map.";
+  size_t index = path.find(from_area);
+  if (index != std::string::npos) {
+    path.replace(index, strlen(from_area), to_area);
+  }
+  index = path.rfind(from_map);
+  if (index != std::string::npos &&
+      path.find('/', index) == std::string::npos) {
+    path.replace(index, strlen(from_map), to_map);
+  }
+  return path;
+}
+
+std::unique_ptr<IncrementalStorageQuota::Lease>
+IncrementalStorageQuota::Acquire(const std::string& manifest_path) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_flight_.insert(manifest_path);
+    std::string root = StorageRoot(manifest_path);
+    if (!root.empty()) {
+      roots_.insert(root);
+    }
+  }
+  return std::unique_ptr<Lease>(new Lease(this, manifest_path));
+}
+
+void IncrementalStorageQuota::MaybeEvict(std::ostream* log) {
+  std::vector<std::string> roots;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    if (!budget_.has_value() ||
+        (scanned_ && now - last_scan_ < kScanInterval)) {
+      return;
+    }
+    scanned_ = true;
+    last_scan_ = now;
+    roots.assign(roots_.begin(), roots_.end());
+  }
+
+  std::map<std::string, ModuleState> modules_by_key;
+  for (const std::string& root : roots) {
+    ScanStorageRoot(root, modules_by_key);
+  }
+  std::vector<ModuleState> modules;
+  uintmax_t total_size = 0;
+  for (auto& [key, state] : modules_by_key) {
+    total_size += state.size;
+    modules.push_back(std::move(state));
+  }
+  if (total_size <= *budget_) {
+    return;
+  }
+
+  std::sort(modules.begin(), modules.end(),
+            [](const ModuleState& a, const ModuleState& b) {
+              return a.last_use < b.last_use;
+            });
+
+  auto grace_cutoff =
+      std::filesystem::file_time_type::clock::now() - kGracePeriod;
+  size_t evicted_modules = 0;
+  uintmax_t evicted_bytes = 0;
+  for (const ModuleState& state : modules) {
+    if (total_size <= *budget_) {
+      break;
+    }
+    if (state.last_use >= grace_cutoff) {
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (std::any_of(state.manifest_paths.begin(), state.manifest_paths.end(),
+                      [this](const std::string& manifest_path) {
+                        return in_flight_.count(manifest_path) != 0;
+                      })) {
+        continue;
+      }
+    }
+
+#if !defined(_WIN32)
+    // Another worker holds a shared lock on modules it is compiling.
+    std::vector<int> lock_fds;
+    bool locked = true;
+    for (const std::string& manifest_path : state.manifest_paths) {
+      int lock_fd = OpenLockFile(manifest_path);
+      if (lock_fd < 0) {
+        locked = false;
+        break;
+      }
+      lock_fds.push_back(lock_fd);
+      if (flock(lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        locked = false;
+        break;
+      }
+    }
+    if (!locked) {
+      for (int lock_fd : lock_fds) close(lock_fd);
+      continue;
+    }
+#endif
+
+    // Remove the manifests first, so that a module whose eviction is
+    // interrupted is rebuilt from scratch rather than trusted.
+    std::error_code ec;
+    for (const std::string& manifest_path : state.manifest_paths) {
+      if (!ec) std::filesystem::remove(LongPath(manifest_path), ec);
+    }
+    if (!ec) {
+      for (const std::string& file : state.files) {
+        std::filesystem::remove(LongPath(file), ec);
+      }
+      total_size -= std::min(total_size, state.size);
+      evicted_bytes += state.size;
+      ++evicted_modules;
+    }
+
+#if !defined(_WIN32)
+    for (int lock_fd : lock_fds) close(lock_fd);
+#endif
+  }
+
+  if (log != nullptr && evicted_modules > 0) {
+    (*log) << "swift_worker: Evicted the incremental state of "
+           << evicted_modules << " modules (" << evicted_bytes
+           << " bytes) to stay within the " << *budget_ << "-byte budget\n";
+  }
+}
@@ -0,0 +1,92 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_INCREMENTAL_STORAGE_QUOTA_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_INCREMENTAL_STORAGE_QUOTA_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <string>
+
+// Keeps the incremental storage areas (`_swift_incremental` and
+// `_swift_incremental_derived`) under a byte budget by evicting the state of
+// the modules that were compiled least recently.
+//
+// The budget is read from `RULES_SWIFT_INCREMENTAL_STORAGE_BUDGET` (a byte
+// count with an optional `K`, `M`, or `G` suffix); without it, nothing is
+// evicted. A module's state is the set of files listed in its incremental
+// manifest, and its last use is the manifest's modification time. Evicting a
+// module only costs a full rebuild of that module the next time it compiles.
+//
+// With split derived file generation, the compile and derived file requests of
+// a module keep separate manifests in the two storage areas. They are treated
+// as one module: both are evicted together, and neither is evicted while the
+// other is in flight, so the areas never disagree about which modules they
+// hold.
+class IncrementalStorageQuota {
+ public:
+  // Marks a module as in flight for as long as it is alive. Modules that are
+  // in flight, in this worker or any other, are never evicted.
+  class Lease {
+   public:
+    ~Lease();
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+   private:
+    friend class IncrementalStorageQuota;
+    Lease(IncrementalStorageQuota* quota, std::string manifest_path);
+
+    IncrementalStorageQuota* quota_;
+    std::string manifest_path_;
+    int lock_fd_ = -1;
+  };
+
+  // Returns the quota shared by the whole process.
+  static IncrementalStorageQuota& Shared();
+
+  // Returns the path of the manifest that the sibling request of the same
+  // module keeps in the other storage area: the derived file request's if
+  // `derived` is true, or the compile request's otherwise. Returns
+  // `manifest_path` unchanged if it already belongs to that request.
+  static std::string SiblingManifestPath(const std::string& manifest_path,
+                                         bool derived);
+
+  // Marks the module whose manifest is at `manifest_path` as in flight, and
+  // remembers the storage area it lives in.
+  std::unique_ptr<Lease> Acquire(const std::string& manifest_path);
+
+  // If a budget is set and the storage areas seen so far exceed it, evicts
+  // least recently used modules until they fit. Scans are rate-limited, so
+  // this is cheap to call after every request. Evictions are logged to
+  // `log` if it is non-null.
+  void MaybeEvict(std::ostream* log);
+
+ private:
+  IncrementalStorageQuota();
+
+  std::optional<uintmax_t> budget_;
+  std::mutex mutex_;
+  std::multiset<std::string> in_flight_;
+  std::set<std::string> roots_;
+  std::chrono::steady_clock::time_point last_scan_;
+  bool scanned_ = false;
+};
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_INCREMENTAL_STORAGE_QUOTA_H_
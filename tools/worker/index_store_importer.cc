@@ -0,0 +1,301 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/worker/index_store_importer.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "tools/common/index_store.h"
+
+namespace bazel_rules_swift {
+
+namespace {
+
+// The number of parsed units to remember. A module has a unit per output file,
+// so this holds the units of the modules a worker compiles most often without
+// keeping every unit it has ever imported.
+constexpr size_t kMaxCachedUnits = 1024;
+
+// Returns `path` relative to the execution root if it is inside it, without a
+// leading `./`, so that output paths recorded by the compiler can be compared
+// with the ones in the output file map regardless of how they were spelled.
+std::string NormalizeOutputPath(absl::string_view path,
+                                absl::string_view exec_root) {
+  if (absl::ConsumePrefix(&path, exec_root)) {
+    absl::ConsumePrefix(&path, "/");
+  }
+  while (absl::ConsumePrefix(&path, "./")) {
+  }
+  return std::string(path);
+}
+
+// Reads the entire contents of the file at `path`.
+std::optional<std::string> ReadFile(const std::filesystem::path& path) {
+  std::ifstream stream(path, std::ios::binary);
+  if (!stream.good()) {
+    return std::nullopt;
+  }
+  std::ostringstream contents;
+  contents << stream.rdbuf();
+  return contents.str();
+}
+
+// Writes `data` to `path` by way of a temporary file in the same directory, so
+// that readers of the store never see a partially written unit.
+bool WriteFileAtomically(const std::filesystem::path& path,
+                         absl::string_view data) {
+  std::filesystem::path temp_path = path;
+  temp_path += ".tmp";
+  {
+    std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+    stream.write(data.data(), data.size());
+    if (!stream.good()) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temp_path, path, ec);
+  if (ec) {
+    std::filesystem::remove(temp_path, ec);
+    return false;
+  }
+  return true;
+}
+
+// Makes the record at `source` available at `destination`. Records are
+// immutable once written, so a hard link is used when possible and an existing
+// destination is left alone.
+bool ImportRecord(const std::filesystem::path& source,
+                  const std::filesystem::path& destination) {
+  std::error_code ec;
+  if (std::filesystem::exists(destination, ec)) {
+    return true;
+  }
+  std::filesystem::create_directories(destination.parent_path(), ec);
+  std::filesystem::create_hard_link(source, destination, ec);
+  if (!ec || std::filesystem::exists(destination)) {
+    return true;
+  }
+  ec.clear();
+  std::filesystem::copy_file(source, destination,
+                             std::filesystem::copy_options::skip_existing, ec);
+  return !ec;
+}
+
+}  // namespace
+
+IndexStoreImporter& IndexStoreImporter::Shared() {
+  static IndexStoreImporter* importer = new IndexStoreImporter();
+  return *importer;
+}
+
+std::shared_ptr<const IndexUnit> IndexStoreImporter::ReadUnit(
+    const std::filesystem::path& path,
+    std::filesystem::file_time_type* mtime) {
+  std::error_code ec;
+  *mtime = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return nullptr;
+  }
+  std::string key = path.string();
+  {
+    std::lock_guard<std::mutex> lock(unit_cache_mutex_);
+    auto it = unit_cache_.find(key);
+    if (it != unit_cache_.end() && it->second.mtime == *mtime) {
+      it->second.last_use = ++use_counter_;
+      return it->second.unit;
+    }
+  }
+
+  std::optional<IndexUnit> parsed = ReadIndexUnit(path);
+  std::lock_guard<std::mutex> lock(unit_cache_mutex_);
+  if (!parsed.has_value()) {
+    unit_cache_.erase(key);
+    return nullptr;
+  }
+  auto unit = std::make_shared<const IndexUnit>(*std::move(parsed));
+  CachedUnit& cached = unit_cache_[key];
+  cached.mtime = *mtime;
+  cached.unit = unit;
+  cached.last_use = ++use_counter_;
+
+  if (unit_cache_.size() > kMaxCachedUnits) {
+    auto oldest = unit_cache_.begin();
+    for (auto it = unit_cache_.begin(); it != unit_cache_.end(); ++it) {
+      if (it->second.last_use < oldest->second.last_use) {
+        oldest = it;
+      }
+    }
+    unit_cache_.erase(oldest);
+  }
+  return unit;
+}
+
+IndexPathRemapper& IndexStoreImporter::RemapperFor(
+    const std::vector<std::pair<std::string, std::string>>& prefix_map) {
+  std::string key;
+  for (const auto& [prefix, replacement] : prefix_map) {
+    absl::StrAppend(&key, prefix, "=", replacement, "\n");
+  }
+  auto [it, inserted] = remappers_.try_emplace(key);
+  if (inserted) {
+    for (const auto& [prefix, replacement] : prefix_map) {
+      it->second.AddPrefixMapping(prefix, replacement);
+    }
+  }
+  return it->second;
+}
+
+bool IndexStoreImporter::Import(
+    const std::filesystem::path& source_store,
+    const std::filesystem::path& destination_store,
+    const std::vector<std::string>& output_files,
+    const std::vector<std::pair<std::string, std::string>>& prefix_map,
+    std::ostream* stderr_stream) {
+  const std::string exec_root = std::filesystem::current_path().string();
+  absl::flat_hash_set<std::string> wanted_outputs;
+  absl::flat_hash_set<std::string> unit_name_prefixes;
+  for (const std::string& output_file : output_files) {
+    wanted_outputs.insert(NormalizeOutputPath(output_file, exec_root));
+    unit_name_prefixes.insert(absl::StrCat(
+        std::filesystem::path(output_file).filename().string(), "-"));
+  }
+
+  // Unit names start with the basename of their output file, so only the units
+  // that could match need to be read; the rest of the store is skipped by name.
+  std::filesystem::path source_units = IndexStoreUnitsDirectory(source_store);
+  struct SourceUnit {
+    std::filesystem::path path;
+    std::filesystem::file_time_type mtime = {};
+    std::shared_ptr<const IndexUnit> unit = nullptr;
+  };
+  absl::flat_hash_map<std::string, SourceUnit> newest_units;
+  std::error_code ec;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(source_units, ec)) {
+    std::string name = entry.path().filename().string();
+    bool candidate = false;
+    for (const std::string& prefix : unit_name_prefixes) {
+      if (absl::StartsWith(name, prefix)) {
+        candidate = true;
+        break;
+      }
+    }
+    if (!candidate) {
+      continue;
+    }
+    SourceUnit source;
+    source.path = entry.path();
+    source.unit = ReadUnit(source.path, &source.mtime);
+    if (source.unit == nullptr) {
+      continue;
+    }
+    std::string output =
+        NormalizeOutputPath(source.unit->output_file, exec_root);
+    if (!wanted_outputs.contains(output)) {
+      continue;
+    }
+    // Stale units for the same output can linger in the global store; the most
+    // recently written one is the one this compilation produced.
+    auto [it, inserted] = newest_units.try_emplace(output, source);
+    if (!inserted && it->second.mtime < source.mtime) {
+      it->second = std::move(source);
+    }
+  }
+  if (ec && ec != std::errc::no_such_file_or_directory) {
+    (*stderr_stream) << "swift_worker: Could not read index units from "
+                     << source_units << ": " << ec.message() << "\n";
+    return false;
+  }
+
+  std::filesystem::path destination_units =
+      IndexStoreUnitsDirectory(destination_store);
+  std::filesystem::create_directories(destination_units, ec);
+  if (ec) {
+    (*stderr_stream) << "swift_worker: Could not create " << destination_units
+                     << ": " << ec.message() << "\n";
+    return false;
+  }
+
+  for (const auto& [output, source] : newest_units) {
+    const std::filesystem::path& unit_path = source.path;
+    std::optional<std::string> data = ReadFile(unit_path);
+    if (!data.has_value()) {
+      (*stderr_stream) << "swift_worker: Could not read index unit "
+                       << unit_path << "\n";
+      return false;
+    }
+
+    // The unit keeps the name the compiler gave it, which is derived from the
+    // output path it was written for, so that the unit for the same output
+    // replaces it in the destination store and lookups by output file find it.
+    std::string unit_name = unit_path.filename().string();
+    if (!prefix_map.empty()) {
+      std::string error;
+      std::optional<std::string> remapped;
+      {
+        std::lock_guard<std::mutex> lock(remapper_mutex_);
+        remapped = RemapIndexUnit(*data, RemapperFor(prefix_map),
+                                  /*output_file=*/nullptr, &error);
+      }
+      if (!remapped.has_value()) {
+        (*stderr_stream) << "swift_worker: Could not remap index unit "
+                         << unit_path << ": " << error << "\n";
+        return false;
+      }
+      data = std::move(remapped);
+    }
+
+    for (const IndexUnitDependency& dependency : source.unit->dependencies) {
+      if (dependency.kind != IndexUnitDependencyKind::kRecord) {
+        continue;
+      }
+      std::filesystem::path record_path =
+          IndexStoreRecordPath(source_store, dependency.name);
+      if (!ImportRecord(record_path, IndexStoreRecordPath(destination_store,
+                                                          dependency.name))) {
+        (*stderr_stream) << "swift_worker: Could not import index record "
+                         << record_path << "\n";
+        return false;
+      }
+    }
+
+    // Write the unit last, so that it never refers to records that are missing
+    // from the destination store.
+    if (!WriteFileAtomically(destination_units / unit_name, *data)) {
+      (*stderr_stream) << "swift_worker: Could not write index unit "
+                       << (destination_units / unit_name) << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace bazel_rules_swift
@@ -0,0 +1,96 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_INDEX_STORE_IMPORTER_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_INDEX_STORE_IMPORTER_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tools/common/index_store.h"
+
+namespace bazel_rules_swift {
+
+// Copies the index data for a compilation from the global index store into the
+// index store that Bazel declared for the action, doing the same work as the
+// `index-import` tool without spawning it.
+//
+// A single importer is shared by every request that a worker handles, so that
+// parsed units and remapped paths are reused across compilations instead of
+// being rediscovered from the store each time.
+class IndexStoreImporter {
+ public:
+  // Returns the importer shared by the whole process.
+  static IndexStoreImporter& Shared();
+
+  // Imports the units whose output file is one of `output_files`, and the
+  // records they depend on, from `source_store` into `destination_store`.
+  // `prefix_map` holds `-file-prefix-map`-style (prefix, replacement) pairs
+  // that are applied to the paths in each unit. Returns false and writes a
+  // diagnostic to `stderr_stream` if the import could not be completed.
+  bool Import(
+      const std::filesystem::path& source_store,
+      const std::filesystem::path& destination_store,
+      const std::vector<std::string>& output_files,
+      const std::vector<std::pair<std::string, std::string>>& prefix_map,
+      std::ostream* stderr_stream);
+
+ private:
+  // The parts of a source unit that are needed to decide whether to import it,
+  // valid as long as the unit file's modification time is unchanged.
+  struct CachedUnit {
+    std::filesystem::file_time_type mtime;
+    std::shared_ptr<const IndexUnit> unit;
+    uint64_t last_use = 0;
+  };
+
+  // Returns the parsed unit at `path`, reading it only if it changed since it
+  // was last seen, or nullptr if it couldn't be read.
+  std::shared_ptr<const IndexUnit> ReadUnit(
+      const std::filesystem::path& path,
+      std::filesystem::file_time_type* mtime);
+
+  // Returns the remapper for the given prefix map, creating it if needed. Must
+  // be called with `remapper_mutex_` held.
+  IndexPathRemapper& RemapperFor(
+      const std::vector<std::pair<std::string, std::string>>& prefix_map);
+
+  // Guards `unit_cache_` and `use_counter_`. It is never held while files are
+  // read or written, so that concurrent imports only wait for each other's
+  // cache lookups.
+  std::mutex unit_cache_mutex_;
+
+  // Parsed source units, keyed by unit file path. Bounded, evicting the least
+  // recently used unit, so that a long-lived worker doesn't keep every unit it
+  // has ever imported.
+  absl::flat_hash_map<std::string, CachedUnit> unit_cache_;
+  uint64_t use_counter_ = 0;
+
+  // Guards `remappers_`, whose remappers cache the paths they rewrite.
+  std::mutex remapper_mutex_;
+
+  // Path remappers, keyed by the serialized prefix map they apply.
+  absl::flat_hash_map<std::string, IndexPathRemapper> remappers_;
+};
+
+}  // namespace bazel_rules_swift
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_INDEX_STORE_IMPORTER_H_
@@ -0,0 +1,446 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/worker/input_digest_table.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "tools/common/bitstream.h"
+#include "tools/common/file_system.h"
+
+using bazel_rules_swift::Bitstream;
+using bazel_rules_swift::BitstreamBlock;
+using bazel_rules_swift::BitstreamRecord;
+using bazel_rules_swift::LongPath;
+using bazel_rules_swift::ParseBitstream;
+using bazel_rules_swift::worker_protocol::Input;
+
+namespace {
+
+// The first line of every table. Bump the version if the format changes so
+// that older tables are ignored rather than misread.
+constexpr char kTableHeader[] = "rules_swift input digests v1";
+
+// The key that introduces the build start time in the build record.
+constexpr absl::string_view kBuildStartTimeKey = "build_start_time: ";
+
+// The parts of the driver's serialized module dependency graph (the `.priors`
+// file next to the build record) that name its external dependencies.
+constexpr absl::string_view kPriorsMagic = "DDEP";
+constexpr uint32_t kPriorsRecordBlockId = 8;
+constexpr uint32_t kPriorsExternalDependencyRecord = 5;
+constexpr uint32_t kPriorsIdentifierRecord = 6;
+
+// Returns `path` lexically normalized, so that a source is spelled the same
+// way in the build record as in the work request.
+std::string NormalizePath(absl::string_view path) {
+  return std::filesystem::path(std::string(path))
+      .lexically_normal()
+      .generic_string();
+}
+
+// Returns the modification time of the file at `path` the way the driver reads
+// it, or nothing if it doesn't exist.
+std::optional<DriverTimestamp> ModificationTime(const std::string& path) {
+#if defined(_WIN32)
+  // The driver's times on Windows aren't Unix times; leave them alone.
+  return std::nullopt;
+#else
+  struct stat stats;
+  if (stat(path.c_str(), &stats) != 0) {
+    return std::nullopt;
+  }
+#if defined(__APPLE__)
+  return DriverTimestamp{stats.st_mtimespec.tv_sec, stats.st_mtimespec.tv_nsec};
+#else
+  return DriverTimestamp{stats.st_mtim.tv_sec, stats.st_mtim.tv_nsec};
+#endif
+#endif
+}
+
+// Returns the earliest time after `timestamp`.
+DriverTimestamp Successor(DriverTimestamp timestamp) {
+  if (++timestamp.nanoseconds == 1000000000) {
+    timestamp.nanoseconds = 0;
+    ++timestamp.seconds;
+  }
+  return timestamp;
+}
+
+// Parses a time written by the driver as `[<seconds>, <nanoseconds>]`.
+bool ParseTimestamp(absl::string_view text, DriverTimestamp& timestamp) {
+  if (!absl::ConsumePrefix(&text, "[") || !absl::ConsumeSuffix(&text, "]")) {
+    return false;
+  }
+  std::vector<absl::string_view> parts = absl::StrSplit(text, ',');
+  return parts.size() == 2 &&
+         absl::SimpleAtoi(parts[0], &timestamp.seconds) &&
+         absl::SimpleAtoi(parts[1], &timestamp.nanoseconds);
+}
+
+std::string FormatTimestamp(const DriverTimestamp& timestamp) {
+  return absl::StrCat("[", timestamp.seconds, ", ", timestamp.nanoseconds,
+                      "]");
+}
+
+// An entry of the build record's `inputs` map, such as
+// `  "Sources/A.swift": !dirty [1700000000, 12345]`.
+struct BuildRecordInput {
+  // The source path, unquoted.
+  std::string path;
+
+  // Everything that precedes the time: the indentation, the key, and the tag
+  // that marks the source for recompilation, if any.
+  std::string prefix;
+
+  DriverTimestamp mtime;
+};
+
+// Parses `line` as an entry of the build record's `inputs` map.
+bool ParseBuildRecordInput(absl::string_view line, BuildRecordInput& input) {
+  size_t key_start = line.find_first_not_of(' ');
+  if (key_start == 0 || key_start == absl::string_view::npos) {
+    return false;
+  }
+
+  size_t key_end;
+  if (line[key_start] == '"') {
+    input.path.clear();
+    key_end = key_start + 1;
+    while (key_end < line.size() && line[key_end] != '"') {
+      if (line[key_end] == '\\' && key_end + 1 < line.size()) {
+        ++key_end;
+      }
+      input.path.push_back(line[key_end++]);
+    }
+    if (key_end == line.size()) {
+      return false;
+    }
+    ++key_end;
+  } else {
+    key_end = line.find(':', key_start);
+    if (key_end == absl::string_view::npos) {
+      return false;
+    }
+    input.path = std::string(line.substr(key_start, key_end - key_start));
+  }
+
+  absl::string_view value = line.substr(key_end);
+  if (!absl::ConsumePrefix(&value, ": ")) {
+    return false;
+  }
+  if (absl::StartsWith(value, "!")) {
+    size_t tag_end = value.find(' ');
+    if (tag_end == absl::string_view::npos) {
+      return false;
+    }
+    value.remove_prefix(tag_end + 1);
+  }
+  if (!ParseTimestamp(value, input.mtime)) {
+    return false;
+  }
+  input.prefix = std::string(line.substr(0, line.size() - value.size()));
+  return true;
+}
+
+// Returns the external dependencies recorded in the driver's serialized module
+// dependency graph at `path`, as normalized paths relative to the working
+// directory where possible, or nothing if the graph can't be read or isn't
+// laid out as expected.
+std::optional<std::vector<std::string>> ReadExternalDependencies(
+    const std::string& path) {
+  std::ifstream stream(LongPath(path), std::ios::binary);
+  if (!stream.good()) {
+    return std::nullopt;
+  }
+  std::string contents((std::istreambuf_iterator<char>(stream)),
+                       std::istreambuf_iterator<char>());
+  std::optional<Bitstream> graph = ParseBitstream(contents);
+  if (!graph.has_value() || graph->magic != kPriorsMagic) {
+    return std::nullopt;
+  }
+  const BitstreamBlock* records = graph->FindBlock(kPriorsRecordBlockId);
+  if (records == nullptr) {
+    return std::nullopt;
+  }
+
+  // Identifiers are numbered from 1 in the order they are written; 0 is the
+  // empty string. Each external dependency refers to its path by number.
+  std::vector<std::string> identifiers = {""};
+  std::vector<std::string> dependencies;
+  std::string working_directory =
+      std::filesystem::current_path().generic_string() + "/";
+  for (const BitstreamRecord& record : records->records) {
+    if (record.code == kPriorsIdentifierRecord) {
+      if (!record.blob.has_value()) {
+        return std::nullopt;
+      }
+      identifiers.push_back(*record.blob);
+    } else if (record.code == kPriorsExternalDependencyRecord) {
+      if (record.fields.empty() || record.fields[0] == 0 ||
+          record.fields[0] >= identifiers.size()) {
+        return std::nullopt;
+      }
+      absl::string_view dependency = identifiers[record.fields[0]];
+      absl::ConsumePrefix(&dependency, working_directory);
+      dependencies.push_back(NormalizePath(dependency));
+    }
+  }
+  return dependencies;
+}
+
+// Replaces the file at `path` with `contents` atomically. Returns false if it
+// could not be written.
+bool ReplaceFile(const std::string& path, const std::string& contents) {
+  std::string temp_path = path + ".tmp";
+  {
+    std::ofstream stream(LongPath(temp_path),
+                         std::ios::binary | std::ios::trunc);
+    stream << contents;
+    if (!stream.good()) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(LongPath(temp_path), LongPath(path), ec);
+  if (ec) {
+    std::filesystem::remove(LongPath(temp_path), ec);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+void BuildRecordEdit::Revert() const {
+  std::error_code ec;
+  std::filesystem::file_time_type mtime =
+      std::filesystem::last_write_time(LongPath(path_), ec);
+  if (!ec && mtime == written_mtime_) {
+    ReplaceFile(path_, original_contents_);
+  }
+}
+
+InputDigestTable InputDigestTable::FromInputs(
+    const std::vector<Input>& inputs) {
+  InputDigestTable table;
+  table.entries_.reserve(inputs.size());
+  for (const Input& input : inputs) {
+    std::optional<DriverTimestamp> mtime = ModificationTime(input.path);
+    if (!mtime.has_value()) {
+      continue;
+    }
+    Entry& entry = table.entries_[NormalizePath(input.path)];
+    entry.mtime = *mtime;
+    // Digests are written as space-separated fields, and Bazel's are base64 or
+    // hex; anything else is treated as missing.
+    if (input.digest.find_first_of(" \t\r\n") == std::string::npos) {
+      entry.digest = input.digest;
+    }
+  }
+  return table;
+}
+
+bool InputDigestTable::ReadFromPath(const std::string& path) {
+  entries_.clear();
+
+  std::ifstream stream(LongPath(path), std::ios::binary);
+  std::string line;
+  if (!std::getline(stream, line) || line != kTableHeader) {
+    return false;
+  }
+
+  // Each entry is "<digest> <seconds> <nanoseconds> <path>"; the path is last
+  // so that it may contain spaces.
+  while (std::getline(stream, line)) {
+    std::vector<absl::string_view> fields =
+        absl::StrSplit(line, absl::MaxSplits(' ', 3));
+    Entry entry;
+    if (fields.size() != 4 || fields[0].empty() || fields[3].empty() ||
+        !absl::SimpleAtoi(fields[1], &entry.mtime.seconds) ||
+        !absl::SimpleAtoi(fields[2], &entry.mtime.nanoseconds)) {
+      entries_.clear();
+      return false;
+    }
+    entry.digest = std::string(fields[0]);
+    entries_[std::string(fields[3])] = std::move(entry);
+  }
+  return true;
+}
+
+bool InputDigestTable::WriteToPath(const std::string& path) const {
+  std::string contents = absl::StrCat(kTableHeader, "\n");
+  for (const auto& [entry_path, entry] : entries_) {
+    if (!entry.digest.empty()) {
+      absl::StrAppend(&contents, entry.digest, " ", entry.mtime.seconds, " ",
+                      entry.mtime.nanoseconds, " ", entry_path, "\n");
+    }
+  }
+  return ReplaceFile(path, contents);
+}
+
+std::optional<BuildRecordEdit> InputDigestTable::NormalizeBuildRecord(
+    const std::string& build_record_path,
+    const InputDigestTable& previous) const {
+  std::string original_contents;
+  {
+    std::ifstream stream(LongPath(build_record_path), std::ios::binary);
+    if (!stream.good()) {
+      return std::nullopt;
+    }
+    original_contents.assign(std::istreambuf_iterator<char>(stream),
+                             std::istreambuf_iterator<char>());
+    if (stream.bad()) {
+      return std::nullopt;
+    }
+  }
+
+  // Returns the entry that `previous` has for `path` if it has the same digest
+  // as this table's entry, or nullptr if the input changed or is unknown.
+  auto unchanged_entry = [&previous](const std::string& path,
+                                     const Entry& entry) -> const Entry* {
+    if (entry.digest.empty()) {
+      return nullptr;
+    }
+    auto it = previous.entries_.find(path);
+    if (it == previous.entries_.end() || it->second.digest != entry.digest) {
+      return nullptr;
+    }
+    return &it->second;
+  };
+
+  std::vector<std::string> lines = absl::StrSplit(original_contents, '\n');
+  absl::flat_hash_set<std::string> sources;
+  std::optional<size_t> start_time_line;
+  DriverTimestamp start_time;
+  size_t restamped_sources = 0;
+  bool changed = false;
+  bool in_inputs = false;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    std::string& line = lines[i];
+    if (!line.empty() && line[0] != ' ') {
+      in_inputs = line == "inputs:";
+    }
+
+    if (!in_inputs) {
+      absl::string_view value = line;
+      if (absl::ConsumePrefix(&value, kBuildStartTimeKey) &&
+          ParseTimestamp(value, start_time)) {
+        start_time_line = i;
+      }
+      continue;
+    }
+
+    BuildRecordInput input;
+    if (!ParseBuildRecordInput(line, input)) {
+      continue;
+    }
+    std::string path = NormalizePath(input.path);
+    sources.insert(path);
+    auto current = entries_.find(path);
+    if (current == entries_.end() || current->second.digest.empty() ||
+        previous.entries_.find(path) == previous.entries_.end()) {
+      continue;
+    }
+    const Entry& now = current->second;
+    if (const Entry* then = unchanged_entry(path, now)) {
+      if (input.mtime == then->mtime && input.mtime != now.mtime) {
+        line = input.prefix + FormatTimestamp(now.mtime);
+        ++restamped_sources;
+        changed = true;
+      }
+    } else if (input.mtime == now.mtime) {
+      line = input.prefix + FormatTimestamp(DriverTimestamp{});
+      changed = true;
+    }
+  }
+
+  // Sources are compared by their own times above; every other input is a
+  // potential external dependency, which the driver treats as changed if it is
+  // newer than the start of the last build. Moving the start time forward
+  // would also hide changes to dependencies that Bazel didn't send, such as
+  // modules in the SDK, so it is only done if the driver's graph shows that
+  // the module has no such dependencies. Moving it back never hides a change.
+  if (start_time_line.has_value()) {
+    std::optional<std::vector<std::string>> external_dependencies =
+        ReadExternalDependencies(
+            std::filesystem::path(build_record_path)
+                .replace_extension(".priors")
+                .string());
+    bool dependencies_covered =
+        external_dependencies.has_value() &&
+        std::all_of(external_dependencies->begin(),
+                    external_dependencies->end(),
+                    [this](const std::string& dependency) {
+                      return entries_.contains(dependency);
+                    });
+
+    std::optional<DriverTimestamp> latest_unchanged;
+    std::optional<DriverTimestamp> earliest_changed;
+    for (const auto& [path, entry] : entries_) {
+      if (sources.contains(path)) {
+        continue;
+      }
+      if (unchanged_entry(path, entry) != nullptr) {
+        if (!latest_unchanged.has_value() || *latest_unchanged < entry.mtime) {
+          latest_unchanged = entry.mtime;
+        }
+      } else if (!earliest_changed.has_value() ||
+                 entry.mtime < *earliest_changed) {
+        earliest_changed = entry.mtime;
+      }
+    }
+
+    DriverTimestamp new_start_time = start_time;
+    if (dependencies_covered && latest_unchanged.has_value() &&
+        new_start_time < Successor(*latest_unchanged)) {
+      new_start_time = Successor(*latest_unchanged);
+    }
+    if (earliest_changed.has_value() && *earliest_changed < new_start_time) {
+      new_start_time = *earliest_changed;
+    }
+    if (new_start_time != start_time) {
+      lines[*start_time_line] =
+          absl::StrCat(kBuildStartTimeKey, FormatTimestamp(new_start_time));
+      changed = true;
+    }
+  }
+
+  if (!changed || !ReplaceFile(build_record_path, absl::StrJoin(lines, "\n"))) {
+    return std::nullopt;
+  }
+  std::error_code ec;
+  std::filesystem::file_time_type written_mtime =
+      std::filesystem::last_write_time(LongPath(build_record_path), ec);
+  return BuildRecordEdit(build_record_path, std::move(original_contents),
+                         written_mtime, restamped_sources);
+}
@@ -0,0 +1,130 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_INPUT_DIGEST_TABLE_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_INPUT_DIGEST_TABLE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tools/worker/worker_protocol.h"
+
+// A modification time as the Swift driver records it: seconds and nanoseconds
+// since the Unix epoch.
+struct DriverTimestamp {
+  int64_t seconds = 0;
+  int64_t nanoseconds = 0;
+
+  bool operator==(const DriverTimestamp& other) const {
+    return seconds == other.seconds && nanoseconds == other.nanoseconds;
+  }
+  bool operator!=(const DriverTimestamp& other) const {
+    return !(*this == other);
+  }
+  bool operator<(const DriverTimestamp& other) const {
+    return seconds < other.seconds ||
+           (seconds == other.seconds && nanoseconds < other.nanoseconds);
+  }
+};
+
+// A build record rewritten by `InputDigestTable::NormalizeBuildRecord`.
+class BuildRecordEdit {
+ public:
+  BuildRecordEdit(std::string path, std::string original_contents,
+                  std::filesystem::file_time_type written_mtime,
+                  size_t restamped_sources)
+      : path_(std::move(path)),
+        original_contents_(std::move(original_contents)),
+        written_mtime_(written_mtime),
+        restamped_sources_(restamped_sources) {}
+
+  // Puts the original build record back, unless the driver has replaced the
+  // rewritten one since. Called when a compile fails, so that the record still
+  // matches the incremental manifest of the last successful compile.
+  void Revert() const;
+
+  // The number of sources whose recorded modification time was updated
+  // because their contents hadn't changed.
+  size_t restamped_sources() const { return restamped_sources_; }
+
+ private:
+  std::string path_;
+  std::string original_contents_;
+  std::filesystem::file_time_type written_mtime_;
+  size_t restamped_sources_;
+};
+
+// The digests that Bazel reported for the inputs of a compile, with the
+// modification time each input had when it was compiled.
+//
+// The Swift driver decides what to recompile by comparing modification times:
+// a source is recompiled if its time differs from the one in the build record,
+// and the users of a module or header are recompiled if its time is later than
+// the start of the last build. When inputs are materialized again for every
+// build (in a sandbox, or by a remote execution or caching backend), their
+// times change even though their contents don't, and every compile silently
+// becomes a full rebuild. Keeping the table from the last successful compile
+// of a module lets the worker tell which inputs actually changed and rewrite
+// the build record accordingly.
+class InputDigestTable {
+ public:
+  // Returns a table of the current modification times of `inputs`. Inputs that
+  // don't exist are left out; inputs that Bazel sent no digest for are kept,
+  // but never considered unchanged.
+  static InputDigestTable FromInputs(
+      const std::vector<bazel_rules_swift::worker_protocol::Input>& inputs);
+
+  // Reads the table at `path`. Returns false if it doesn't exist or can't be
+  // parsed, in which case the table is empty.
+  bool ReadFromPath(const std::string& path);
+
+  // Writes the table to `path`, replacing any existing one atomically. Returns
+  // false if it could not be written.
+  bool WriteToPath(const std::string& path) const;
+
+  // Rewrites the driver's build record at `build_record_path`, which `previous`
+  // describes the inputs of, so that it reflects which inputs in this table
+  // actually changed:
+  //
+  // * A source with the same digest as before, whose recorded time is the one
+  //   it had then, is given its current time, so the driver skips it.
+  // * A source whose digest changed but whose time didn't is given a time it
+  //   can't have, so the driver recompiles it.
+  // * The build start time is moved past the times of the other inputs whose
+  //   digests didn't change, but never past the time of one that did. It is
+  //   only moved forward if every external dependency in the driver's module
+  //   dependency graph (the `.priors` file next to the build record) is in
+  //   this table.
+  //
+  // Returns the edit if the record was rewritten, or nothing if it didn't need
+  // to be or couldn't be parsed.
+  std::optional<BuildRecordEdit> NormalizeBuildRecord(
+      const std::string& build_record_path,
+      const InputDigestTable& previous) const;
+
+ private:
+  struct Entry {
+    std::string digest;
+    DriverTimestamp mtime;
+  };
+
+  absl::flat_hash_map<std::string, Entry> entries_;
+};
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_INPUT_DIGEST_TABLE_H_
@@ -0,0 +1,258 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests for rewriting the driver's build record from input digests. Each test
+// lays out a module's inputs, build record, and dependency graph the way the
+// driver leaves them, with explicit modification times.
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "tools/common/bitstream.h"
+#include "tools/common/test_support.h"
+#include "tools/worker/input_digest_table.h"
+#include "tools/worker/worker_protocol.h"
+
+using bazel_rules_swift::Bitstream;
+using bazel_rules_swift::BitstreamAbbrevOp;
+using bazel_rules_swift::BitstreamBlock;
+using bazel_rules_swift::BitstreamRecord;
+using bazel_rules_swift::WriteBitstream;
+
+namespace {
+
+constexpr char kBuildRecord[] = "M.swiftdeps";
+constexpr char kPriors[] = "M.priors";
+constexpr char kRestampedSource[] = "Sources/A.swift";
+constexpr char kChangedSource[] = "Sources/B.swift";
+constexpr char kDependency[] = "deps/Dep.swiftmodule";
+
+void WriteFile(const std::string& path, const std::string& contents) {
+  std::filesystem::path parent = std::filesystem::path(path).parent_path();
+  if (!parent.empty()) {
+    std::filesystem::create_directories(parent);
+  }
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream stream(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(stream),
+                     std::istreambuf_iterator<char>());
+}
+
+void SetModificationTime(const std::string& path, DriverTimestamp mtime) {
+  struct timespec times[2];
+  times[0].tv_sec = times[1].tv_sec = mtime.seconds;
+  times[0].tv_nsec = times[1].tv_nsec = mtime.nanoseconds;
+  utimensat(AT_FDCWD, path.c_str(), times, 0);
+}
+
+// Writes a build record like the driver's for the two sources.
+void WriteBuildRecord() {
+  WriteFile(kBuildRecord,
+            "version: \"Swift version 6.1\"\n"
+            "options: \"2Y8dVYy2Gg4sM6MbYV0Nmg==\"\n"
+            "build_start_time: [1100, 0]\n"
+            "build_end_time: [1110, 0]\n"
+            "inputs:\n"
+            "  \"Sources/A.swift\": [1000, 1]\n"
+            "  \"Sources/B.swift\": [1000, 2]\n");
+}
+
+// Writes a module dependency graph like the driver's that depends on the
+// given external paths, with the identifiers for them written first.
+void WritePriors(const std::vector<std::string>& dependencies) {
+  using Encoding = BitstreamAbbrevOp::Encoding;
+
+  BitstreamBlock block;
+  block.block_id = 8;
+  block.abbrev_width = 8;
+  auto add_abbrev = [&block](std::vector<BitstreamAbbrevOp> ops) {
+    block.entries.push_back(
+        {BitstreamBlock::Entry::Kind::kAbbrev, block.abbrevs.size()});
+    block.abbrevs.push_back(std::move(ops));
+  };
+  auto add_record = [&block](BitstreamRecord record) {
+    block.entries.push_back(
+        {BitstreamBlock::Entry::Kind::kRecord, block.records.size()});
+    block.records.push_back(std::move(record));
+  };
+  add_abbrev({{Encoding::kLiteral, 1},
+              {Encoding::kFixed, 16},
+              {Encoding::kFixed, 16},
+              {Encoding::kBlob, 0}});
+  add_abbrev({{Encoding::kLiteral, 6}, {Encoding::kBlob, 0}});
+  add_abbrev({{Encoding::kLiteral, 5},
+              {Encoding::kVBR, 13},
+              {Encoding::kFixed, 1},
+              {Encoding::kBlob, 0}});
+
+  add_record({4, 1, {1, 0}, std::string("Swift version 6.1")});
+  // A source's node name, which isn't an external dependency.
+  add_record({5, 6, {}, std::string("Sources/A.swift")});
+  for (const std::string& dependency : dependencies) {
+    add_record({5, 6, {}, dependency});
+  }
+  for (size_t i = 0; i < dependencies.size(); ++i) {
+    add_record({6, 5, {i + 2, 0}, std::string()});
+  }
+
+  Bitstream graph;
+  graph.magic = "DDEP";
+  graph.blocks.push_back(std::move(block));
+  std::optional<std::string> data = WriteBitstream(graph);
+  CHECK(data.has_value());
+  WriteFile(kPriors, data.value_or(""));
+}
+
+// Creates the inputs with the times and digests they had at the last
+// successful compile, and returns the table recorded then.
+InputDigestTable LastCompile() {
+  WriteFile(kRestampedSource, "struct A {}\n");
+  WriteFile(kChangedSource, "struct B {}\n");
+  WriteFile(kDependency, "module\n");
+  SetModificationTime(kRestampedSource, {1000, 1});
+  SetModificationTime(kChangedSource, {1000, 2});
+  SetModificationTime(kDependency, {900, 0});
+  return InputDigestTable::FromInputs({{kRestampedSource, "a1"},
+                                       {kChangedSource, "b1"},
+                                       {kDependency, "d1"}});
+}
+
+// Materializes the inputs again: A and the dependency get new times but keep
+// their contents, and B is edited without its time changing.
+InputDigestTable ThisCompile(DriverTimestamp dependency_mtime,
+                             const std::string& dependency_digest) {
+  SetModificationTime(kRestampedSource, {2000, 5});
+  SetModificationTime(kDependency, dependency_mtime);
+  return InputDigestTable::FromInputs({{kRestampedSource, "a1"},
+                                       {kChangedSource, "b2"},
+                                       {kDependency, dependency_digest}});
+}
+
+// Checks the source lines that every test expects after the rewrite.
+void CheckSources(const std::string& record) {
+  CHECK(record.find("  \"Sources/A.swift\": [2000, 5]\n") !=
+        std::string::npos);
+  CHECK(record.find("  \"Sources/B.swift\": [0, 0]\n") != std::string::npos);
+}
+
+void TestRewritesRecordWhenDependenciesAreCovered() {
+  InputDigestTable previous = LastCompile();
+  WriteBuildRecord();
+  WritePriors({(std::filesystem::current_path() / kDependency).string()});
+  InputDigestTable current = ThisCompile({1500, 0}, "d1");
+
+  std::optional<BuildRecordEdit> edit =
+      current.NormalizeBuildRecord(kBuildRecord, previous);
+  CHECK(edit.has_value());
+  if (!edit.has_value()) return;
+  CHECK(edit->restamped_sources() == 1);
+  std::string record = ReadFile(kBuildRecord);
+  CheckSources(record);
+  // Past the restamped dependency, so the driver doesn't rebuild its users.
+  CHECK(record.find("build_start_time: [1500, 1]\n") != std::string::npos);
+  CHECK(record.find("build_end_time: [1110, 0]\n") != std::string::npos);
+
+  std::string rewritten = record;
+  edit->Revert();
+  record = ReadFile(kBuildRecord);
+  CHECK(record != rewritten);
+  CHECK(record.find("build_start_time: [1100, 0]\n") != std::string::npos);
+  CHECK(record.find("  \"Sources/A.swift\": [1000, 1]\n") !=
+        std::string::npos);
+}
+
+void TestKeepsStartTimeWithUncoveredDependency() {
+  InputDigestTable previous = LastCompile();
+  WriteBuildRecord();
+  WritePriors({kDependency, "/sdk/usr/lib/swift/Swift.swiftmodule"});
+  InputDigestTable current = ThisCompile({1500, 0}, "d1");
+
+  std::optional<BuildRecordEdit> edit =
+      current.NormalizeBuildRecord(kBuildRecord, previous);
+  CHECK(edit.has_value());
+  std::string record = ReadFile(kBuildRecord);
+  CheckSources(record);
+  CHECK(record.find("build_start_time: [1100, 0]\n") != std::string::npos);
+}
+
+void TestKeepsStartTimeWithoutGraph() {
+  InputDigestTable previous = LastCompile();
+  WriteBuildRecord();
+  std::filesystem::remove(kPriors);
+  InputDigestTable current = ThisCompile({1500, 0}, "d1");
+
+  std::optional<BuildRecordEdit> edit =
+      current.NormalizeBuildRecord(kBuildRecord, previous);
+  CHECK(edit.has_value());
+  std::string record = ReadFile(kBuildRecord);
+  CheckSources(record);
+  CHECK(record.find("build_start_time: [1100, 0]\n") != std::string::npos);
+}
+
+void TestMovesStartTimeBackForChangedDependency() {
+  InputDigestTable previous = LastCompile();
+  WriteBuildRecord();
+  WritePriors({kDependency, "/sdk/usr/lib/swift/Swift.swiftmodule"});
+  InputDigestTable current = ThisCompile({1050, 0}, "d2");
+
+  std::optional<BuildRecordEdit> edit =
+      current.NormalizeBuildRecord(kBuildRecord, previous);
+  CHECK(edit.has_value());
+  std::string record = ReadFile(kBuildRecord);
+  CheckSources(record);
+  // The dependency changed but is older than the last build's start, so the
+  // start time is moved back to make the driver notice.
+  CHECK(record.find("build_start_time: [1050, 0]\n") != std::string::npos);
+}
+
+void TestTableRoundTrip() {
+  InputDigestTable table = LastCompile();
+  CHECK(table.WriteToPath("M.input_digests"));
+  InputDigestTable read;
+  CHECK(read.ReadFromPath("M.input_digests"));
+
+  // Nothing changed, so there is nothing to rewrite.
+  WriteBuildRecord();
+  WritePriors({kDependency});
+  SetModificationTime(kDependency, {900, 0});
+  CHECK(!table.NormalizeBuildRecord(kBuildRecord, read).has_value());
+
+  WriteFile("M.input_digests", "not a table\n");
+  CHECK(!read.ReadFromPath("M.input_digests"));
+}
+
+}  // namespace
+
+int main() {
+  std::filesystem::current_path(
+      bazel_rules_swift::testing::MakeTestDirectory("input_digest_table_test"));
+
+  TestRewritesRecordWhenDependenciesAreCovered();
+  TestKeepsStartTimeWithUncoveredDependency();
+  TestKeepsStartTimeWithoutGraph();
+  TestMovesStartTimeBackForChangedDependency();
+  TestTableRoundTrip();
+  return bazel_rules_swift::testing::TestExitCode();
+}
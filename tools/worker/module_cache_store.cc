@@ -0,0 +1,494 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/worker/module_cache_store.h"
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "tools/common/file_digest.h"
+#include "tools/common/file_transfer.h"
+#include "tools/worker/file_snapshot.h"
+
+using bazel_rules_swift::DigestFile;
+using bazel_rules_swift::TransferFile;
+using bazel_rules_swift::XXH64Hasher;
+
+namespace {
+
+// How long a stored module or temporary file must have gone unused before it
+// is removed, which is far longer than any publish takes.
+constexpr std::time_t kUnreferencedFileAgeSeconds = 60 * 60;
+
+// How long a view can go without being used before it is forgotten, which
+// frees the modules that only it refers to.
+constexpr std::time_t kUnusedViewAgeSeconds = 7 * 24 * 60 * 60;
+
+// How often the store is trimmed after views are published. Trimming reads
+// every view, so it shouldn't happen on every compile.
+constexpr std::chrono::seconds kTrimInterval = std::chrono::minutes(5);
+
+// Views used more recently than this are never forgotten to meet the budget,
+// since compiles may still be populating their caches from them.
+constexpr std::chrono::seconds kBudgetGracePeriod = std::chrono::minutes(10);
+
+// Parses a size like "1048576", "512M", or "20G".
+std::optional<uintmax_t> ParseSize(absl::string_view value) {
+  uintmax_t multiplier = 1;
+  if (absl::ConsumeSuffix(&value, "G")) {
+    multiplier = uintmax_t{1} << 30;
+  } else if (absl::ConsumeSuffix(&value, "M")) {
+    multiplier = uintmax_t{1} << 20;
+  } else if (absl::ConsumeSuffix(&value, "K")) {
+    multiplier = uintmax_t{1} << 10;
+  }
+  uint64_t amount;
+  if (!absl::SimpleAtoi(value, &amount)) {
+    return std::nullopt;
+  }
+  return amount * multiplier;
+}
+
+// Flags whose values (in the following argument) affect which modules a
+// compile finds or how it builds them.
+const absl::flat_hash_set<absl::string_view> kModuleAffectingFlags = {
+    "-F",           "-Fsystem", "-I",          "-Isystem",   "-Xcc",
+    "-resource-dir", "-sdk",    "-swift-version", "-target", "-vfsoverlay",
+};
+
+// Returns the name of the view file for `key`.
+std::string ViewName(uint64_t key) {
+  return absl::StrCat(absl::Hex(key, absl::kZeroPad16));
+}
+
+// Returns true if the file at `path` in a module cache is a module that the
+// store should hold. Lock files, timestamps, and the compilers' temporary files
+// are local to the compile that made them.
+bool IsStoredModule(const std::filesystem::path& path) {
+  std::string extension = path.extension().string();
+  return extension == ".pcm" || extension == ".swiftmodule";
+}
+
+// Returns true if `path`, read from a view, stays inside the module cache that
+// it is populated into.
+bool IsContainedRelativePath(absl::string_view path) {
+  if (path.empty() || path.front() == '/') {
+    return false;
+  }
+  for (absl::string_view component : absl::StrSplit(path, '/')) {
+    if (component == "..") {
+      return false;
+    }
+  }
+  return true;
+}
+
+#if !defined(_WIN32)
+// Returns the number of seconds since the status of the file at `path` last
+// changed (which includes being linked or renamed), or nullopt if it doesn't
+// exist.
+std::optional<std::time_t> SecondsSinceStatusChange(
+    const std::filesystem::path& path) {
+  struct stat stats;
+  if (lstat(path.c_str(), &stats) != 0) {
+    return std::nullopt;
+  }
+  return std::time(nullptr) - stats.st_ctime;
+}
+#endif
+
+}  // namespace
+
+ModuleCacheStore* ModuleCacheStore::Shared() {
+#if defined(_WIN32)
+  return nullptr;
+#else
+  static ModuleCacheStore* store = []() -> ModuleCacheStore* {
+    const char* root = std::getenv("RULES_SWIFT_MODULE_CACHE_STORE");
+    if (root == nullptr || *root == '\0') {
+      return nullptr;
+    }
+    auto* store = new ModuleCacheStore(std::filesystem::absolute(root));
+    std::error_code ec;
+    for (const std::filesystem::path& directory :
+         {store->objects_, store->views_, store->temp_}) {
+      std::filesystem::create_directories(directory, ec);
+      if (ec) {
+        delete store;
+        return nullptr;
+      }
+    }
+    store->MaybeTrim();
+    return store;
+  }();
+  return store;
+#endif
+}
+
+ModuleCacheStore::ModuleCacheStore(std::filesystem::path root)
+    : root_(std::move(root)),
+      objects_(root_ / "objects"),
+      views_(root_ / "views"),
+      temp_(root_ / "tmp") {
+  const char* budget = std::getenv("RULES_SWIFT_MODULE_CACHE_STORE_BUDGET");
+  if (budget != nullptr && budget[0] != '\0') {
+    budget_ = ParseSize(budget);
+  }
+}
+
+uint64_t ModuleCacheStore::ViewKey(const std::vector<std::string>& tool_args,
+                                   const std::vector<std::string>& args) {
+  XXH64Hasher hasher;
+  auto add = [&](absl::string_view value) {
+    hasher.Update(value);
+    hasher.Update(absl::string_view("\0", 1));
+  };
+  for (const std::string& arg : tool_args) {
+    add(arg);
+  }
+  if (const char* developer_dir = std::getenv("DEVELOPER_DIR")) {
+    add(developer_dir);
+  }
+  for (size_t i = 0; i < args.size(); ++i) {
+    const std::string& arg = args[i];
+    if (kModuleAffectingFlags.contains(arg) && i + 1 < args.size()) {
+      add(arg);
+      add(args[++i]);
+    } else if (absl::StartsWith(arg, "-I") || absl::StartsWith(arg, "-F") ||
+               absl::StartsWith(arg, "-D")) {
+      add(arg);
+    }
+  }
+  return hasher.Digest();
+}
+
+ModuleCacheView ModuleCacheStore::Populate(uint64_t key,
+                                           const std::filesystem::path& path) {
+  ModuleCacheView view;
+  view.key = key;
+  view.path = path;
+
+  std::filesystem::path view_file = views_ / ViewName(key);
+  std::ifstream view_stream(view_file);
+  if (!view_stream.good()) {
+    return view;
+  }
+
+  // Mark the view as used, so that it isn't forgotten while compiles still
+  // start from it.
+  std::error_code ec;
+  std::filesystem::last_write_time(
+      view_file, std::filesystem::file_time_type::clock::now(), ec);
+
+  absl::flat_hash_set<std::string> created_directories;
+  std::string line;
+  while (std::getline(view_stream, line)) {
+    std::pair<std::string, std::string> entry =
+        absl::StrSplit(line, absl::MaxSplits('\t', 1));
+    if (entry.second.empty() || !IsContainedRelativePath(entry.first)) {
+      continue;
+    }
+    std::filesystem::path object = objects_ / entry.second;
+    std::filesystem::path destination = path / entry.first;
+    std::filesystem::path parent = destination.parent_path();
+    if (created_directories.insert(parent.string()).second) {
+      std::filesystem::create_directories(parent, ec);
+    }
+    if (!TransferFile(object, destination, /*allow_hard_link=*/true,
+                      /*stats=*/nullptr, ec)) {
+      continue;
+    }
+
+    // A clone or copy has a new modification time, but the modules that
+    // import this one recorded the time it had when they were built and would
+    // reject it as out of date.
+    std::optional<FileSnapshot> object_snapshot =
+        FileSnapshotCache::Stat(object);
+    std::optional<FileSnapshot> snapshot = FileSnapshotCache::Stat(destination);
+    if (!object_snapshot.has_value() || !snapshot.has_value()) {
+      continue;
+    }
+    if (snapshot->mtime != object_snapshot->mtime) {
+      std::filesystem::last_write_time(destination, object_snapshot->mtime, ec);
+      snapshot = FileSnapshotCache::Stat(destination);
+      if (!snapshot.has_value()) {
+        continue;
+      }
+    }
+    view.populated[entry.first] = {entry.second, *snapshot};
+  }
+  return view;
+}
+
+void ModuleCacheStore::Publish(const ModuleCacheView& view) {
+  std::string contents;
+  bool changed = false;
+  size_t unchanged_count = 0;
+  std::error_code ec;
+  for (auto it = std::filesystem::recursive_directory_iterator(view.path, ec);
+       !ec && it != std::filesystem::recursive_directory_iterator();
+       it.increment(ec)) {
+    if (!it->is_regular_file(ec) || !IsStoredModule(it->path())) {
+      continue;
+    }
+    std::optional<FileSnapshot> snapshot = FileSnapshotCache::Stat(it->path());
+    if (!snapshot.has_value()) {
+      continue;
+    }
+
+    std::string relative_path =
+        it->path().lexically_relative(view.path).generic_string();
+    std::string name;
+    auto populated = view.populated.find(relative_path);
+    if (populated != view.populated.end() &&
+        populated->second.second.SameFileAs(*snapshot)) {
+      name = populated->second.first;
+      ++unchanged_count;
+    } else {
+      name = Store(it->path(), *snapshot);
+      if (name.empty()) {
+        continue;
+      }
+      changed = true;
+    }
+    absl::StrAppend(&contents, relative_path, "\t", name, "\n");
+  }
+  if (!changed && unchanged_count == view.populated.size()) {
+    return;
+  }
+
+  // Replace the view atomically, so that a compile never starts from a
+  // partially written one. Concurrent compiles with the same key each publish
+  // a complete view, and the last one wins.
+  std::string view_name = ViewName(view.key);
+  std::filesystem::path temp_path = TempPath(view_name);
+  {
+    std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+    stream.write(contents.data(), contents.size());
+    if (!stream.good()) {
+      std::filesystem::remove(temp_path, ec);
+      return;
+    }
+  }
+  std::filesystem::rename(temp_path, views_ / view_name, ec);
+  if (ec) {
+    std::filesystem::remove(temp_path, ec);
+    return;
+  }
+  MaybeTrim();
+}
+
+std::string ModuleCacheStore::Store(const std::filesystem::path& path,
+                                    const FileSnapshot& snapshot) {
+  // The modification time is part of the name because modules record the
+  // times of the modules they import; two modules with the same contents but
+  // different times can't stand in for each other.
+  std::optional<uint64_t> digest = DigestFile(path);
+  if (!digest.has_value()) {
+    return "";
+  }
+  std::string name = absl::StrCat(
+      absl::Hex(*digest, absl::kZeroPad16), "-", snapshot.size, "-",
+      absl::Hex(static_cast<uint64_t>(
+          snapshot.mtime.time_since_epoch().count())));
+  std::filesystem::path object = objects_ / name;
+  std::error_code ec;
+  if (std::filesystem::exists(object, ec)) {
+    return name;
+  }
+
+  std::filesystem::path temp_path = TempPath(name);
+  if (!TransferFile(path, temp_path, /*allow_hard_link=*/true,
+                    /*stats=*/nullptr, ec)) {
+    return "";
+  }
+  std::filesystem::last_write_time(temp_path, snapshot.mtime, ec);
+
+  // Stored modules are read-only, so that anything that tries to modify one
+  // in place fails rather than changing the modules of every other compile.
+  std::filesystem::permissions(temp_path,
+                               std::filesystem::perms::owner_write |
+                                   std::filesystem::perms::group_write |
+                                   std::filesystem::perms::others_write,
+                               std::filesystem::perm_options::remove, ec);
+  std::filesystem::rename(temp_path, object, ec);
+  if (ec) {
+    std::filesystem::remove(temp_path, ec);
+    return "";
+  }
+  return name;
+}
+
+std::filesystem::path ModuleCacheStore::TempPath(absl::string_view name) {
+#if defined(_WIN32)
+  int pid = 0;
+#else
+  int pid = getpid();
+#endif
+  return temp_ / absl::StrCat(name, ".", pid, ".", temp_counter_++);
+}
+
+std::vector<ModuleCacheStore::ViewFile> ModuleCacheStore::ReadViews() {
+  std::vector<ViewFile> views;
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(views_, ec)) {
+    std::filesystem::file_time_type last_use = entry.last_write_time(ec);
+    if (ec) {
+      continue;
+    }
+    ViewFile& view = views.emplace_back();
+    view.path = entry.path();
+    view.last_use = last_use;
+    std::ifstream view_stream(entry.path());
+    std::string line;
+    while (std::getline(view_stream, line)) {
+      std::pair<std::string, std::string> view_entry =
+          absl::StrSplit(line, absl::MaxSplits('\t', 1));
+      view.modules.push_back(std::move(view_entry.second));
+    }
+  }
+  return views;
+}
+
+void ModuleCacheStore::MaybeTrim() {
+  {
+    std::lock_guard<std::mutex> lock(trim_mutex_);
+    auto now = std::chrono::steady_clock::now();
+    if (last_trim_ != std::chrono::steady_clock::time_point() &&
+        now - last_trim_ < kTrimInterval) {
+      return;
+    }
+    last_trim_ = now;
+  }
+  RemoveUnreferencedFiles();
+  if (budget_.has_value()) {
+    EvictToBudget();
+  }
+}
+
+void ModuleCacheStore::RemoveUnreferencedFiles() {
+#if !defined(_WIN32)
+  std::error_code ec;
+  absl::flat_hash_set<std::string> referenced;
+  auto now = std::filesystem::file_time_type::clock::now();
+  for (ViewFile& view : ReadViews()) {
+    if (now - view.last_use > std::chrono::seconds(kUnusedViewAgeSeconds)) {
+      std::filesystem::remove(view.path, ec);
+      continue;
+    }
+    for (std::string& module : view.modules) {
+      referenced.insert(std::move(module));
+    }
+  }
+
+  // A module is stored before the view that refers to it is published, so
+  // only modules that have been unreferenced for a while are removed.
+  auto remove_old_files = [&](const std::filesystem::path& directory,
+                              bool keep_referenced) {
+    std::vector<std::filesystem::path> old_files;
+    for (const auto& entry :
+         std::filesystem::directory_iterator(directory, ec)) {
+      if (keep_referenced &&
+          referenced.contains(entry.path().filename().string())) {
+        continue;
+      }
+      std::optional<std::time_t> age = SecondsSinceStatusChange(entry.path());
+      if (age.has_value() && *age > kUnreferencedFileAgeSeconds) {
+        old_files.push_back(entry.path());
+      }
+    }
+    for (const std::filesystem::path& path : old_files) {
+      std::filesystem::remove(path, ec);
+    }
+  };
+  remove_old_files(objects_, /*keep_referenced=*/true);
+  remove_old_files(temp_, /*keep_referenced=*/false);
+#endif
+}
+
+void ModuleCacheStore::EvictToBudget() {
+  std::error_code ec;
+  absl::flat_hash_map<std::string, uintmax_t> sizes;
+  uintmax_t total_size = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(objects_, ec)) {
+    uintmax_t size = entry.file_size(ec);
+    if (!ec) {
+      sizes[entry.path().filename().string()] = size;
+      total_size += size;
+    }
+  }
+  if (total_size <= *budget_) {
+    return;
+  }
+
+  std::vector<ViewFile> views = ReadViews();
+  absl::flat_hash_map<std::string, size_t> references;
+  for (const ViewFile& view : views) {
+    for (const std::string& module : view.modules) {
+      ++references[module];
+    }
+  }
+  std::sort(views.begin(), views.end(),
+            [](const ViewFile& a, const ViewFile& b) {
+              return a.last_use < b.last_use;
+            });
+
+  // A compile that populates its cache from a view that is being forgotten
+  // may find some of its modules gone, and builds them again.
+  auto grace_cutoff =
+      std::filesystem::file_time_type::clock::now() - kBudgetGracePeriod;
+  for (const ViewFile& view : views) {
+    if (total_size <= *budget_ || view.last_use >= grace_cutoff) {
+      break;
+    }
+    std::filesystem::remove(view.path, ec);
+    if (ec) {
+      continue;
+    }
+    for (const std::string& module : view.modules) {
+      if (--references[module] > 0) {
+        continue;
+      }
+      auto size = sizes.find(module);
+      if (size != sizes.end() &&
+          std::filesystem::remove(objects_ / module, ec)) {
+        total_size -= std::min(total_size, size->second);
+      }
+    }
+  }
+}
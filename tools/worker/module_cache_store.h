@@ -0,0 +1,141 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_MODULE_CACHE_STORE_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_MODULE_CACHE_STORE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "tools/worker/file_snapshot.h"
+
+// The modules that a compile's ephemeral module cache was populated with.
+struct ModuleCacheView {
+  // The key of the set of modules the view was populated from.
+  uint64_t key = 0;
+
+  // The module cache directory that the compile uses.
+  std::filesystem::path path;
+
+  // The name of the stored module that each file in the view (by path relative
+  // to `path`) was populated from, and the state of the file afterwards, so
+  // that files the compile didn't replace aren't hashed again.
+  absl::flat_hash_map<std::string, std::pair<std::string, FileSnapshot>>
+      populated;
+};
+
+// A content-addressed store of the implicit modules (Clang `.pcm` files and
+// `.swiftmodule` files built from interfaces) that compiles with an ephemeral
+// module cache have built, so that later compiles start with them instead of
+// building them again.
+//
+// The store is enabled by setting `RULES_SWIFT_MODULE_CACHE_STORE` to the
+// directory that holds it, which may be shared by any number of workers. Each
+// compile still gets a module cache of its own; it is populated with clones or
+// hard links of the modules that were published for the same key, and the
+// modules it builds are published when it finishes. Stored modules are never
+// modified: publishing writes a new file and renames it into place, and the
+// compilers replace modules in a cache in the same way rather than rewriting
+// them, so a compile can't change the modules that others are using.
+//
+// Sharing is safe even when the key is coarser than it needs to be, because
+// Clang and Swift place modules built with different flags at different paths
+// and validate every module they load against its inputs, rebuilding it if it
+// is out of date.
+//
+// If `RULES_SWIFT_MODULE_CACHE_STORE_BUDGET` is set (a byte count with an
+// optional `K`, `M`, or `G` suffix), the stored modules are kept within it by
+// forgetting the least recently used views and removing the modules that only
+// they referred to. The budget and the removal of old files are enforced when
+// the worker starts and, at most every few minutes, after a view is published.
+class ModuleCacheStore {
+ public:
+  // Returns the store shared by the whole process, or nullptr if it hasn't
+  // been enabled.
+  static ModuleCacheStore* Shared();
+
+  // Returns the key of the modules shared by compiles that spawn `tool_args`
+  // with `args`, which is derived from the tool and the flags that affect how
+  // modules are found and built.
+  static uint64_t ViewKey(const std::vector<std::string>& tool_args,
+                          const std::vector<std::string>& args);
+
+  // Populates the empty module cache directory at `path` with the modules most
+  // recently published for `key`. Modules that can't be transferred are left
+  // out, and the compiler builds them again.
+  ModuleCacheView Populate(uint64_t key, const std::filesystem::path& path);
+
+  // Stores the modules that were built in `view` and records the view's
+  // contents as the modules to populate future views with the same key.
+  void Publish(const ModuleCacheView& view);
+
+ private:
+  // A view file, when it was last used, and the names of the stored modules
+  // that it refers to.
+  struct ViewFile {
+    std::filesystem::path path;
+    std::filesystem::file_time_type last_use;
+    std::vector<std::string> modules;
+  };
+
+  explicit ModuleCacheStore(std::filesystem::path root);
+
+  // Reads every view file in the store.
+  std::vector<ViewFile> ReadViews();
+
+  // Removes old and unreferenced files and enforces the budget, unless that
+  // was done recently.
+  void MaybeTrim();
+
+  // Forgets views that haven't been used for a week, then removes stored
+  // modules that no view refers to and temporary files left behind by workers
+  // that were interrupted, once they are old enough that no publish can still
+  // be using them.
+  void RemoveUnreferencedFiles();
+
+  // If the stored modules exceed the budget, forgets the least recently used
+  // views (other than those used in the last few minutes) and removes the
+  // modules that only they referred to, until the rest fit.
+  void EvictToBudget();
+
+  // Stores the module at `path`, whose state is `snapshot`, and returns its
+  // name in the store, or an empty string if it couldn't be stored.
+  std::string Store(const std::filesystem::path& path,
+                    const FileSnapshot& snapshot);
+
+  // Returns a path in the store's temporary directory that no other publish
+  // will use.
+  std::filesystem::path TempPath(absl::string_view name);
+
+  std::filesystem::path root_;
+  std::filesystem::path objects_;
+  std::filesystem::path views_;
+  std::filesystem::path temp_;
+  std::atomic<uint64_t> temp_counter_ = 0;
+
+  std::optional<uintmax_t> budget_;
+  std::mutex trim_mutex_;
+  std::chrono::steady_clock::time_point last_trim_;
+};
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_MODULE_CACHE_STORE_H_
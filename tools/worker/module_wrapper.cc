@@ -0,0 +1,339 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/worker/module_wrapper.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "tools/common/target_triple.h"
+
+using bazel_rules_swift::TargetTriple;
+
+namespace {
+
+// The first bytes of every serialized `.swiftmodule`.
+constexpr absl::string_view kSwiftModuleSignature = "\xe2\x9c\xa8\x0e";
+
+// The alignment the frontend gives the module's contents in the object.
+constexpr uint64_t kModuleAlignment = 4;
+
+// The names of the sections of the object, in order, after the null section.
+constexpr const char* kSectionNames[] = {
+    ".swift_ast", ".note.GNU-stack", ".strtab", ".symtab", ".shstrtab",
+};
+enum SectionIndex : uint16_t {
+  kSwiftASTSection = 1,
+  kGNUStackSection,
+  kStringTableSection,
+  kSymbolTableSection,
+  kSectionNameTableSection,
+  kSectionCount,
+};
+
+// The name of the symbol that covers the module's contents.
+constexpr absl::string_view kSwiftASTSymbol = "__Swift_AST";
+
+// The ELF properties of an architecture that Swift targets.
+struct ElfMachine {
+  bool is_64_bit;
+  bool big_endian;
+  uint16_t machine;
+  uint32_t flags;
+};
+
+// Returns the ELF properties of the given target, or nothing if it isn't an
+// ELF target that is known to need no further ABI flags.
+std::optional<ElfMachine> ElfMachineForTarget(const TargetTriple& target) {
+  std::string os = target.WithoutOSVersion().OS();
+  if (os != "linux" && os != "freebsd" && os != "openbsd") {
+    return std::nullopt;
+  }
+  std::string arch = target.Arch();
+  if (arch == "x86_64" || arch == "amd64") {
+    return ElfMachine{true, false, /*EM_X86_64=*/62, 0};
+  }
+  if (arch == "aarch64" || arch == "arm64") {
+    return ElfMachine{true, false, /*EM_AARCH64=*/183, 0};
+  }
+  if (arch == "i386" || arch == "i686") {
+    return ElfMachine{false, false, /*EM_386=*/3, 0};
+  }
+  if (arch == "powerpc64le") {
+    // The ELFv2 ABI.
+    return ElfMachine{true, false, /*EM_PPC64=*/21, 2};
+  }
+  if (arch == "s390x") {
+    return ElfMachine{true, true, /*EM_S390=*/22, 0};
+  }
+  return std::nullopt;
+}
+
+// Returns the ELF OS/ABI identification for the given target.
+uint8_t ElfOSABIForTarget(const TargetTriple& target) {
+  return target.WithoutOSVersion().OS() == "freebsd" ? /*FreeBSD=*/9 : 0;
+}
+
+// Appends the fields of an ELF file in the target's byte order and word size.
+class ElfBuffer {
+ public:
+  explicit ElfBuffer(const ElfMachine& machine) : machine_(machine) {}
+
+  void Append(uint64_t value, int size) {
+    for (int i = 0; i < size; ++i) {
+      int shift = 8 * (machine_.big_endian ? size - 1 - i : i);
+      contents_.push_back(static_cast<char>((value >> shift) & 0xff));
+    }
+  }
+  void Append8(uint8_t value) { Append(value, 1); }
+  void Append16(uint16_t value) { Append(value, 2); }
+  void Append32(uint32_t value) { Append(value, 4); }
+  void AppendWord(uint64_t value) { Append(value, machine_.is_64_bit ? 8 : 4); }
+  void AppendBytes(absl::string_view bytes) {
+    contents_.append(bytes.data(), bytes.size());
+  }
+
+  // Pads the buffer, which starts at `base` in the file, to `alignment`.
+  void Align(uint64_t base, uint64_t alignment) {
+    while ((base + contents_.size()) % alignment != 0) {
+      contents_.push_back('\0');
+    }
+  }
+
+  const std::string& contents() const { return contents_; }
+  size_t size() const { return contents_.size(); }
+
+ private:
+  ElfMachine machine_;
+  std::string contents_;
+};
+
+// The placement of one section in the object.
+struct SectionHeader {
+  uint32_t name = 0;
+  uint32_t type = 0;
+  uint64_t flags = 0;
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  uint32_t link = 0;
+  uint32_t info = 0;
+  uint64_t alignment = 1;
+  uint64_t entry_size = 0;
+};
+
+// Writes the object that wraps `module_size` bytes of module contents for
+// `target`. The object is written as a header, then the contents, which are
+// copied from `module`, then the tables that describe them.
+bool WriteWrappedModule(const TargetTriple& target, const ElfMachine& machine,
+                        std::ifstream& module, uint64_t module_size,
+                        const std::string& output_path) {
+  constexpr uint32_t kSectionTypeProgBits = 1;
+  constexpr uint32_t kSectionTypeSymbolTable = 2;
+  constexpr uint32_t kSectionTypeStringTable = 3;
+  constexpr uint64_t kSectionFlagAlloc = 2;
+
+  uint64_t header_size = machine.is_64_bit ? 64 : 52;
+  uint64_t section_header_size = machine.is_64_bit ? 64 : 40;
+  uint64_t symbol_size = machine.is_64_bit ? 24 : 16;
+  uint64_t word_size = machine.is_64_bit ? 8 : 4;
+
+  SectionHeader sections[kSectionCount];
+  std::string section_names(1, '\0');
+  for (int i = kSwiftASTSection; i < kSectionCount; ++i) {
+    sections[i].name = section_names.size();
+    section_names.append(kSectionNames[i - 1]);
+    section_names.push_back('\0');
+  }
+
+  uint64_t module_offset = header_size;
+  while (module_offset % kModuleAlignment != 0) {
+    ++module_offset;
+  }
+  sections[kSwiftASTSection].type = kSectionTypeProgBits;
+  sections[kSwiftASTSection].flags = kSectionFlagAlloc;
+  sections[kSwiftASTSection].offset = module_offset;
+  sections[kSwiftASTSection].size = module_size;
+  sections[kSwiftASTSection].alignment = kModuleAlignment;
+
+  // Everything after the module's contents.
+  uint64_t trailer_offset = module_offset + module_size;
+  ElfBuffer trailer(machine);
+
+  sections[kGNUStackSection].type = kSectionTypeProgBits;
+  sections[kGNUStackSection].offset = trailer_offset;
+
+  std::string symbol_names(1, '\0');
+  symbol_names.append(kSwiftASTSymbol.data(), kSwiftASTSymbol.size());
+  symbol_names.push_back('\0');
+  sections[kStringTableSection].type = kSectionTypeStringTable;
+  sections[kStringTableSection].offset = trailer_offset + trailer.size();
+  sections[kStringTableSection].size = symbol_names.size();
+  trailer.AppendBytes(symbol_names);
+
+  // The null symbol, then a local object symbol that spans the module.
+  trailer.Align(trailer_offset, word_size);
+  sections[kSymbolTableSection].type = kSectionTypeSymbolTable;
+  sections[kSymbolTableSection].offset = trailer_offset + trailer.size();
+  sections[kSymbolTableSection].size = 2 * symbol_size;
+  sections[kSymbolTableSection].link = kStringTableSection;
+  sections[kSymbolTableSection].info = 2;
+  sections[kSymbolTableSection].alignment = word_size;
+  sections[kSymbolTableSection].entry_size = symbol_size;
+  constexpr uint8_t kLocalObjectSymbol = /*STB_LOCAL<<4|STT_OBJECT=*/1;
+  for (int i = 0; i < 2; ++i) {
+    uint32_t name = i == 0 ? 0 : 1;
+    uint8_t info = i == 0 ? 0 : kLocalObjectSymbol;
+    uint16_t section = i == 0 ? 0 : kSwiftASTSection;
+    uint64_t size = i == 0 ? 0 : module_size;
+    trailer.Append32(name);
+    if (machine.is_64_bit) {
+      trailer.Append8(info);
+      trailer.Append8(0);
+      trailer.Append16(section);
+      trailer.AppendWord(0);
+      trailer.AppendWord(size);
+    } else {
+      trailer.AppendWord(0);
+      trailer.AppendWord(size);
+      trailer.Append8(info);
+      trailer.Append8(0);
+      trailer.Append16(section);
+    }
+  }
+
+  sections[kSectionNameTableSection].type = kSectionTypeStringTable;
+  sections[kSectionNameTableSection].offset = trailer_offset + trailer.size();
+  sections[kSectionNameTableSection].size = section_names.size();
+  trailer.AppendBytes(section_names);
+
+  trailer.Align(trailer_offset, word_size);
+  uint64_t section_headers_offset = trailer_offset + trailer.size();
+  for (const SectionHeader& section : sections) {
+    trailer.Append32(section.name);
+    trailer.Append32(section.type);
+    trailer.AppendWord(section.flags);
+    trailer.AppendWord(/*address=*/0);
+    trailer.AppendWord(section.offset);
+    trailer.AppendWord(section.size);
+    trailer.Append32(section.link);
+    trailer.Append32(section.info);
+    trailer.AppendWord(section.alignment);
+    trailer.AppendWord(section.entry_size);
+  }
+  if (!machine.is_64_bit && trailer_offset + trailer.size() > UINT32_MAX) {
+    return false;
+  }
+
+  ElfBuffer header(machine);
+  header.AppendBytes("\x7f" "ELF");
+  header.Append8(machine.is_64_bit ? 2 : 1);
+  header.Append8(machine.big_endian ? 2 : 1);
+  header.Append8(/*EV_CURRENT=*/1);
+  header.Append8(ElfOSABIForTarget(target));
+  header.Align(0, 16);
+  header.Append16(/*ET_REL=*/1);
+  header.Append16(machine.machine);
+  header.Append32(/*EV_CURRENT=*/1);
+  header.AppendWord(/*entry=*/0);
+  header.AppendWord(/*program_headers_offset=*/0);
+  header.AppendWord(section_headers_offset);
+  header.Append32(machine.flags);
+  header.Append16(header_size);
+  header.Append16(/*program_header_size=*/0);
+  header.Append16(/*program_header_count=*/0);
+  header.Append16(section_header_size);
+  header.Append16(kSectionCount);
+  header.Append16(kSectionNameTableSection);
+  header.Align(0, kModuleAlignment);
+
+  std::ofstream output(output_path, std::ios::binary | std::ios::trunc);
+  output.write(header.contents().data(), header.size());
+  // Copy the module through the stream buffers rather than reading it whole;
+  // modules with many dependencies can be large.
+  std::streampos module_start = output.tellp();
+  if (module_size > 0) {
+    output << module.rdbuf();
+  }
+  if (!output.good() ||
+      static_cast<uint64_t>(output.tellp() - module_start) != module_size) {
+    return false;
+  }
+  output.write(trailer.contents().data(), trailer.size());
+  output.close();
+  return output.good();
+}
+
+}  // namespace
+
+bool UseNativeModuleWrap(const std::vector<std::string>& args) {
+  if (args.empty() || args.front() != "-modulewrap") {
+    return false;
+  }
+  const char* setting = std::getenv("RULES_SWIFT_NATIVE_MODULEWRAP");
+  return setting != nullptr && std::strcmp(setting, "1") == 0;
+}
+
+bool WrapModule(const std::vector<std::string>& args) {
+  std::string module_path;
+  std::string output_path;
+  std::optional<TargetTriple> target;
+  for (auto it = args.begin(); it != args.end(); ++it) {
+    if (*it == "-modulewrap") {
+      continue;
+    } else if (*it == "-o" && it + 1 != args.end()) {
+      output_path = *++it;
+    } else if (*it == "-target" && it + 1 != args.end()) {
+      target = TargetTriple::Parse(*++it);
+    } else if (absl::StartsWith(*it, "-") || !module_path.empty()) {
+      return false;
+    } else {
+      module_path = *it;
+    }
+  }
+  if (module_path.empty() || output_path.empty() || !target.has_value()) {
+    return false;
+  }
+  std::optional<ElfMachine> machine = ElfMachineForTarget(*target);
+  if (!machine.has_value()) {
+    return false;
+  }
+
+  // Leave anything that isn't a serialized module to the frontend, which
+  // reports the error.
+  std::error_code ec;
+  uint64_t module_size = std::filesystem::file_size(module_path, ec);
+  if (ec || module_size < kSwiftModuleSignature.size()) {
+    return false;
+  }
+  std::ifstream module(module_path, std::ios::binary);
+  char signature[4];
+  if (!module.read(signature, sizeof(signature)) ||
+      absl::string_view(signature, sizeof(signature)) !=
+          kSwiftModuleSignature) {
+    return false;
+  }
+  module.seekg(0);
+
+  return WriteWrappedModule(*target, *machine, module, module_size,
+                            output_path);
+}
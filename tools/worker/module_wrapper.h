@@ -0,0 +1,39 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_MODULE_WRAPPER_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_MODULE_WRAPPER_H_
+
+#include <string>
+#include <vector>
+
+// Returns true if `args` are the arguments of a `-modulewrap` invocation and
+// the worker should write the object itself rather than spawning the frontend.
+// This is opt-in, with `RULES_SWIFT_NATIVE_MODULEWRAP=1`, until the objects it
+// writes are tested against the frontend's.
+bool UseNativeModuleWrap(const std::vector<std::string>& args);
+
+// Does what `swiftc -modulewrap` does for the given arguments, which are
+// `-modulewrap`, the `.swiftmodule` to wrap, `-o <output>`, and
+// `-target <triple>`: writes an ELF relocatable object whose `.swift_ast`
+// section holds the module's contents, so that the debugger can find the
+// module in a linked binary.
+//
+// The module is streamed from its file into the object. Returns false if the
+// arguments, the target, or the module aren't ones it understands (for example,
+// a target that doesn't use ELF) or the object couldn't be written, in which
+// case the frontend should be run instead.
+bool WrapModule(const std::vector<std::string>& args);
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_MODULE_WRAPPER_H_
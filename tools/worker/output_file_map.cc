@@ -14,12 +14,20 @@
 
 #include "tools/worker/output_file_map.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
-#include <map>
+#include <iterator>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 namespace {
 
@@ -51,136 +59,297 @@ static std::string MakeIncrementalOutputPath(std::string path,
   return path;
 }
 
+// The kinds of outputs that are produced in the incremental storage area and
+// copied to the locations Bazel declared after each compile.
+bool IsIncrementalOutputKind(absl::string_view kind) {
+  return kind == "object" || kind == "const-values" || kind == "dependencies" ||
+         kind == "swiftdoc" || kind == "swiftinterface" ||
+         kind == "swiftmodule" || kind == "swiftsourceinfo";
+}
+
+// Streams an output file map, which is an object mapping each source path to
+// an object mapping output kinds to paths, and reports each source with its
+// outputs (sorted by kind) as soon as it has been read, without building a
+// DOM.
+class OutputFileMapParser : public nlohmann::json_sax<nlohmann::json> {
+ public:
+  using Outputs = std::vector<std::pair<std::string, std::string>>;
+  using SourceCallback =
+      std::function<void(absl::string_view, const Outputs&)>;
+
+  explicit OutputFileMapParser(SourceCallback on_source)
+      : on_source_(std::move(on_source)) {}
+
+  bool null() override { return false; }
+  bool boolean(bool) override { return false; }
+  bool number_integer(number_integer_t) override { return false; }
+  bool number_unsigned(number_unsigned_t) override { return false; }
+  bool number_float(number_float_t, const string_t&) override { return false; }
+  bool binary(binary_t&) override { return false; }
+  bool start_array(std::size_t) override { return false; }
+  bool end_array() override { return false; }
+
+  bool string(string_t& value) override {
+    if (depth_ != 2) {
+      return false;
+    }
+    outputs_.emplace_back(std::move(kind_), std::move(value));
+    return true;
+  }
+
+  bool start_object(std::size_t) override {
+    if (++depth_ > 2) {
+      return false;
+    }
+    if (depth_ == 2) {
+      outputs_.clear();
+    }
+    return true;
+  }
+
+  bool key(string_t& value) override {
+    if (depth_ == 1) {
+      source_ = std::move(value);
+    } else {
+      kind_ = std::move(value);
+    }
+    return true;
+  }
+
+  bool end_object() override {
+    if (depth_-- == 2) {
+      std::sort(outputs_.begin(), outputs_.end());
+      on_source_(source_, outputs_);
+    }
+    return true;
+  }
+
+  bool parse_error(std::size_t, const std::string&,
+                   const nlohmann::detail::exception&) override {
+    return false;
+  }
+
+ private:
+  SourceCallback on_source_;
+  int depth_ = 0;
+  std::string source_;
+  std::string kind_;
+  Outputs outputs_;
+};
+
+// Appends `value` to `out` as a JSON string literal.
+void AppendJsonString(std::string& out, absl::string_view value) {
+  static constexpr char kHexDigits[] = "0123456789abcdef";
+  out.push_back('"');
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        out.append("\\\"");
+        break;
+      case '\\':
+        out.append("\\\\");
+        break;
+      case '\n':
+        out.append("\\n");
+        break;
+      case '\t':
+        out.append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out.append("\\u00");
+          out.push_back(kHexDigits[(c >> 4) & 0xf]);
+          out.push_back(kHexDigits[c & 0xf]);
+        } else {
+          out.push_back(c);
+        }
+    }
+  }
+  out.push_back('"');
+}
+
 };  // end namespace
 
-void OutputFileMap::ReadFromPath(const std::string& path,
+absl::string_view OutputFileMap::Intern(absl::string_view value) {
+  auto it = interned_.find(value);
+  if (it != interned_.end()) {
+    return *it;
+  }
+  absl::string_view interned = strings_.emplace_back(value);
+  interned_.insert(interned);
+  return interned;
+}
+
+bool OutputFileMap::ReadFromPath(const std::string& path,
                                  const std::string& emit_module_path,
                                  const std::string& emit_objc_header_path) {
-  std::ifstream stream(path);
-  stream >> json_;
-  UpdateForIncremental(path, emit_module_path, emit_objc_header_path);
+  std::ifstream stream(path, std::ios::binary);
+  if (!stream.good()) {
+    *this = OutputFileMap();
+    return false;
+  }
+  std::string contents((std::istreambuf_iterator<char>(stream)),
+                       std::istreambuf_iterator<char>());
+  return Parse(path, contents, emit_module_path, emit_objc_header_path);
 }
 
-void OutputFileMap::WriteToPath(const std::string& path) {
-  std::ofstream stream(path);
-  stream << json_;
-}
+bool OutputFileMap::Parse(const std::string& path, absl::string_view contents,
+                          const std::string& emit_module_path,
+                          const std::string& emit_objc_header_path) {
+  *this = OutputFileMap();
 
-void OutputFileMap::UpdateForIncremental(
-    const std::string& path, const std::string& emit_module_path,
-    const std::string& emit_objc_header_path) {
   bool derived =
       path.find(".derived_output_file_map.json") != std::string::npos;
+  OutputFileMapParser parser(
+      [this, derived](
+          absl::string_view source,
+          const std::vector<std::pair<std::string, std::string>>& outputs) {
+        AddSource(source, outputs, derived);
+      });
+  if (!nlohmann::json::sax_parse(contents.begin(), contents.end(), &parser)) {
+    *this = OutputFileMap();
+    return false;
+  }
+  Finish(path, emit_module_path, emit_objc_header_path, derived);
+  return true;
+}
 
-  nlohmann::json new_output_file_map;
-  std::map<std::string, std::string> incremental_outputs;
-  std::map<std::string, std::string> incremental_inputs;
-  std::vector<std::string> incremental_cleanup_outputs;
+void OutputFileMap::WriteToPath(const std::string& path) const {
+  std::string contents = Serialize();
+  std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+  stream.write(contents.data(), contents.size());
+}
 
-  // The empty string key is used to represent outputs that are for the whole
-  // module, rather than for a particular source file.
-  nlohmann::json module_map;
-  // Derive the swiftdeps file name from the .output-file-map.json name.
-  std::string new_path =
-      std::filesystem::path(path).replace_extension(".swiftdeps").string();
-  auto swiftdeps_path = MakeIncrementalOutputPath(new_path, derived);
-  module_map["swift-dependencies"] = swiftdeps_path;
-  new_output_file_map[""] = module_map;
-
-  for (auto& element : json_.items()) {
-    auto src = element.key();
-    auto outputs = element.value();
-
-    nlohmann::json src_map;
-    std::string swiftdeps_path;
-
-    // Process the outputs for the current source file.
-    for (auto& output : outputs.items()) {
-      auto kind = output.key();
-      auto path = output.value().get<std::string>();
-
-      if (kind == "object" || kind == "const-values") {
-        // If the file kind is "object" or "const-values", we want to update the
-        // path to point to the incremental storage area and then add a
-        // "swift-dependencies" in the same location.
-        auto new_path = MakeIncrementalOutputPath(path, derived);
-        src_map[kind] = new_path;
-        incremental_outputs[path] = new_path;
-
-        if (swiftdeps_path.empty()) {
-          swiftdeps_path = std::filesystem::path(new_path)
-                               .replace_extension(".swiftdeps")
-                               .string();
-        }
+std::string OutputFileMap::Serialize() const {
+  std::string contents = "{";
+  for (size_t i = 0; i < records_.size(); ++i) {
+    const Record& record = records_[i];
+    if (i == 0 || records_[i - 1].source != record.source) {
+      if (i != 0) {
+        contents.append("},");
+      }
+      AppendJsonString(contents, record.source);
+      contents.append(":{");
+    } else {
+      contents.push_back(',');
+    }
+    AppendJsonString(contents, record.kind);
+    contents.push_back(':');
+    AppendJsonString(contents, record.path);
+  }
+  if (!records_.empty()) {
+    contents.push_back('}');
+  }
+  contents.push_back('}');
+  return contents;
+}
 
-        incremental_cleanup_outputs.push_back(swiftdeps_path);
-      } else if (kind == "swiftdoc" || kind == "swiftinterface" ||
-                 kind == "swiftmodule" || kind == "swiftsourceinfo") {
-        // Module/interface outputs should be moved to the incremental storage
-        // area without additional processing.
-        auto new_path = MakeIncrementalOutputPath(path, derived);
-        src_map[kind] = new_path;
-        incremental_outputs[path] = new_path;
-
-        if (swiftdeps_path.empty()) {
-          swiftdeps_path = std::filesystem::path(new_path)
-                               .replace_extension(".swiftdeps")
-                               .string();
-        }
+void OutputFileMap::AddSource(
+    absl::string_view source,
+    const std::vector<std::pair<std::string, std::string>>& outputs,
+    bool derived) {
+  absl::string_view interned_source = Intern(source);
+  absl::string_view swiftdeps_path;
+  size_t source_outputs_begin = source_output_paths_.size();
 
-        incremental_cleanup_outputs.push_back(swiftdeps_path);
-      } else if (kind == "swift-dependencies") {
-        // If there was already a "swift-dependencies" entry present, ignore it.
-        // (This shouldn't happen because the build rules won't do this, but
-        // check just in case.)
-        std::cerr << "There was a 'swift-dependencies' entry for " << src
-                  << ", but the build rules should not have done this; "
-                  << "ignoring it.\n";
-      } else {
-        // Otherwise, just copy the mapping over verbatim.
-        src_map[kind] = path;
+  // Process the outputs for the current source file.
+  for (const auto& [kind, path] : outputs) {
+    absl::string_view interned_kind = Intern(kind);
+    if (IsIncrementalOutputKind(kind)) {
+      // Objects, constant values, dependency files, and module/interface
+      // outputs are moved to the incremental storage area. The first of them
+      // also determines where the source's "swift-dependencies" go.
+      absl::string_view new_path =
+          Intern(MakeIncrementalOutputPath(path, derived));
+      records_.push_back({interned_source, interned_kind, new_path});
+      incremental_outputs_.emplace_back(Intern(path), new_path);
+      source_output_paths_.push_back(new_path);
+
+      if (swiftdeps_path.empty()) {
+        swiftdeps_path =
+            Intern(std::filesystem::path(std::string(new_path))
+                       .replace_extension(".swiftdeps")
+                       .string());
+        incremental_cleanup_outputs_.push_back(swiftdeps_path);
       }
+    } else if (kind == "swift-dependencies") {
+      // If there was already a "swift-dependencies" entry present, ignore it.
+      // (This shouldn't happen because the build rules won't do this, but
+      // check just in case.)
+      std::cerr << "There was a 'swift-dependencies' entry for " << source
+                << ", but the build rules should not have done this; "
+                << "ignoring it.\n";
+    } else {
+      // Otherwise, just copy the mapping over verbatim.
+      records_.push_back({interned_source, interned_kind, Intern(path)});
     }
+  }
 
-    // When split compiling both output_file_maps need src level swiftdeps
-    if (!swiftdeps_path.empty()) {
-      src_map["swift-dependencies"] = swiftdeps_path;
-    }
+  // When split compiling both output_file_maps need src level swiftdeps
+  if (!swiftdeps_path.empty()) {
+    records_.push_back(
+        {interned_source, Intern("swift-dependencies"), swiftdeps_path});
+    source_output_ranges_.emplace_back(swiftdeps_path, source_outputs_begin);
+  }
+}
 
-    new_output_file_map[src] = src_map;
+void OutputFileMap::Finish(const std::string& path,
+                           const std::string& emit_module_path,
+                           const std::string& emit_objc_header_path,
+                           bool derived) {
+  // The empty string key is used to represent outputs that are for the whole
+  // module, rather than for a particular source file. Derive the swiftdeps file
+  // name from the .output-file-map.json name. An entry for the empty key in the
+  // original map takes its place, and the driver keeps the module's graph
+  // wherever that entry's rewritten "swift-dependencies" points.
+  incremental_module_swiftdeps_ = Intern(MakeIncrementalOutputPath(
+      std::filesystem::path(path).replace_extension(".swiftdeps").string(),
+      derived));
+  bool has_module_entry = false;
+  for (const Record& record : records_) {
+    if (!record.source.empty()) {
+      continue;
+    }
+    has_module_entry = true;
+    if (record.kind == "swift-dependencies") {
+      incremental_module_swiftdeps_ = record.path;
+      break;
+    }
+  }
+  if (!has_module_entry) {
+    records_.insert(records_.begin(), {Intern(""), Intern("swift-dependencies"),
+                                       incremental_module_swiftdeps_});
   }
 
   // If we don't generate a swiftmodule, don't try to copy those files
   if (!emit_module_path.empty()) {
-    auto swiftmodule_path = emit_module_path;
-    auto copied_swiftmodule_path =
-        MakeIncrementalOutputPath(swiftmodule_path, derived);
-    incremental_inputs[swiftmodule_path] = copied_swiftmodule_path;
-
-    std::string swiftdoc_path = std::filesystem::path(swiftmodule_path)
-                                    .replace_extension(".swiftdoc")
-                                    .string();
-    auto copied_swiftdoc_path =
-        MakeIncrementalOutputPath(swiftdoc_path, derived);
-    incremental_inputs[swiftdoc_path] = copied_swiftdoc_path;
-
-    std::string swiftsourceinfo_path =
-        std::filesystem::path(swiftmodule_path)
-            .replace_extension(".swiftsourceinfo")
-            .string();
-    auto copied_swiftsourceinfo_path =
-        MakeIncrementalOutputPath(swiftsourceinfo_path, derived);
-    incremental_inputs[swiftsourceinfo_path] = copied_swiftsourceinfo_path;
+    std::filesystem::path swiftmodule_path(emit_module_path);
+    for (const char* extension :
+         {".swiftmodule", ".swiftdoc", ".swiftsourceinfo"}) {
+      std::string input_path =
+          swiftmodule_path.replace_extension(extension).string();
+      incremental_inputs_.emplace_back(
+          Intern(input_path),
+          Intern(MakeIncrementalOutputPath(input_path, derived)));
+    }
   }
 
   if (!emit_objc_header_path.empty()) {
-    auto copied_objc_header_path =
-        MakeIncrementalOutputPath(emit_objc_header_path, derived);
-    incremental_inputs[emit_objc_header_path] = copied_objc_header_path;
+    incremental_inputs_.emplace_back(
+        Intern(emit_objc_header_path),
+        Intern(MakeIncrementalOutputPath(emit_objc_header_path, derived)));
   }
 
-  json_ = new_output_file_map;
-  incremental_outputs_ = incremental_outputs;
-  incremental_inputs_ = incremental_inputs;
-  incremental_cleanup_outputs_ = incremental_cleanup_outputs;
+  // Now that no more outputs will be added, the per-source ranges can be
+  // turned into spans.
+  absl::Span<const absl::string_view> all_outputs(source_output_paths_);
+  for (size_t i = 0; i < source_output_ranges_.size(); ++i) {
+    size_t begin = source_output_ranges_[i].second;
+    size_t end = i + 1 < source_output_ranges_.size()
+                     ? source_output_ranges_[i + 1].second
+                     : source_output_paths_.size();
+    incremental_source_outputs_.emplace_back(
+        source_output_ranges_[i].first,
+        all_outputs.subspan(begin, end - begin));
+  }
 }
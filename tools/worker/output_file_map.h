@@ -15,64 +15,139 @@
 #ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_OUTPUT_FILE_MAP_H
 #define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_OUTPUT_FILE_MAP_H
 
-#include <map>
-#include <nlohmann/json.hpp>
+#include <deque>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 // Supports loading and rewriting a `swiftc` output file map to support
 // incremental compilation.
 //
+// The map is parsed in a single streaming pass into a flat table of
+// (source, kind, path) records whose strings are interned in storage owned by
+// the map, so the accessors below return views into it rather than copies.
+// The views remain valid for the lifetime of the map.
+//
 // See
 // https://github.com/apple/swift/blob/master/docs/Driver.md#output-file-maps
 // for more information on how the Swift driver uses this file.
 class OutputFileMap {
  public:
-  explicit OutputFileMap() {}
+  // A path declared to Bazel, paired with its location in the incremental
+  // storage area.
+  using PathPair = std::pair<absl::string_view, absl::string_view>;
+
+  // A per-source swiftdeps file in the incremental storage area, paired with
+  // the other files in the storage area that are produced along with it.
+  using SourceOutputs =
+      std::pair<absl::string_view, absl::Span<const absl::string_view>>;
+
+  // One entry of the rewritten output file map.
+  struct Record {
+    absl::string_view source;
+    absl::string_view kind;
+    absl::string_view path;
+  };
 
-  // The in-memory JSON-based representation of the output file map.
-  const nlohmann::json& json() const { return json_; }
+  OutputFileMap() = default;
+  OutputFileMap(OutputFileMap&&) = default;
+  OutputFileMap& operator=(OutputFileMap&&) = default;
 
-  // A map containing expected output files that will be generated in the
-  // incremental storage area. The key is the original object path; the
-  // corresponding value is its location in the incremental storage area.
-  const std::map<std::string, std::string> incremental_outputs() const {
+  // The views handed out by the map point into its own storage.
+  OutputFileMap(const OutputFileMap&) = delete;
+  OutputFileMap& operator=(const OutputFileMap&) = delete;
+
+  // The entries of the rewritten output file map, grouped by source.
+  absl::Span<const Record> records() const { return records_; }
+
+  // Expected output files that will be generated in the incremental storage
+  // area. The first path is the original object path; the second is its
+  // location in the incremental storage area.
+  absl::Span<const PathPair> incremental_outputs() const {
     return incremental_outputs_;
   }
 
-  // A map containing expected output files that will be generated in the
-  // non-incremental storage area, but need to be copied back at the start of
-  // the next compile. The key is the original object path; the corresponding
-  // value is its location in the incremental storage area.
-  const std::map<std::string, std::string> incremental_inputs() const {
+  // Expected output files that will be generated in the non-incremental
+  // storage area, but need to be copied back at the start of the next
+  // compile. The first path is the original object path; the second is its
+  // location in the incremental storage area.
+  absl::Span<const PathPair> incremental_inputs() const {
     return incremental_inputs_;
   }
 
-  // A list of output files that will be generated in the incremental storage
-  // area, and need to be cleaned up if a corrupt module is detected.
-  const std::vector<std::string> incremental_cleanup_outputs() const {
+  // Output files that will be generated in the incremental storage area, and
+  // need to be cleaned up if a corrupt module is detected.
+  absl::Span<const absl::string_view> incremental_cleanup_outputs() const {
     return incremental_cleanup_outputs_;
   }
 
+  // Each per-source swiftdeps file in the incremental storage area, with the
+  // other files in the storage area that are produced along with it. Losing
+  // any of them means that source file has to be compiled again.
+  absl::Span<const SourceOutputs> incremental_source_outputs() const {
+    return incremental_source_outputs_;
+  }
+
+  // The module-level swiftdeps file in the incremental storage area, which
+  // holds the driver's dependency graph for the whole module.
+  absl::string_view incremental_module_swiftdeps() const {
+    return incremental_module_swiftdeps_;
+  }
+
   // Reads the output file map from the JSON file at the given path, and updates
-  // it to support incremental builds.
-  void ReadFromPath(const std::string& path,
+  // it to support incremental builds. Returns false if the file could not be
+  // read or parsed.
+  bool ReadFromPath(const std::string& path,
                     const std::string& emit_module_path,
                     const std::string& emit_objc_header_path);
 
-  // Writes the output file map as JSON to the file at the given path.
-  void WriteToPath(const std::string& path);
+  // Like `ReadFromPath`, but parses `contents`, which were read from the file
+  // at the given path.
+  bool Parse(const std::string& path, absl::string_view contents,
+             const std::string& emit_module_path,
+             const std::string& emit_objc_header_path);
+
+  // Writes the rewritten output file map as JSON to the file at the given
+  // path.
+  void WriteToPath(const std::string& path) const;
+
+  // Returns the rewritten output file map as JSON.
+  std::string Serialize() const;
 
  private:
-  // Modifies the output file map's JSON structure in-place to replace file
-  // paths with equivalents in the incremental storage area.
-  void UpdateForIncremental(const std::string& path,
-                            const std::string& emit_module_path,
-                            const std::string& emit_objc_header_path);
-
-  nlohmann::json json_;
-  std::map<std::string, std::string> incremental_outputs_;
-  std::map<std::string, std::string> incremental_inputs_;
-  std::vector<std::string> incremental_cleanup_outputs_;
+  // Returns a view of a copy of `value` owned by the map, sharing the copy
+  // with every other equal string that was interned.
+  absl::string_view Intern(absl::string_view value);
+
+  // Appends the records for one source of the original map to the rewritten
+  // map, replacing file paths with equivalents in the incremental storage
+  // area.
+  void AddSource(
+      absl::string_view source,
+      const std::vector<std::pair<std::string, std::string>>& outputs,
+      bool derived);
+
+  // Adds the module-level entries once every source has been read.
+  void Finish(const std::string& path, const std::string& emit_module_path,
+              const std::string& emit_objc_header_path, bool derived);
+
+  // A deque never moves its elements, so views of the strings stay valid as
+  // more are interned.
+  std::deque<std::string> strings_;
+  absl::flat_hash_set<absl::string_view> interned_;
+
+  std::vector<Record> records_;
+  std::vector<PathPair> incremental_outputs_;
+  std::vector<PathPair> incremental_inputs_;
+  std::vector<absl::string_view> incremental_cleanup_outputs_;
+  std::vector<absl::string_view> source_output_paths_;
+  std::vector<std::pair<absl::string_view, size_t>> source_output_ranges_;
+  std::vector<SourceOutputs> incremental_source_outputs_;
+  absl::string_view incremental_module_swiftdeps_;
 };
 
-#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_OUTPUT_FILE_MAP_H_
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_OUTPUT_FILE_MAP_H
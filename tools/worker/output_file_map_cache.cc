@@ -0,0 +1,173 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/worker/output_file_map_cache.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "tools/common/file_digest.h"
+#include "tools/common/file_system.h"
+#include "tools/worker/file_snapshot.h"
+#include "tools/worker/output_file_map.h"
+
+using bazel_rules_swift::LongPath;
+using bazel_rules_swift::XXH64Digest;
+
+namespace {
+
+// The number of maps to remember. Each one holds every path of a module's
+// outputs, so the cache is bounded rather than growing with every module the
+// worker has compiled.
+constexpr size_t kMaxEntries = 128;
+
+// Reads the whole file at `path` into `contents`.
+bool ReadFile(const std::string& path, std::string& contents) {
+  std::ifstream stream(LongPath(path), std::ios::binary);
+  if (!stream.good()) {
+    return false;
+  }
+  contents.assign(std::istreambuf_iterator<char>(stream),
+                  std::istreambuf_iterator<char>());
+  return !stream.bad();
+}
+
+// Returns true if the file at `path` exists and contains exactly `contents`.
+bool FileHasContents(const std::string& path, const std::string& contents) {
+  std::error_code ec;
+  uintmax_t size = std::filesystem::file_size(LongPath(path), ec);
+  if (ec || size != contents.size()) {
+    return false;
+  }
+  std::string existing;
+  return ReadFile(path, existing) && existing == contents;
+}
+
+// Replaces the file at `path` with `contents` atomically, so that a compiler
+// never sees a partially written map.
+bool WriteFile(const std::string& path, const std::string& contents) {
+  std::string temp_path = path + ".tmp";
+  {
+    std::ofstream stream(LongPath(temp_path),
+                         std::ios::binary | std::ios::trunc);
+    stream.write(contents.data(), contents.size());
+    if (!stream.good()) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(LongPath(temp_path), LongPath(path), ec);
+  if (ec) {
+    std::filesystem::remove(LongPath(temp_path), ec);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+OutputFileMapCache& OutputFileMapCache::Shared() {
+  static OutputFileMapCache* cache = new OutputFileMapCache();
+  return *cache;
+}
+
+std::shared_ptr<const OutputFileMap> OutputFileMapCache::Rewrite(
+    const std::string& path, const std::string& rewritten_path,
+    const std::string& emit_module_path,
+    const std::string& emit_objc_header_path, std::ostream& stderr_stream) {
+  std::string contents;
+  if (!ReadFile(path, contents)) {
+    stderr_stream << "swift_worker: Could not read output file map " << path
+                  << "\n";
+    return nullptr;
+  }
+  uint64_t digest = XXH64Digest(contents);
+
+  std::shared_ptr<const OutputFileMap> map;
+  std::shared_ptr<const std::string> rewritten_contents;
+  std::optional<FileSnapshot> rewritten_snapshot;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    if (it != entries_.end() && it->second.digest == digest &&
+        it->second.emit_module_path == emit_module_path &&
+        it->second.emit_objc_header_path == emit_objc_header_path) {
+      Entry& entry = it->second;
+      entry.last_use = ++use_counter_;
+      map = entry.map;
+      rewritten_contents = entry.rewritten_contents;
+      if (entry.rewritten_path == rewritten_path) {
+        rewritten_snapshot = entry.rewritten_snapshot;
+      }
+    }
+  }
+
+  if (map == nullptr) {
+    auto parsed_map = std::make_shared<OutputFileMap>();
+    if (!parsed_map->Parse(path, contents, emit_module_path,
+                           emit_objc_header_path)) {
+      stderr_stream << "swift_worker: Could not parse output file map " << path
+                    << "\n";
+      return nullptr;
+    }
+    rewritten_contents =
+        std::make_shared<const std::string>(parsed_map->Serialize());
+    map = std::move(parsed_map);
+  }
+
+  // The rewritten file only needs to be read back if it may have changed since
+  // this worker last wrote or verified it.
+  std::optional<FileSnapshot> current = FileSnapshotCache::Stat(rewritten_path);
+  bool up_to_date = current.has_value() && rewritten_snapshot.has_value() &&
+                    current->SameFileAs(*rewritten_snapshot);
+  if (!up_to_date && !FileHasContents(rewritten_path, *rewritten_contents)) {
+    if (!WriteFile(rewritten_path, *rewritten_contents)) {
+      stderr_stream << "swift_worker: Could not write output file map "
+                    << rewritten_path << "\n";
+      return nullptr;
+    }
+    current = FileSnapshotCache::Stat(rewritten_path);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& entry = entries_[path];
+  entry.digest = digest;
+  entry.emit_module_path = emit_module_path;
+  entry.emit_objc_header_path = emit_objc_header_path;
+  entry.map = map;
+  entry.rewritten_contents = rewritten_contents;
+  entry.rewritten_path = rewritten_path;
+  entry.rewritten_snapshot = current;
+  entry.last_use = ++use_counter_;
+
+  if (entries_.size() > kMaxEntries) {
+    auto oldest = entries_.begin();
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->second.last_use < oldest->second.last_use) {
+        oldest = it;
+      }
+    }
+    entries_.erase(oldest);
+  }
+  return map;
+}
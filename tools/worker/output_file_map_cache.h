@@ -0,0 +1,76 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_OUTPUT_FILE_MAP_CACHE_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_OUTPUT_FILE_MAP_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "tools/worker/file_snapshot.h"
+#include "tools/worker/output_file_map.h"
+
+// Remembers the output file maps that the worker has rewritten for incremental
+// compilation, so that a map whose contents haven't changed since an earlier
+// request is neither parsed nor rewritten again.
+class OutputFileMapCache {
+ public:
+  // Returns the cache shared by the whole process.
+  static OutputFileMapCache& Shared();
+
+  // Reads the output file map at `path`, rewrites it for incremental
+  // compilation (see `OutputFileMap::ReadFromPath`), and makes sure that the
+  // rewritten map is at `rewritten_path`.
+  //
+  // If the map's contents (by digest) and the emit paths are the same as in an
+  // earlier request, the earlier result is reused. The rewritten file is only
+  // written if its contents differ from what is already there, so that its
+  // modification time doesn't change when the map doesn't.
+  //
+  // Returns nullptr if the map could not be read, parsed, or written, after
+  // describing the failure in `stderr_stream`.
+  std::shared_ptr<const OutputFileMap> Rewrite(
+      const std::string& path, const std::string& rewritten_path,
+      const std::string& emit_module_path,
+      const std::string& emit_objc_header_path, std::ostream& stderr_stream);
+
+ private:
+  struct Entry {
+    uint64_t digest = 0;
+    std::string emit_module_path;
+    std::string emit_objc_header_path;
+    std::shared_ptr<const OutputFileMap> map;
+    std::shared_ptr<const std::string> rewritten_contents;
+
+    // The state of the rewritten file after it was last written or verified,
+    // so that it doesn't have to be read again while it is unchanged.
+    std::string rewritten_path;
+    std::optional<FileSnapshot> rewritten_snapshot;
+
+    uint64_t last_use = 0;
+  };
+
+  OutputFileMapCache() = default;
+
+  std::mutex mutex_;
+  absl::flat_hash_map<std::string, Entry> entries_;
+  uint64_t use_counter_ = 0;
+};
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_OUTPUT_FILE_MAP_CACHE_H_
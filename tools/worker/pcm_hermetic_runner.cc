@@ -14,14 +14,18 @@
 
 #include "tools/worker/pcm_hermetic_runner.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <filesystem>
 #include <map>
-#include <sstream>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "tools/common/process.h"
+#include "tools/worker/frontend_plan.h"
 #include "tools/worker/hermetic_symlink.h"
 
 namespace {
@@ -49,72 +53,294 @@ void ReplaceAll(std::string& arg, const std::string& needle,
   }
 }
 
-int CaptureFrontendCommand(const std::vector<std::string>& args,
-                           std::map<std::string, std::string>* env,
-                           std::ostream* stderr_stream, std::string* captured) {
-  std::vector<std::string> driver_args = args;
-  driver_args.push_back("-###");
-
-  std::stringstream sink;
-  int rc = RunSubProcess(driver_args, env, &sink, /*stdout_to_stderr=*/true);
-  *captured = sink.str();
-  if (rc != 0) {
-    (*stderr_stream) << "error: hermetic-pcm: swiftc -### exited " << rc
-                     << ":\n"
-                     << *captured;
-  }
-  return rc;
-}
+// The module-specific parts of a driver invocation, which are the only parts
+// that a cached frontend plan allows to vary.
+struct DriverArgShape {
+  // The driver invocation with the module-specific values removed. Plans are
+  // only shared between invocations with equal keys.
+  std::string key;
 
-std::vector<std::string> TokenizeShellLine(const std::string& line) {
-  std::vector<std::string> tokens;
-  std::string token;
-  bool in_quotes = false;
-  for (size_t i = 0; i < line.size(); ++i) {
-    char c = line[i];
-    if (c == '\\' && i + 1 < line.size()) {
-      token.push_back(line[i + 1]);
-      ++i;
+  // The values of `-module-name` and `-o`, and the input module map.
+  std::vector<std::string> slot_values;
+
+  // The `-Xcc` arguments, which the driver passes through to the frontend
+  // verbatim, flattened into `-Xcc <arg>` pairs.
+  std::vector<std::string> xcc_args;
+};
+
+// The number of entries in `DriverArgShape::slot_values`.
+constexpr size_t kSlotCount = 3;
+
+// Splits a driver invocation into its shape. Returns nothing if the
+// invocation doesn't have exactly one of each module-specific value, in which
+// case its frontend plan isn't cached.
+std::optional<DriverArgShape> ShapeOfDriverArgs(
+    const std::vector<std::string>& tool_args,
+    const std::vector<std::string>& args, const std::string& developer_dir) {
+  DriverArgShape shape;
+  shape.slot_values.resize(kSlotCount);
+  auto set_slot = [&](size_t slot, const std::string& value) {
+    if (!shape.slot_values[slot].empty() || value.empty()) return false;
+    shape.slot_values[slot] = value;
+    shape.key += '\x01' + std::to_string(slot) + '\0';
+    return true;
+  };
+
+  shape.key = developer_dir + '\0';
+  for (const std::string& arg : tool_args) {
+    shape.key += arg + '\0';
+  }
+  for (size_t i = 0; i < args.size(); ++i) {
+    const std::string& arg = args[i];
+    if (arg == "-Xcc" && i + 1 < args.size()) {
+      shape.xcc_args.push_back(arg);
+      shape.xcc_args.push_back(args[++i]);
       continue;
     }
-    if (c == '"') {
-      in_quotes = !in_quotes;
+    if ((arg == "-module-name" || arg == "-o") && i + 1 < args.size()) {
+      shape.key += arg + '\0';
+      if (!set_slot(arg == "-module-name" ? 0 : 1, args[++i])) {
+        return std::nullopt;
+      }
       continue;
     }
-    if (!in_quotes && (c == ' ' || c == '\t')) {
-      if (!token.empty()) {
-        tokens.push_back(std::move(token));
-        token.clear();
+    if (!arg.empty() && arg[0] != '-' && arg.size() > 10 &&
+        arg.compare(arg.size() - 10, 10, ".modulemap") == 0) {
+      if (!set_slot(2, arg)) {
+        return std::nullopt;
       }
       continue;
     }
-    if (!in_quotes && c == '#' && token.empty()) {
-      break;
+    shape.key += arg + '\0';
+  }
+  for (const std::string& value : shape.slot_values) {
+    if (value.empty()) return std::nullopt;
+  }
+  // Whether there are any `-Xcc` arguments decides whether the plan knows
+  // where they go.
+  shape.key += shape.xcc_args.empty() ? "\x02" : "\x03";
+  return shape;
+}
+
+// A frontend command captured from the driver, with the module-specific
+// values replaced by references to the driver invocation that instantiates it.
+struct FrontendPlan {
+  std::vector<std::string> tokens;
+
+  // The indices of the tokens that are replaced by each slot value.
+  std::vector<size_t> slot_tokens;
+
+  // The range of `tokens` that is replaced by the `-Xcc` arguments.
+  size_t xcc_begin = 0;
+  size_t xcc_end = 0;
+
+  // Whether the plan's output has been checked against the driver's since it
+  // was created.
+  bool validated = false;
+};
+
+// Derives a plan from the frontend command the driver produced for an
+// invocation with the given shape. Returns nothing if the module-specific
+// values can't be located unambiguously, or if they appear to be used for
+// anything other than being copied to the frontend command.
+std::optional<FrontendPlan> DerivePlan(const std::vector<std::string>& frontend,
+                                       const DriverArgShape& shape) {
+  FrontendPlan plan;
+  plan.tokens = frontend;
+
+  if (!shape.xcc_args.empty()) {
+    bool found = false;
+    for (size_t i = 0; i + shape.xcc_args.size() <= frontend.size(); ++i) {
+      if (std::equal(shape.xcc_args.begin(), shape.xcc_args.end(),
+                     frontend.begin() + i)) {
+        if (found) return std::nullopt;
+        found = true;
+        plan.xcc_begin = i;
+        plan.xcc_end = i + shape.xcc_args.size();
+      }
     }
-    token.push_back(c);
+    if (!found) return std::nullopt;
   }
-  if (!token.empty()) {
-    tokens.push_back(std::move(token));
+  auto in_xcc = [&](size_t i) {
+    return i >= plan.xcc_begin && i < plan.xcc_end;
+  };
+
+  for (const std::string& value : shape.slot_values) {
+    std::optional<size_t> index;
+    for (size_t i = 0; i < frontend.size(); ++i) {
+      if (!in_xcc(i) && frontend[i] == value) {
+        if (index.has_value()) return std::nullopt;
+        index = i;
+      }
+    }
+    if (!index.has_value()) return std::nullopt;
+    plan.slot_tokens.push_back(*index);
   }
-  return tokens;
+
+  // A module-specific value that also shows up inside some other token was
+  // used to derive it, so that token can't be reused for another module.
+  for (size_t i = 0; i < frontend.size(); ++i) {
+    if (in_xcc(i) || std::find(plan.slot_tokens.begin(),
+                               plan.slot_tokens.end(),
+                               i) != plan.slot_tokens.end()) {
+      continue;
+    }
+    for (const std::string& value : shape.slot_values) {
+      if (frontend[i].find(value) != std::string::npos) return std::nullopt;
+    }
+  }
+  return plan;
 }
 
-std::vector<std::string> ParseFrontendCommand(const std::string& output) {
-  std::string line;
-  std::string last_line;
-  std::istringstream iss(output);
-  while (std::getline(iss, line)) {
-    if (!line.empty() && line.back() == '\r') {
-      line.pop_back();
+// Returns the frontend command that `plan` describes for an invocation with
+// the given shape.
+std::vector<std::string> InstantiatePlan(const FrontendPlan& plan,
+                                         const DriverArgShape& shape) {
+  std::vector<std::string> frontend;
+  frontend.reserve(plan.tokens.size() - (plan.xcc_end - plan.xcc_begin) +
+                   shape.xcc_args.size());
+  for (size_t i = 0; i < plan.tokens.size(); ++i) {
+    if (i == plan.xcc_begin && plan.xcc_end > plan.xcc_begin) {
+      frontend.insert(frontend.end(), shape.xcc_args.begin(),
+                      shape.xcc_args.end());
+      i = plan.xcc_end - 1;
+      continue;
     }
-    if (!line.empty()) {
-      last_line = line;
+    frontend.push_back(plan.tokens[i]);
+  }
+  // Slot tokens are never inside the `-Xcc` range, so their indices shift by
+  // the difference in its length if they come after it.
+  for (size_t slot = 0; slot < kSlotCount; ++slot) {
+    size_t index = plan.slot_tokens[slot];
+    if (plan.xcc_end > plan.xcc_begin && index >= plan.xcc_end) {
+      index = index - (plan.xcc_end - plan.xcc_begin) + shape.xcc_args.size();
     }
+    frontend[index] = shape.slot_values[slot];
   }
-  if (last_line.empty()) {
-    return {};
+  return frontend;
+}
+
+// Frontend plans derived by this worker, keyed by `DriverArgShape::key`. A
+// key maps to nothing if its plan turned out not to be reusable.
+class FrontendPlanCache {
+ public:
+  static FrontendPlanCache& Shared() {
+    static FrontendPlanCache* cache = new FrontendPlanCache();
+    return *cache;
+  }
+
+  // Returns the plan for `key`, if there is one.
+  std::optional<FrontendPlan> Get(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = plans_.find(key);
+    if (it == plans_.end() || !it->second.has_value()) return std::nullopt;
+    return it->second;
+  }
+
+  // Returns true if a plan for `key` was found not to be reusable.
+  bool IsUncacheable(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = plans_.find(key);
+    return it != plans_.end() && !it->second.has_value();
+  }
+
+  // Stores the plan for `key`, or records that there isn't one.
+  void Put(const std::string& key, std::optional<FrontendPlan> plan) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A worker only sees a handful of SDK configurations, so this limit is
+    // only reached if something in the key varies unexpectedly; starting over
+    // is enough to keep the cache from growing without bound.
+    if (plans_.size() >= kMaxPlans && plans_.find(key) == plans_.end()) {
+      plans_.clear();
+    }
+    plans_[key] = std::move(plan);
+  }
+
+ private:
+  static constexpr size_t kMaxPlans = 64;
+
+  std::mutex mutex_;
+  std::map<std::string, std::optional<FrontendPlan>> plans_;
+};
+
+// Runs the driver to get the frontend command for `spawn_args`, which is the
+// last job it plans. Returns nothing after describing the failure in
+// `stderr_stream`, with the exit code in `rc`.
+std::optional<std::vector<std::string>> FrontendCommandFromDriver(
+    const std::vector<std::string>& spawn_args,
+    std::map<std::string, std::string>* env, std::ostream* stderr_stream,
+    int& rc) {
+  std::optional<std::vector<std::vector<std::string>>> jobs =
+      CaptureDriverJobs(spawn_args, env, stderr_stream, "hermetic-pcm", rc);
+  if (!jobs.has_value()) {
+    return std::nullopt;
+  }
+  return std::move(jobs->back());
+}
+
+// Returns the frontend command for the invocation, from a cached plan if one
+// applies, or otherwise from the driver (caching a plan derived from its
+// output for later invocations).
+//
+// The first time a plan is reused, the driver is run anyway and the two are
+// compared, so that a plan that doesn't actually generalize is discarded
+// before it is trusted.
+std::optional<std::vector<std::string>> FrontendCommand(
+    const std::vector<std::string>& spawn_args,
+    const std::vector<std::string>& tool_args,
+    const std::vector<std::string>& args, const std::string& developer_dir,
+    std::map<std::string, std::string>* env, std::ostream* stderr_stream,
+    int& rc, bool debug) {
+  std::optional<DriverArgShape> shape =
+      ShapeOfDriverArgs(tool_args, args, developer_dir);
+  FrontendPlanCache& cache = FrontendPlanCache::Shared();
+  std::optional<FrontendPlan> plan;
+  if (shape.has_value()) {
+    plan = cache.Get(shape->key);
+  }
+  if (plan.has_value() && plan->validated) {
+    if (debug) {
+      (*stderr_stream) << "hermetic-pcm: using cached frontend plan\n";
+    }
+    rc = 0;
+    return InstantiatePlan(*plan, *shape);
   }
-  return TokenizeShellLine(last_line);
+
+  std::optional<std::vector<std::string>> frontend =
+      FrontendCommandFromDriver(spawn_args, env, stderr_stream, rc);
+  if (!frontend.has_value() || !shape.has_value() ||
+      cache.IsUncacheable(shape->key)) {
+    return frontend;
+  }
+
+  if (plan.has_value()) {
+    bool matches = InstantiatePlan(*plan, *shape) == *frontend;
+    if (debug) {
+      (*stderr_stream) << "hermetic-pcm: cached frontend plan "
+                       << (matches ? "validated" : "discarded") << "\n";
+    }
+    if (matches) {
+      plan->validated = true;
+      cache.Put(shape->key, std::move(plan));
+    } else {
+      cache.Put(shape->key, std::nullopt);
+    }
+    return frontend;
+  }
+
+  // The plan is derived from this invocation, and is checked against the next
+  // one that uses it. Only a plan that fails that check marks the key as
+  // uncacheable: a plan can't be derived when a module-specific value happens
+  // to appear in another token (for example, module `os` in `-target
+  // arm64-apple-macos14`), which says nothing about other modules with the
+  // same key.
+  std::optional<FrontendPlan> derived = DerivePlan(*frontend, *shape);
+  if (derived.has_value()) {
+    cache.Put(shape->key, std::move(derived));
+  } else if (debug) {
+    (*stderr_stream) << "hermetic-pcm: could not derive a frontend plan\n";
+  }
+  return frontend;
 }
 
 std::string ResourceDirFromFrontend(const std::string& frontend_binary) {
@@ -128,7 +354,9 @@ std::string ResourceDirFromFrontend(const std::string& frontend_binary) {
 
 }  // namespace
 
-int RunHermeticPcm(const std::vector<std::string>& args,
+int RunHermeticPcm(const std::vector<std::string>& spawn_args,
+                   const std::vector<std::string>& tool_args,
+                   const std::vector<std::string>& args,
                    std::map<std::string, std::string>* env,
                    std::ostream* stderr_stream) {
   std::string developer_dir = GetEnv("DEVELOPER_DIR");
@@ -138,19 +366,15 @@ int RunHermeticPcm(const std::vector<std::string>& args,
   }
   developer_dir = bazel_rules_swift::NormalizeDeveloperDir(developer_dir);
 
-  std::string captured;
-  int rc = CaptureFrontendCommand(args, env, stderr_stream, &captured);
-  if (rc != 0) {
+  bool debug = !GetEnv(kDebugEnv).empty();
+  int rc = 0;
+  std::optional<std::vector<std::string>> frontend_command =
+      FrontendCommand(spawn_args, tool_args, args, developer_dir, env,
+                      stderr_stream, rc, debug);
+  if (!frontend_command.has_value()) {
     return rc;
   }
-
-  std::vector<std::string> frontend = ParseFrontendCommand(captured);
-  if (frontend.empty()) {
-    (*stderr_stream)
-        << "error: hermetic-pcm: could not parse frontend command from:\n"
-        << captured;
-    return 1;
-  }
+  const std::vector<std::string>& frontend = *frontend_command;
 
   std::string resource_dir = ResourceDirFromFrontend(frontend[0]);
   if (resource_dir.empty()) {
@@ -186,7 +410,7 @@ int RunHermeticPcm(const std::vector<std::string>& args,
   rewritten.push_back("-resource-dir");
   rewritten.push_back(resource_dir);
 
-  if (!GetEnv(kDebugEnv).empty()) {
+  if (debug) {
     (*stderr_stream) << "hermetic-pcm: developer_dir='" << developer_dir
                      << "'\n";
     (*stderr_stream) << "hermetic-pcm: running";
@@ -24,8 +24,9 @@
 // free of non-hermetic paths (absolute SDK location, developer dir, etc.).
 //
 // This is intentionally self-contained: everything the hermeticization
-// flow needs lives in this one `.h`/`.cc` pair, so that when upstream Swift
-// fixes PCM path handling we can drop the whole thing.
+// flow needs, other than capturing the driver's plan (which it shares with the
+// driver bypass in `frontend_plan.h`), lives in this one `.h`/`.cc` pair, so
+// that when upstream Swift fixes PCM path handling we can drop the whole thing.
 //
 // High-level flow:
 //   1. Invoke `swiftc -### <args>` so the driver prints the frontend command
@@ -33,7 +34,21 @@
 //   2. Parse the frontend command, strip flags we do not need, and rewrite
 //      any absolute SDK path to a workspace-relative symlink we manage.
 //   3. Run the rewritten frontend command.
-int RunHermeticPcm(const std::vector<std::string>& args,
+//
+// Step 1 launches the driver for every PCM, even though PCMs built for the
+// same SDK configuration differ only in their module name, output, input
+// module map, and `-Xcc` flags. So the frontend command is turned into a plan
+// with those values left open, keyed by the rest of the invocation, and later
+// invocations with the same key fill in the plan instead of running the
+// driver. A plan is checked against the driver's output the first time it is
+// reused, and is never used if it doesn't match.
+//
+// `spawn_args` is the command line that runs the driver; `tool_args` and
+// `args` are the driver itself and the arguments that `spawn_args` passes to
+// it (for example, through response files).
+int RunHermeticPcm(const std::vector<std::string>& spawn_args,
+                   const std::vector<std::string>& tool_args,
+                   const std::vector<std::string>& args,
                    std::map<std::string, std::string>* env,
                    std::ostream* stderr_stream);
 
@@ -0,0 +1,631 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/worker/plugin_pool.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_replace.h"
+#include "tools/common/file_digest.h"
+#include "tools/worker/file_snapshot.h"
+
+#if !defined(_WIN32)
+extern "C" {
+extern char** environ;
+}
+#endif
+
+using bazel_rules_swift::XXH64Digest;
+
+namespace {
+
+// The pool, once it has been started.
+std::atomic<PluginPool*> shared_pool = nullptr;
+
+#if !defined(_WIN32)
+
+// The number of connections a plugin process serves before it is replaced,
+// which bounds the memory that a plugin can accumulate over its lifetime.
+constexpr int kMaxConnectionsPerProcess = 64;
+
+// The replies the pool sends a proxy once it has (or couldn't get) a process.
+constexpr char kConnectionAccepted = '+';
+constexpr char kConnectionRejected = '-';
+
+// The size of the buffer used to relay data.
+constexpr size_t kBufferSize = 64 * 1024;
+
+// Returns the most idle processes kept for one plugin binary. More are only
+// needed when that many frontends expand its macros at the same time.
+size_t MaxIdleProcesses() {
+  return std::max(2u, std::thread::hardware_concurrency());
+}
+
+// Counts the messages of the plugin protocol (a little-endian 64-bit size
+// followed by that many bytes of JSON) sent in one direction of a connection.
+class MessageCounter {
+ public:
+  // Accounts for `size` more bytes of the stream.
+  void Consume(const char* data, size_t size) {
+    while (size > 0) {
+      if (header_size_ < sizeof(header_)) {
+        header_[header_size_++] = static_cast<uint8_t>(*data++);
+        --size;
+        if (header_size_ == sizeof(header_)) {
+          remaining_ = 0;
+          for (int i = sizeof(header_) - 1; i >= 0; --i) {
+            remaining_ = (remaining_ << 8) | header_[i];
+          }
+          if (remaining_ == 0) {
+            FinishMessage();
+          }
+        }
+        continue;
+      }
+      size_t body_size = std::min<uint64_t>(size, remaining_);
+      data += body_size;
+      size -= body_size;
+      remaining_ -= body_size;
+      if (remaining_ == 0) {
+        FinishMessage();
+      }
+    }
+  }
+
+  // Returns true if the stream ends between messages.
+  bool AtBoundary() const { return header_size_ == 0; }
+
+  // Returns the number of complete messages.
+  uint64_t messages() const { return messages_; }
+
+ private:
+  void FinishMessage() {
+    ++messages_;
+    header_size_ = 0;
+  }
+
+  uint8_t header_[8];
+  size_t header_size_ = 0;
+  uint64_t remaining_ = 0;
+  uint64_t messages_ = 0;
+};
+
+// Writes all of `data` to `fd`. Returns false if it couldn't be written.
+bool WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+// Reads from `fd` into `buffer`, retrying if interrupted.
+ssize_t ReadSome(int fd, char* buffer, size_t size) {
+  ssize_t result;
+  do {
+    result = read(fd, buffer, size);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+// Creates a pipe whose ends are closed in children that don't dup them.
+bool MakePipe(int fds[2]) {
+  if (pipe(fds) != 0) {
+    return false;
+  }
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  return true;
+}
+
+// Creates the directory at `path`, if it doesn't exist, so that only this user
+// can use it. Returns false if it couldn't be created, or if it exists but
+// someone else could write to it, since the scripts in it are run by compiles.
+bool MakePrivateDirectory(const std::filesystem::path& path) {
+  if (mkdir(path.c_str(), 0700) != 0 && errno != EEXIST) {
+    return false;
+  }
+  struct stat info;
+  return lstat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode) &&
+         info.st_uid == geteuid() && (info.st_mode & 0077) == 0;
+}
+
+// Removes the sockets in `directory` of workers that exited without removing
+// them (for example, because they were killed).
+void RemoveStaleSockets(const std::filesystem::path& directory) {
+  std::error_code ec;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(directory, ec)) {
+    const std::filesystem::path& path = entry.path();
+    if (path.extension() != ".socket") {
+      continue;
+    }
+    std::string pid_string = path.stem().string();
+    char* end;
+    long pid = std::strtol(pid_string.c_str(), &end, 10);
+    if (*end == '\0' && pid > 0 && kill(pid, 0) != 0 && errno == ESRCH) {
+      std::filesystem::remove(path, ec);
+    }
+  }
+}
+
+// Returns `value` quoted for a POSIX shell.
+std::string ShellQuote(const std::string& value) {
+  return absl::StrCat("'", absl::StrReplaceAll(value, {{"'", "'\\''"}}), "'");
+}
+
+// Execs the plugin at `plugin_path` in place of the proxy, with the proxy's
+// standard input and output.
+int RunPluginDirectly(const std::string& plugin_path) {
+  char* argv[] = {const_cast<char*>(plugin_path.c_str()), nullptr};
+  execv(plugin_path.c_str(), argv);
+  std::cerr << "swift_worker: Could not run plugin " << plugin_path << " ("
+            << std::strerror(errno) << ")\n";
+  return 127;
+}
+
+#endif
+
+}  // namespace
+
+#if !defined(_WIN32)
+
+void PluginPool::Start(const std::string& worker_path) {
+  const char* enabled = std::getenv("RULES_SWIFT_PLUGIN_POOL");
+  if (enabled == nullptr || std::strcmp(enabled, "1") != 0 ||
+      shared_pool != nullptr) {
+    return;
+  }
+
+  // Socket paths are limited to about a hundred bytes, which a deeply nested
+  // temporary directory can exceed.
+  sockaddr_un address = {};
+  std::error_code ec;
+  std::filesystem::path temp_directory =
+      std::filesystem::temp_directory_path(ec);
+  if (ec || temp_directory.string().size() + 40 > sizeof(address.sun_path)) {
+    temp_directory = "/tmp";
+  }
+  std::filesystem::path directory =
+      temp_directory / absl::StrCat("swift_plugin_pool.", geteuid());
+  if (!MakePrivateDirectory(directory)) {
+    std::cerr << "swift_worker: Could not create the plugin pool directory "
+              << directory << "\n";
+    return;
+  }
+  RemoveStaleSockets(directory);
+
+  std::unique_ptr<PluginPool> pool(new PluginPool(worker_path, directory));
+  std::string socket_path = pool->socket_path_.string();
+  // A socket left by an earlier process with the same pid.
+  std::filesystem::remove(socket_path, ec);
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, socket_path.c_str(),
+               sizeof(address.sun_path) - 1);
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0 ||
+      bind(listen_fd, reinterpret_cast<sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(listen_fd, SOMAXCONN) != 0) {
+    std::cerr << "swift_worker: Could not listen on " << socket_path << " ("
+              << std::strerror(errno) << ")\n";
+    if (listen_fd >= 0) close(listen_fd);
+    return;
+  }
+  fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+
+  // A plugin or proxy that exits while data is being relayed to it must fail
+  // the write rather than terminate the worker.
+  signal(SIGPIPE, SIG_IGN);
+
+  PluginPool* started_pool = pool.release();
+  std::thread([started_pool, listen_fd]() {
+    started_pool->AcceptConnections(listen_fd);
+  }).detach();
+  shared_pool = started_pool;
+  std::atexit(RemoveSocket);
+}
+
+PluginPool* PluginPool::Shared() { return shared_pool; }
+
+PluginPool::PluginPool(std::string worker_path, std::filesystem::path directory)
+    : worker_path_(std::move(worker_path)),
+      directory_(std::move(directory)),
+      socket_path_(directory_ / absl::StrCat(getpid(), ".socket")) {}
+
+void PluginPool::RemoveSocket() {
+  if (PluginPool* pool = shared_pool) {
+    unlink(pool->socket_path_.c_str());
+  }
+}
+
+void PluginPool::RewriteArguments(std::vector<std::string>& args,
+                                  std::map<std::string, std::string>& env) {
+  bool rewritten = false;
+  for (size_t i = 0; i + 1 < args.size(); ++i) {
+    if (args[i] != "-load-plugin-executable") {
+      continue;
+    }
+    size_t value_index = i + 1;
+    if (args[value_index] == "-Xfrontend" && value_index + 1 < args.size()) {
+      ++value_index;
+    }
+    std::string& value = args[value_index];
+    size_t separator = value.find('#');
+    if (separator == std::string::npos) {
+      continue;
+    }
+    std::string script = ScriptFor(
+        std::filesystem::absolute(value.substr(0, separator)).string());
+    if (!script.empty()) {
+      value = absl::StrCat(script, value.substr(separator));
+      rewritten = true;
+    }
+    i = value_index;
+  }
+  if (rewritten) {
+    env[kPluginPoolSocketVariable] = socket_path_.string();
+  }
+}
+
+std::string PluginPool::ScriptFor(const std::string& plugin_path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = scripts_.find(plugin_path);
+  if (it != scripts_.end()) {
+    return it->second;
+  }
+
+  // The script depends only on the worker and the plugin, so workers share
+  // it, and it is replaced atomically in case another one is writing it.
+  std::filesystem::path script_path =
+      directory_ /
+      absl::StrCat(std::filesystem::path(plugin_path).filename().string(), ".",
+                   absl::Hex(XXH64Digest(absl::StrCat(worker_path_, "\0",
+                                                      plugin_path)),
+                             absl::kZeroPad16));
+  std::error_code ec;
+  if (!std::filesystem::exists(script_path, ec)) {
+    std::filesystem::path temporary_path =
+        absl::StrCat(script_path.string(), ".", getpid(), ".tmp");
+    {
+      std::ofstream script(temporary_path, std::ios::trunc);
+      script << "#!/bin/sh\nexec " << ShellQuote(worker_path_) << " "
+             << kPluginProxyFlag << " \"$" << kPluginPoolSocketVariable
+             << "\" " << ShellQuote(plugin_path) << "\n";
+      if (!script.good()) {
+        std::filesystem::remove(temporary_path, ec);
+        return "";
+      }
+    }
+    std::filesystem::permissions(temporary_path,
+                                 std::filesystem::perms::owner_all, ec);
+    if (!ec) {
+      std::filesystem::rename(temporary_path, script_path, ec);
+    }
+    if (ec) {
+      std::filesystem::remove(temporary_path, ec);
+      return "";
+    }
+  }
+  return scripts_[plugin_path] = script_path.string();
+}
+
+void PluginPool::AcceptConnections(int listen_fd) {
+  while (true) {
+    int connection_fd = accept(listen_fd, nullptr, nullptr);
+    if (connection_fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      std::cerr << "swift_worker: Plugin pool stopped accepting connections ("
+                << std::strerror(errno) << ")\n";
+      return;
+    }
+    fcntl(connection_fd, F_SETFD, FD_CLOEXEC);
+    std::thread([this, connection_fd]() {
+      ServeConnection(connection_fd);
+    }).detach();
+  }
+}
+
+void PluginPool::ServeConnection(int connection_fd) {
+  // The proxy begins with the path of the plugin it stands in for.
+  std::string plugin_path;
+  char ch = 0;
+  while (ReadSome(connection_fd, &ch, 1) == 1 && ch != '\n') {
+    plugin_path.push_back(ch);
+  }
+  std::optional<FileSnapshot> binary = FileSnapshotCache::Stat(plugin_path);
+  Process process;
+  if (ch == '\n' && binary.has_value()) {
+    process = Acquire(plugin_path, *binary);
+  }
+  if (process.pid < 0) {
+    WriteAll(connection_fd, &kConnectionRejected, 1);
+    close(connection_fd);
+    return;
+  }
+  if (!WriteAll(connection_fd, &kConnectionAccepted, 1)) {
+    close(connection_fd);
+    Release(plugin_path, *binary, process, /*reusable=*/true);
+    return;
+  }
+
+  // The protocol is strictly request and response, so a blocking write to one
+  // side can't wait on the other side's writes.
+  MessageCounter requests;
+  MessageCounter responses;
+  bool connection_ended = false;
+  bool failed = false;
+  std::vector<char> buffer(kBufferSize);
+  while (!connection_ended && !failed) {
+    pollfd fds[2] = {{connection_fd, POLLIN, 0},
+                     {process.stdout_fd, POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0) {
+      failed = errno != EINTR;
+      continue;
+    }
+    if (fds[0].revents != 0) {
+      ssize_t size = ReadSome(connection_fd, buffer.data(), buffer.size());
+      if (size <= 0) {
+        connection_ended = true;
+        continue;
+      }
+      requests.Consume(buffer.data(), size);
+      failed = !WriteAll(process.stdin_fd, buffer.data(), size);
+    }
+    if (!failed && fds[1].revents != 0) {
+      ssize_t size = ReadSome(process.stdout_fd, buffer.data(), buffer.size());
+      if (size <= 0) {
+        failed = true;
+        continue;
+      }
+      responses.Consume(buffer.data(), size);
+      failed = !WriteAll(connection_fd, buffer.data(), size);
+    }
+  }
+  close(connection_fd);
+
+  bool reusable = connection_ended && !failed && requests.AtBoundary() &&
+                  responses.AtBoundary() &&
+                  requests.messages() == responses.messages();
+  Release(plugin_path, *binary, process, reusable);
+}
+
+namespace {
+
+// Starts the plugin at `plugin_path` with pipes for its standard input and
+// output. Returns a process with a negative pid if it couldn't be started.
+PluginPool::Process StartPluginProcess(const std::string& plugin_path) {
+  PluginPool::Process process;
+  int to_plugin[2];
+  int from_plugin[2];
+  if (!MakePipe(to_plugin)) {
+    return process;
+  }
+  if (!MakePipe(from_plugin)) {
+    close(to_plugin[0]);
+    close(to_plugin[1]);
+    return process;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, to_plugin[0], STDIN_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, from_plugin[1], STDOUT_FILENO);
+  char* argv[] = {const_cast<char*>(plugin_path.c_str()), nullptr};
+  pid_t pid;
+  int status =
+      posix_spawn(&pid, plugin_path.c_str(), &actions, nullptr, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(to_plugin[0]);
+  close(from_plugin[1]);
+  if (status != 0) {
+    close(to_plugin[1]);
+    close(from_plugin[0]);
+    std::cerr << "swift_worker: Could not start plugin " << plugin_path << " ("
+              << std::strerror(status) << ")\n";
+    return process;
+  }
+  process.pid = pid;
+  process.stdin_fd = to_plugin[1];
+  process.stdout_fd = from_plugin[0];
+  return process;
+}
+
+// Returns true if an idle plugin process is still running and hasn't written
+// anything since its last response.
+bool IsHealthy(const PluginPool::Process& process) {
+  int status;
+  if (waitpid(process.pid, &status, WNOHANG) != 0) {
+    return false;
+  }
+  pollfd fd = {process.stdout_fd, POLLIN, 0};
+  return poll(&fd, 1, 0) == 0;
+}
+
+// Stops a plugin process and releases its resources.
+void StopPluginProcess(const PluginPool::Process& process) {
+  close(process.stdin_fd);
+  close(process.stdout_fd);
+  kill(process.pid, SIGKILL);
+  int status;
+  while (waitpid(process.pid, &status, 0) < 0 && errno == EINTR) {
+  }
+}
+
+}  // namespace
+
+PluginPool::Process PluginPool::Acquire(const std::string& plugin_path,
+                                        const FileSnapshot& binary) {
+  std::vector<Process> stopped;
+  std::optional<Process> acquired;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = idle_.find(plugin_path);
+    if (it != idle_.end()) {
+      std::vector<Process>& processes = it->second.processes;
+      if (!it->second.binary.SameFileAs(binary)) {
+        // The plugin has been rebuilt since these processes started.
+        stopped = std::move(processes);
+        idle_.erase(it);
+      } else {
+        while (!processes.empty() && !acquired.has_value()) {
+          Process process = processes.back();
+          processes.pop_back();
+          if (IsHealthy(process)) {
+            acquired = process;
+          } else {
+            stopped.push_back(process);
+          }
+        }
+      }
+    }
+  }
+  for (const Process& process : stopped) {
+    StopPluginProcess(process);
+  }
+
+  Process process =
+      acquired.has_value() ? *acquired : StartPluginProcess(plugin_path);
+  ++process.connections;
+  return process;
+}
+
+void PluginPool::Release(const std::string& plugin_path,
+                         const FileSnapshot& binary, Process process,
+                         bool reusable) {
+  if (reusable && process.connections < kMaxConnectionsPerProcess) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    IdleProcesses& idle = idle_[plugin_path];
+    if (idle.processes.empty()) {
+      idle.binary = binary;
+    }
+    if (idle.binary.SameFileAs(binary) &&
+        idle.processes.size() < MaxIdleProcesses()) {
+      idle.processes.push_back(process);
+      return;
+    }
+  }
+  StopPluginProcess(process);
+}
+
+int RunPluginProxy(const std::string& socket_path,
+                   const std::string& plugin_path) {
+  signal(SIGPIPE, SIG_IGN);
+
+  sockaddr_un address = {};
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    return RunPluginDirectly(plugin_path);
+  }
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, socket_path.c_str(),
+               sizeof(address.sun_path) - 1);
+  int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (socket_fd < 0) {
+    return RunPluginDirectly(plugin_path);
+  }
+  std::string handshake = plugin_path + "\n";
+  char reply = 0;
+  if (connect(socket_fd, reinterpret_cast<sockaddr*>(&address),
+              sizeof(address)) != 0 ||
+      !WriteAll(socket_fd, handshake.data(), handshake.size()) ||
+      ReadSome(socket_fd, &reply, 1) != 1 || reply != kConnectionAccepted) {
+    // The compile wasn't run by a worker with a pool, that worker has exited,
+    // or it couldn't start the plugin, so run it the way the frontend would
+    // have.
+    close(socket_fd);
+    return RunPluginDirectly(plugin_path);
+  }
+
+  bool input_open = true;
+  std::vector<char> buffer(kBufferSize);
+  while (true) {
+    pollfd fds[2] = {{input_open ? STDIN_FILENO : -1, POLLIN, 0},
+                     {socket_fd, POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      return EXIT_FAILURE;
+    }
+    if (fds[0].revents != 0) {
+      ssize_t size = ReadSome(STDIN_FILENO, buffer.data(), buffer.size());
+      if (size <= 0) {
+        // The frontend is done with the plugin.
+        shutdown(socket_fd, SHUT_WR);
+        input_open = false;
+      } else if (!WriteAll(socket_fd, buffer.data(), size)) {
+        return EXIT_FAILURE;
+      }
+    }
+    if (fds[1].revents != 0) {
+      ssize_t size = ReadSome(socket_fd, buffer.data(), buffer.size());
+      if (size <= 0) {
+        // The pool closes the connection early only if the plugin failed.
+        return input_open ? EXIT_FAILURE : EXIT_SUCCESS;
+      }
+      if (!WriteAll(STDOUT_FILENO, buffer.data(), size)) {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+}
+
+#else
+
+void PluginPool::Start(const std::string& worker_path) {}
+
+PluginPool* PluginPool::Shared() { return nullptr; }
+
+void PluginPool::RewriteArguments(std::vector<std::string>& args,
+                                  std::map<std::string, std::string>& env) {}
+
+int RunPluginProxy(const std::string& socket_path,
+                   const std::string& plugin_path) {
+  std::cerr << "swift_worker: Plugin pools are not supported on Windows\n";
+  return EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,136 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_PLUGIN_POOL_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_PLUGIN_POOL_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tools/worker/file_snapshot.h"
+
+// The flag that runs the worker binary as the proxy between a frontend and a
+// pooled plugin, followed by the pool's socket and the plugin's path.
+constexpr const char* kPluginProxyFlag = "--plugin-proxy";
+
+// The environment variable through which a compile's plugin scripts find the
+// socket of the pool of the worker that runs it.
+constexpr const char* kPluginPoolSocketVariable =
+    "RULES_SWIFT_PLUGIN_POOL_SOCKET";
+
+// Keeps macro plugin processes (those loaded with `-load-plugin-executable`)
+// running between compiles, so that each plugin's startup is paid once per
+// worker rather than once per frontend that expands its macros.
+//
+// The pool is enabled in persistent workers by setting
+// `RULES_SWIFT_PLUGIN_POOL=1`. The plugin paths in a compile's arguments are
+// then replaced by scripts that run the worker binary as a proxy (see
+// `RunPluginProxy`), which connects to the pool through a Unix domain socket
+// named by `kPluginPoolSocketVariable` in the compile's environment.
+//
+// The arguments end up in the driver's build record and in the debugging
+// options serialized into the module, so the scripts have the same paths in
+// every worker: they live in a directory per user and are named after the
+// plugin and a hash of its path and the worker's. Each worker's socket is in
+// the same directory, named after its process, and is removed when the worker
+// exits (or, if it couldn't be, by the next worker that starts).
+// The pool hands each connection a warm process for the same plugin binary
+// (by path, size, modification time, and identity) or starts one, and relays
+// the plugin protocol's length-prefixed messages between them.
+//
+// A process serves one connection at a time, so expansions for different
+// compiles never share one. It only returns to the pool if the connection
+// ended between messages with every request answered, it is still running,
+// and it hasn't written anything unprompted; it is retired after
+// `kMaxConnectionsPerProcess` connections, when its binary changes, or when
+// too many copies of it are idle. Pooled plugins write their own diagnostics
+// to the worker's log rather than to the compile's output.
+class PluginPool {
+ public:
+  // A running plugin process.
+  struct Process {
+    int pid = -1;
+    int stdin_fd = -1;
+    int stdout_fd = -1;
+
+    // The number of connections the process has served.
+    int connections = 0;
+  };
+
+  // Starts the pool if it is enabled. `worker_path` is the absolute path of the
+  // worker binary, which the plugin scripts run as the proxy.
+  static void Start(const std::string& worker_path);
+
+  // Returns the pool if it has been started, or nullptr.
+  static PluginPool* Shared();
+
+  // Replaces the plugin executables in the values of `-load-plugin-executable`
+  // flags in `args` with scripts that connect to the pool, and points the
+  // scripts at the pool in `env`, the compile's environment.
+  void RewriteArguments(std::vector<std::string>& args,
+                        std::map<std::string, std::string>& env);
+
+ private:
+  // The idle processes of one plugin binary.
+  struct IdleProcesses {
+    FileSnapshot binary;
+    std::vector<Process> processes;
+  };
+
+  PluginPool(std::string worker_path, std::filesystem::path directory);
+
+  // Removes the socket of this worker's pool when the worker exits.
+  static void RemoveSocket();
+
+  // Returns the path of the script that runs `plugin_path` through the pool,
+  // creating it if necessary, or an empty string if it couldn't be created.
+  std::string ScriptFor(const std::string& plugin_path);
+
+  // Accepts connections from proxies until the worker exits.
+  void AcceptConnections(int listen_fd);
+
+  // Serves one connection from a proxy.
+  void ServeConnection(int connection_fd);
+
+  // Returns a healthy idle process for the plugin at `plugin_path`, whose
+  // binary is `binary`, or starts a new one. Returns a process with a negative
+  // pid if the plugin couldn't be started.
+  Process Acquire(const std::string& plugin_path, const FileSnapshot& binary);
+
+  // Returns `process` to the pool, or stops it if it shouldn't be reused.
+  void Release(const std::string& plugin_path, const FileSnapshot& binary,
+               Process process, bool reusable);
+
+  std::string worker_path_;
+  std::filesystem::path directory_;
+  std::filesystem::path socket_path_;
+
+  std::mutex mutex_;
+  absl::flat_hash_map<std::string, std::string> scripts_;
+  absl::flat_hash_map<std::string, IdleProcesses> idle_;
+};
+
+// Relays the standard input and output of a plugin invocation to the pooled
+// plugin at `plugin_path` through the pool listening on `socket_path`. If the
+// pool can't be reached, the plugin is run directly instead. Returns the exit
+// code of the proxy.
+int RunPluginProxy(const std::string& socket_path,
+                   const std::string& plugin_path);
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_PLUGIN_POOL_H_
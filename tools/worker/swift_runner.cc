@@ -18,25 +18,40 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
 #include "absl/strings/substitute.h"
 #include "tools/common/bazel_substitutions.h"
 #include "tools/common/color.h"
+#include "tools/common/directory_reaper.h"
 #include "tools/common/file_system.h"
 #include "tools/common/path_utils.h"
 #include "tools/common/process.h"
+#include "tools/common/response_file.h"
 #include "tools/common/target_triple.h"
 #include "tools/common/temp_file.h"
+#include "tools/worker/autolink_extractor.h"
+#include "tools/worker/file_snapshot.h"
+#include "tools/worker/frontend_plan.h"
 #include "tools/worker/hermetic_symlink.h"
+#include "tools/worker/index_store_importer.h"
+#include "tools/worker/module_cache_store.h"
+#include "tools/worker/module_wrapper.h"
 #include "tools/worker/output_file_map.h"
 #include "tools/worker/pcm_hermetic_runner.h"
+#include "tools/worker/plugin_pool.h"
+#include "tools/worker/unused_inputs.h"
 
 bool ArgumentEnablesWMO(const std::string& arg) {
   return arg == "-wmo" || arg == "-whole-module-optimization" ||
@@ -47,69 +62,52 @@ namespace {
 
 using namespace bazel_rules_swift;
 
+// Returns true if index data should be imported from the global index store by
+// the worker itself instead of by spawning `index-import`. This is opt-in via
+// `RULES_SWIFT_IN_PROCESS_INDEX_IMPORT=1`.
+static bool InProcessIndexImportEnabled() {
+  const char* value = std::getenv("RULES_SWIFT_IN_PROCESS_INDEX_IMPORT");
+  return value != nullptr && std::string(value) == "1";
+}
+
 // Creates a temporary file and writes the given arguments to it, one per line.
 static std::unique_ptr<TempFile> WriteResponseFile(
     const std::vector<std::string>& args) {
-  auto response_file = TempFile::Create("swiftc_params.XXXXXX");
-  std::ofstream response_file_stream(response_file->GetPath());
+  size_t size = 0;
+  for (const auto& arg : args) {
+    size += arg.size() + 3;
+  }
+  std::string contents;
+  contents.reserve(size + size / 16);
 
   for (const auto& arg : args) {
     // When Clang/Swift write out a response file to communicate from driver to
     // frontend, they just quote every argument to be safe; we duplicate that
-    // instead of trying to be "smarter" and only quoting when necessary.
-    response_file_stream << '"';
-    for (auto ch : arg) {
-      if (ch == '"' || ch == '\\') {
-        response_file_stream << '\\';
-      }
-      response_file_stream << ch;
+    // instead of trying to be "smarter" and only quoting when necessary. The
+    // runs of characters between escapes are appended in one piece, and the
+    // whole file is written with a single call.
+    contents.push_back('"');
+    size_t start = 0;
+    size_t escape;
+    while ((escape = arg.find_first_of("\"\\", start)) != std::string::npos) {
+      contents.append(arg, start, escape - start);
+      contents.push_back('\\');
+      contents.push_back(arg[escape]);
+      start = escape + 1;
     }
-    response_file_stream << "\"\n";
+    contents.append(arg, start, std::string::npos);
+    contents.append("\"\n");
   }
 
+  auto response_file =
+      TempFile::CreatePreferringMemory("swiftc_params.XXXXXX");
+  std::ofstream response_file_stream(response_file->GetPath(),
+                                     std::ios::binary);
+  response_file_stream.write(contents.data(), contents.size());
   response_file_stream.close();
   return response_file;
 }
 
-// Unescape and unquote an argument read from a line of a response file.
-static std::string Unescape(const std::string& arg) {
-  std::string result;
-  auto length = arg.size();
-  for (size_t i = 0; i < length; ++i) {
-    auto ch = arg[i];
-
-    // If it's a backslash, consume it and append the character that follows.
-    if (ch == '\\' && i + 1 < length) {
-      ++i;
-      result.push_back(arg[i]);
-      continue;
-    }
-
-    // If it's a quote, process everything up to the matching quote, unescaping
-    // backslashed characters as needed.
-    if (ch == '"' || ch == '\'') {
-      auto quote = ch;
-      ++i;
-      while (i != length && arg[i] != quote) {
-        if (arg[i] == '\\' && i + 1 < length) {
-          ++i;
-        }
-        result.push_back(arg[i]);
-        ++i;
-      }
-      if (i == length) {
-        break;
-      }
-      continue;
-    }
-
-    // It's a regular character.
-    result.push_back(ch);
-  }
-
-  return result;
-}
-
 // Consumes and returns a single argument from the given command line (skipping
 // any leading whitespace and also handling quoted/escaped arguments), advancing
 // the view to the end of the argument in a similar fashion to
@@ -211,6 +209,117 @@ std::optional<std::string> InferInterfacePath(
   return std::nullopt;
 }
 
+// The prefix of the line in a `.swiftinterface` file's header that holds the
+// flags it was compiled with.
+constexpr absl::string_view kModuleFlagsPrefix = "// swift-module-flags: ";
+
+// Reads the flags that the `.swiftinterface` file at `path` was compiled with.
+//
+// The flags are in the comment block at the top of the file, so only that
+// block is read; SDK interfaces can be several megabytes long.
+std::vector<std::string> ReadInterfaceFlags(const std::string& path) {
+  std::vector<std::string> flags;
+  std::ifstream interface_file{path};
+  std::string line;
+  while (std::getline(interface_file, line)) {
+    absl::string_view line_view = line;
+    if (absl::ConsumePrefix(&line_view, kModuleFlagsPrefix)) {
+      while (std::optional<std::string> flag = ConsumeArg(&line_view)) {
+        flags.push_back(*std::move(flag));
+      }
+      break;
+    }
+    if (!line.empty() && !absl::StartsWith(line, "//")) {
+      // The header is over.
+      break;
+    }
+  }
+  return flags;
+}
+
+// Remembers the interface files that the worker has found in `.swiftmodule`
+// directories and the flags it has read from them, since the same SDK
+// interfaces are compiled again for every configuration that uses them.
+//
+// A resolved path is reused while the modification time of the directory it
+// was found in is unchanged, and flags are reused while the size and
+// modification time of the interface file are unchanged.
+class InterfaceFlagsCache {
+ public:
+  // Returns the cache shared by the whole process.
+  static InterfaceFlagsCache& Shared() {
+    static InterfaceFlagsCache* cache = new InterfaceFlagsCache();
+    return *cache;
+  }
+
+  // Returns the result of `InferInterfacePath` for the given arguments.
+  std::optional<std::string> InferInterfacePath(
+      absl::string_view module_path, absl::string_view target_triple) {
+    std::error_code ec;
+    std::filesystem::file_time_type mtime =
+        std::filesystem::last_write_time(std::string(module_path), ec);
+    std::string key = absl::StrCat(module_path, "\n", target_triple);
+    if (!ec) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = resolved_paths_.find(key);
+      if (it != resolved_paths_.end() && it->second.first == mtime) {
+        return it->second.second;
+      }
+    }
+
+    std::optional<std::string> interface_path =
+        ::InferInterfacePath(module_path, target_triple);
+    if (!ec) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (resolved_paths_.size() >= kMaxEntries) {
+        resolved_paths_.clear();
+      }
+      resolved_paths_[key] = {mtime, interface_path};
+    }
+    return interface_path;
+  }
+
+  // Returns the result of `ReadInterfaceFlags` for the given path.
+  std::vector<std::string> Flags(const std::string& interface_path) {
+    std::optional<FileSnapshot> current =
+        FileSnapshotCache::Stat(interface_path);
+    if (current.has_value()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = flags_.find(interface_path);
+      if (it != flags_.end() && it->second.first.size == current->size &&
+          it->second.first.mtime == current->mtime) {
+        return it->second.second;
+      }
+    }
+
+    std::vector<std::string> flags = ReadInterfaceFlags(interface_path);
+    if (current.has_value()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (flags_.size() >= kMaxEntries) {
+        flags_.clear();
+      }
+      flags_[interface_path] = {*current, flags};
+    }
+    return flags;
+  }
+
+ private:
+  // An SDK has a few hundred interfaces, so this is only reached if the worker
+  // sees several SDKs; starting over then is enough to bound the cache.
+  static constexpr size_t kMaxEntries = 4096;
+
+  InterfaceFlagsCache() = default;
+
+  std::mutex mutex_;
+  absl::flat_hash_map<
+      std::string,
+      std::pair<std::filesystem::file_time_type, std::optional<std::string>>>
+      resolved_paths_;
+  absl::flat_hash_map<std::string,
+                      std::pair<FileSnapshot, std::vector<std::string>>>
+      flags_;
+};
+
 // Extracts flags from the given `.swiftinterface` file and passes them to the
 // given consumer.
 void ExtractFlagsFromInterfaceFile(
@@ -222,7 +331,8 @@ void ExtractFlagsFromInterfaceFile(
     interface_path = std::string(module_or_interface_path);
   } else {
     std::optional<std::string> inferred_path =
-        InferInterfacePath(module_or_interface_path, target_triple);
+        InterfaceFlagsCache::Shared().InferInterfacePath(
+            module_or_interface_path, target_triple);
     if (!inferred_path.has_value()) {
       return;
     }
@@ -240,16 +350,9 @@ void ExtractFlagsFromInterfaceFile(
   // Add the path to the interface file as a source file argument, then extract
   // the flags from it and add them as well.
   consumer(interface_path);
-  std::ifstream interface_file{interface_path};
-  std::string line;
-  while (std::getline(interface_file, line)) {
-    absl::string_view line_view = line;
-    if (absl::ConsumePrefix(&line_view, "// swift-module-flags: ")) {
-      while (std::optional<std::string> flag = ConsumeArg(&line_view)) {
-        consumer(*flag);
-      }
-      return;
-    }
+  for (const std::string& flag :
+       InterfaceFlagsCache::Shared().Flags(interface_path)) {
+    consumer(flag);
   }
 }
 
@@ -281,10 +384,11 @@ std::vector<std::string> ExpandTopLevelResponseFilesForDisplay(
   std::vector<std::string> display_args;
   for (const auto& arg : args) {
     if (arg.size() > 1 && arg[0] == '@') {
-      std::ifstream response_file(arg.substr(1));
-      if (response_file.good()) {
-        for (std::string line; std::getline(response_file, line);) {
-          display_args.push_back(Unescape(line));
+      auto response_file = bazel_rules_swift::ResponseFile::Open(arg.substr(1));
+      if (response_file != nullptr) {
+        for (absl::string_view unescaped :
+             response_file->UnescapedArguments()) {
+          display_args.emplace_back(unescaped);
         }
         continue;
       }
@@ -310,17 +414,12 @@ void PrintVerboseInvocation(const std::vector<std::string>& args,
 // `swiftc -frontend -verify` validates diagnostics without emitting the
 // compilation outputs that Bazel declared. Create those outputs after a
 // successful invocation so this works with every execution strategy.
-bool CreateVerifyOutputs(const std::string& output_file_map_path,
+bool CreateVerifyOutputs(const std::vector<std::string>& output_paths,
                          const std::string& emit_module_path,
                          std::ostream* stderr_stream) {
-  if (!output_file_map_path.empty()) {
-    OutputFileMap output_file_map;
-    output_file_map.ReadFromPath(output_file_map_path, "", "");
-    for (const auto& expected_output_pair :
-         output_file_map.incremental_outputs()) {
-      if (!TouchFile(expected_output_pair.first, stderr_stream)) {
-        return false;
-      }
+  for (const std::string& output_path : output_paths) {
+    if (!TouchFile(output_path, stderr_stream)) {
+      return false;
     }
   }
 
@@ -372,34 +471,16 @@ bool StartsWithXcrun(const std::vector<std::string>& args) {
 }
 #endif
 
-bool SupportsResponseFileInvocation(const std::vector<std::string>& args) {
-  return args.empty() || args.front() != "-modulewrap";
+// Returns the developer directory that the worker was started with, or an
+// empty string if there isn't one.
+std::string DeveloperDirFromEnvironment() {
+  const char* developer_dir = std::getenv("DEVELOPER_DIR");
+  if (developer_dir != nullptr) return std::string(developer_dir);
+  return std::string();
 }
 
-// Spawns an executable, constructing the command line by writing `args` to a
-// response file when the Swift invocation mode supports it and concatenating
-// that after `tool_args` (which are passed outside the response file).
-int SpawnJob(const std::vector<std::string>& tool_args,
-             const std::vector<std::string>& args,
-             std::map<std::string, std::string>* env,
-             std::ostream* stderr_stream, bool stdout_to_stderr) {
-  std::vector<std::string> spawn_args(tool_args);
-  if (SupportsResponseFileInvocation(args)) {
-    auto response_file = WriteResponseFile(args);
-    spawn_args.push_back("@" + response_file->GetPath());
-    return RunSubProcess(spawn_args, env, stderr_stream, stdout_to_stderr);
-  }
-
-  spawn_args.insert(spawn_args.end(), args.begin(), args.end());
-  return RunSubProcess(spawn_args, env, stderr_stream, stdout_to_stderr);
-}
-
-std::vector<std::string> ArgsWithResponseFile(
-    const std::vector<std::string>& tool_args,
-    const std::vector<std::string>& args, const TempFile& response_file) {
-  std::vector<std::string> spawn_args(tool_args);
-  spawn_args.push_back("@" + response_file.GetPath());
-  return spawn_args;
+bool SupportsResponseFileInvocation(const std::vector<std::string>& args) {
+  return args.empty() || args.front() != "-modulewrap";
 }
 
 std::vector<std::string> FullArgsForDisplay(
@@ -410,6 +491,23 @@ std::vector<std::string> FullArgsForDisplay(
   return display_args;
 }
 
+// Returns true if the driver is expected to plan a single frontend job for the
+// given arguments, and nothing that depends on the state of earlier builds.
+// Only these invocations are candidates for the driver bypass; the bypass
+// still confirms the plan with the driver.
+bool PlansSingleFrontendJob(const std::vector<std::string>& args) {
+  bool single_job = false;
+  for (const std::string& arg : args) {
+    if (arg == "-incremental" || arg == "-v") {
+      return false;
+    }
+    single_job |= ArgumentEnablesWMO(arg) || arg == "-dump-ast" ||
+                  arg == "-emit-imported-modules" ||
+                  arg == "-compile-module-from-interface";
+  }
+  return single_job;
+}
+
 // Returns a value indicating whether an argument on the Swift command line
 // should be skipped because it is incompatible with the
 // `-emit-imported-modules` flag used for layering checks. The given iterator is
@@ -468,7 +566,32 @@ SwiftRunner::SwiftRunner(const std::vector<std::string>& args,
   ProcessArguments(args);
 }
 
+SwiftRunner::~SwiftRunner() {
+  // Directories like the ephemeral module cache can hold thousands of files,
+  // so a worker deletes them in the background rather than before it responds.
+  for (auto& directory : temp_directories_) {
+    if (directory != nullptr &&
+        DirectoryReaper::Shared().Reap(directory->GetPath())) {
+      directory->Release();
+    }
+  }
+}
+
 int SwiftRunner::Run(std::ostream* stderr_stream, bool stdout_to_stderr) {
+  // Reading the autolink entries of ELF objects in-process avoids a spawn per
+  // link. Anything the extractor doesn't understand is left to the tool.
+  if (UseNativeAutolinkExtract(tool_args_.back(), args_) &&
+      ExtractAutolinkEntries(args_)) {
+    return EXIT_SUCCESS;
+  }
+
+  // Likewise, wrapping a module for the debugger only needs an ELF object with
+  // the module in its `.swift_ast` section, not a frontend launch.
+  if (UseNativeModuleWrap(args_) && WrapModule(args_)) {
+    return EXIT_SUCCESS;
+  }
+
+  PopulateModuleCache();
   // In rules_swift < 3.x the .swiftsourceinfo files are unconditionally written
   // to the module path. In rules_swift >= 3.x these same files are no longer
   // tracked by Bazel unless explicitly requested. When using non-sandboxed
@@ -494,14 +617,13 @@ int SwiftRunner::Run(std::ostream* stderr_stream, bool stdout_to_stderr) {
   }
 
   if (hermetic_pcm_) {
-    auto response_file = WriteResponseFile(args_);
-    std::vector<std::string> spawn_args =
-        ArgsWithResponseFile(tool_args_, args_, *response_file);
-    exit_code = RunHermeticPcm(spawn_args, &job_env_, stderr_stream);
+    exit_code = RunHermeticPcm(SpawnArgs(tool_args_), tool_args_, args_,
+                               &job_env_, stderr_stream);
   } else {
-    exit_code =
-        SpawnJob(tool_args_, args_, &job_env_, stderr_stream, stdout_to_stderr);
+    exit_code = SpawnDriver(SpawnArgs(tool_args_), args_, &job_env_,
+                            stderr_stream, stdout_to_stderr);
   }
+  PublishModuleCache();
 
   if (verbose_) {
     PrintVerboseInvocation(FullArgsForDisplay(tool_args_, args_),
@@ -512,11 +634,17 @@ int SwiftRunner::Run(std::ostream* stderr_stream, bool stdout_to_stderr) {
     return exit_code;
   }
 
-  if (is_verify_ && !CreateVerifyOutputs(output_file_map_path_,
+  if (is_verify_ && !CreateVerifyOutputs(CompilerOutputPaths(),
                                          emit_module_path_, stderr_stream)) {
     return EXIT_FAILURE;
   }
 
+  if (!unused_inputs_list_path_.empty() &&
+      !WriteUnusedInputsList(prunable_inputs_path_, DependencyFilePaths(),
+                             unused_inputs_list_path_, *stderr_stream)) {
+    return EXIT_FAILURE;
+  }
+
   if (!generated_header_rewriter_path_.empty()) {
     exit_code =
         PerformGeneratedHeaderRewriting(*stderr_stream, stdout_to_stderr);
@@ -527,67 +655,119 @@ int SwiftRunner::Run(std::ostream* stderr_stream, bool stdout_to_stderr) {
 
   auto enable_global_index_store = global_index_store_import_path_ != "";
   if (enable_global_index_store) {
+    // Need the actual output paths of the compiler - not bazel
+    std::vector<std::string> output_paths;
+    for (std::string& output_path : CompilerOutputPaths()) {
+      auto file_type = output_path.substr(output_path.find_last_of(".") + 1);
+      if (file_type == "o") {
+        output_paths.push_back(std::move(output_path));
+      }
+    }
+
+    std::vector<std::pair<std::string, std::string>> prefix_map;
+    if (file_prefix_pwd_is_dot_) {
+      prefix_map.emplace_back(std::filesystem::current_path().string(), ".");
+    }
+
+    const std::filesystem::path& exec_root = std::filesystem::current_path();
+    auto source_store = exec_root / global_index_store_import_path_;
+    auto destination_store = exec_root / index_store_path_;
+
+    // Importing in-process avoids spawning `index-import` for every compile and
+    // lets a persistent worker reuse what it learned about the global store.
+    // If it fails for any reason, fall back to the tool.
+    if (InProcessIndexImportEnabled() &&
+        IndexStoreImporter::Shared().Import(source_store, destination_store,
+                                            output_paths, prefix_map,
+                                            stderr_stream)) {
+      return exit_code;
+    }
+
     if (index_import_path_.empty()) {
       (*stderr_stream) << "Failed to find index-import path from runfiles\n";
       return EXIT_FAILURE;
     }
 
-    OutputFileMap output_file_map;
-    output_file_map.ReadFromPath(output_file_map_path_, "", "");
-
-    auto outputs = output_file_map.incremental_outputs();
-    std::map<std::string, std::string>::iterator it;
-
     std::vector<std::string> ii_args;
     ii_args.push_back(index_import_path_);
 
-    if (file_prefix_pwd_is_dot_) {
+    for (const auto& [prefix, replacement] : prefix_map) {
       ii_args.push_back("-file-prefix-map");
-      ii_args.push_back(std::filesystem::current_path().string() + "=.");
+      ii_args.push_back(prefix + "=" + replacement);
     }
 
-    for (it = outputs.begin(); it != outputs.end(); it++) {
-      // Need the actual output paths of the compiler - not bazel
-      auto output_path = it->first;
-      auto file_type = output_path.substr(output_path.find_last_of(".") + 1);
-      if (file_type == "o") {
-        ii_args.push_back("-import-output-file");
-        ii_args.push_back(output_path);
-      }
+    for (const auto& output_path : output_paths) {
+      ii_args.push_back("-import-output-file");
+      ii_args.push_back(output_path);
     }
 
-    const std::filesystem::path& exec_root = std::filesystem::current_path();
     // Copy back from the global index store to bazel's index store
-    ii_args.push_back((exec_root / global_index_store_import_path_).string());
-    ii_args.push_back((exec_root / index_store_path_).string());
+    ii_args.push_back(source_store.string());
+    ii_args.push_back(destination_store.string());
     exit_code = RunSubProcess(ii_args, /*env=*/nullptr, stderr_stream,
                               /*stdout_to_stderr=*/true);
   }
   return exit_code;
 }
 
+std::vector<std::string> SwiftRunner::CompilerOutputPaths() {
+  std::vector<std::string> output_paths;
+  if (output_file_map_ != nullptr) {
+    for (const auto& [unused, stored_path] :
+         output_file_map_->incremental_outputs()) {
+      output_paths.emplace_back(stored_path);
+    }
+    return output_paths;
+  }
+  if (output_file_map_path_.empty()) {
+    return output_paths;
+  }
+  if (own_output_file_map_ == nullptr) {
+    own_output_file_map_ = std::make_unique<OutputFileMap>();
+    own_output_file_map_->ReadFromPath(output_file_map_path_, "", "");
+  }
+  for (const auto& [declared_path, unused] :
+       own_output_file_map_->incremental_outputs()) {
+    output_paths.emplace_back(declared_path);
+  }
+  return output_paths;
+}
+
+std::vector<std::string> SwiftRunner::DependencyFilePaths() {
+  std::vector<std::string> dependency_file_paths;
+  for (std::string& output_path : CompilerOutputPaths()) {
+    if (absl::EndsWith(output_path, ".d")) {
+      dependency_file_paths.push_back(std::move(output_path));
+    }
+  }
+
+  // Without an output file map, the driver names the dependency file after the
+  // single object file.
+  if (output_file_map_path_.empty() && !output_path_.empty()) {
+    dependency_file_paths.push_back(std::filesystem::path(output_path_)
+                                        .replace_extension(".d")
+                                        .string());
+  }
+  return dependency_file_paths;
+}
+
 bool SwiftRunner::ProcessPossibleResponseFile(
     const std::string& arg, std::function<void(const std::string&)> consumer) {
   auto path = arg.substr(1);
-  std::ifstream original_file(path);
+  auto original_file = bazel_rules_swift::ResponseFile::Open(path);
 
   // If we couldn't open it, maybe it's not a file; maybe it's just some other
   // argument that starts with "@" such as "@loader_path/..."
-  if (!original_file.good()) {
+  if (original_file == nullptr) {
     consumer(arg);
     return false;
   }
 
-  std::vector<std::string> args;
-  for (std::string arg_from_file; std::getline(original_file, arg_from_file);) {
-    // Arguments in response files might be quoted/escaped. When forcing
-    // response files, unescape them before storing them in the processed
-    // argument vector.
-    args.push_back(force_response_file_ ? Unescape(arg_from_file)
-                                        : arg_from_file);
-  }
-
-  auto parsed_args = ParseArguments(args);
+  // Arguments in response files might be quoted/escaped. When forcing response
+  // files, unescape them before storing them in the processed argument vector.
+  auto parsed_args = ParseArguments(force_response_file_
+                                        ? original_file->UnescapedArguments()
+                                        : original_file->lines());
   if (force_response_file_) {
     for (auto it = parsed_args.begin(); it != parsed_args.end(); ++it) {
       ProcessArgument(it, *it, consumer);
@@ -682,9 +862,10 @@ bool SwiftRunner::ProcessArgument(
       // Create a temporary directory to hold the module cache, which will be
       // deleted after compilation is finished.
       auto module_cache_dir =
-          TempDirectory::Create("swift_module_cache.XXXXXX");
+          TempDirectory::CreatePreferringMemory("swift_module_cache.XXXXXX");
       consumer("-module-cache-path");
       consumer(module_cache_dir->GetPath());
+      ephemeral_module_cache_path_ = module_cache_dir->GetPath();
       temp_directories_.push_back(std::move(module_cache_dir));
       return true;
     }
@@ -737,9 +918,11 @@ std::vector<std::string> SwiftRunner::ParseArguments(Iterator itr) {
   // this is a `-dump-ast` invocation), so that those decisions are independent
   // of the order in which the arguments appear.
   std::vector<std::string> out_args;
+  out_args.reserve(itr.size());
   for (auto it = itr.begin(); it != itr.end(); ++it) {
-    std::string arg = *it;
-    out_args.push_back(arg);
+    // Only the current argument is inspected below, before anything else is
+    // appended to `out_args`, so it is safe to refer to it in place.
+    const std::string& arg = out_args.emplace_back(*it);
 
     absl::string_view value = arg;
     if (absl::ConsumePrefix(&value, "-Xwrapped-swift=")) {
@@ -764,37 +947,45 @@ std::vector<std::string> SwiftRunner::ParseArguments(Iterator itr) {
                      &value, "-explicit-compile-module-from-interface=")) {
         module_or_interface_path_ = std::string(value);
         bazel_placeholder_substitutions_.Apply(module_or_interface_path_);
+      } else if (absl::ConsumePrefix(&value, "-unused-inputs-list=")) {
+        unused_inputs_list_path_ = std::string(value);
+      } else if (absl::ConsumePrefix(&value, "-prunable-inputs=")) {
+        prunable_inputs_path_ = std::string(value);
       }
     } else if (arg == "-output-file-map") {
       ++it;
-      output_file_map_path_ = *it;
-      out_args.push_back(*it);
+      output_file_map_path_ = std::string(*it);
+      out_args.push_back(output_file_map_path_);
+    } else if (arg == "-o") {
+      ++it;
+      output_path_ = std::string(*it);
+      out_args.push_back(output_path_);
     } else if (arg == "-dump-ast") {
       is_dump_ast_ = true;
     } else if (arg == "-verify") {
       is_verify_ = true;
     } else if (arg == "-emit-module-path") {
       ++it;
-      emit_module_path_ = *it;
-      std::filesystem::path module_path(*it);
+      emit_module_path_ = std::string(*it);
+      std::filesystem::path module_path(emit_module_path_);
       swift_source_info_path_ =
           module_path.replace_extension(".swiftsourceinfo").string();
-      out_args.push_back(*it);
+      out_args.push_back(emit_module_path_);
     } else if (arg == "-module-name") {
       ++it;
-      module_name_ = *it;
-      out_args.push_back(*it);
+      module_name_ = std::string(*it);
+      out_args.push_back(module_name_);
     } else if (arg == "-module-alias") {
       ++it;
       std::pair<std::string, std::string> source_and_alias =
           absl::StrSplit(*it, absl::MaxSplits('=', 1));
       alias_to_source_mapping_[source_and_alias.second] =
           source_and_alias.first;
-      out_args.push_back(*it);
+      out_args.emplace_back(*it);
     } else if (arg == "-target") {
       ++it;
-      target_triple_ = *it;
-      out_args.push_back(*it);
+      target_triple_ = std::string(*it);
+      out_args.push_back(target_triple_);
     } else if (arg == "-v") {
       verbose_ = true;
     }
@@ -821,18 +1012,123 @@ void SwiftRunner::ProcessArguments(const std::vector<std::string>& args) {
     ++it;
   }
 
+  // Macro plugins are run through the worker's pool of plugin processes, if
+  // it has one.
+  if (PluginPool* plugin_pool = PluginPool::Shared()) {
+    plugin_pool->RewriteArguments(args_, job_env_);
+  }
+
   if (!module_or_interface_path_.empty()) {
     ExtractFlagsFromInterfaceFile(
-        module_or_interface_path_, target_triple_,
-        [&]() {
-          const char* developer_dir = std::getenv("DEVELOPER_DIR");
-          if (developer_dir != nullptr) return std::string(developer_dir);
-          return std::string();
-        },
+        module_or_interface_path_, target_triple_, DeveloperDirFromEnvironment,
         [&](absl::string_view arg) { args_.push_back(std::string(arg)); });
   }
 }
 
+void SwiftRunner::WriteResponseFiles() {
+  if (!response_file_args_.empty()) {
+    return;
+  }
+
+  auto add_response_file = [&](const std::vector<std::string>& args) {
+    std::unique_ptr<TempFile> response_file = WriteResponseFile(args);
+    std::string response_file_arg = "@" + response_file->GetPath();
+    temp_files_.push_back(std::move(response_file));
+    return response_file_arg;
+  };
+
+  if (deps_modules_path_.empty()) {
+    response_file_args_.push_back(add_response_file(args_));
+    return;
+  }
+
+  // Split the arguments into those that the layering check shares with the
+  // compile and those that only the compile uses, so that neither job needs a
+  // response file of its own.
+  std::vector<std::string> common_args;
+  std::vector<std::string> compile_only_args;
+  bool order_matters = false;
+  for (auto it = args_.begin(); it != args_.end(); ++it) {
+    auto first = it;
+    if (SkipLayeringCheckIncompatibleArgs(it)) {
+      compile_only_args.insert(compile_only_args.end(), first, it + 1);
+    } else {
+      // Moving `-whole-module-optimization` after the flag that negates it
+      // would change which one wins.
+      order_matters |= *it == "-no-whole-module-optimization";
+      common_args.push_back(*it);
+    }
+  }
+
+  std::string common_response_file_arg = add_response_file(common_args);
+  layering_check_response_file_args_.push_back(common_response_file_arg);
+  if (order_matters) {
+    response_file_args_.push_back(add_response_file(args_));
+    return;
+  }
+  response_file_args_.push_back(common_response_file_arg);
+  if (!compile_only_args.empty()) {
+    response_file_args_.push_back(add_response_file(compile_only_args));
+  }
+}
+
+std::vector<std::string> SwiftRunner::SpawnArgs(
+    const std::vector<std::string>& tool_args, bool for_layering_check) {
+  std::vector<std::string> spawn_args(tool_args);
+  if (!SupportsResponseFileInvocation(args_)) {
+    for (auto it = args_.begin(); it != args_.end(); ++it) {
+      if (!for_layering_check || !SkipLayeringCheckIncompatibleArgs(it)) {
+        spawn_args.push_back(*it);
+      }
+    }
+    return spawn_args;
+  }
+
+  WriteResponseFiles();
+  const std::vector<std::string>& response_file_args =
+      for_layering_check ? layering_check_response_file_args_
+                         : response_file_args_;
+  spawn_args.insert(spawn_args.end(), response_file_args.begin(),
+                    response_file_args.end());
+  return spawn_args;
+}
+
+int SwiftRunner::SpawnDriver(const std::vector<std::string>& spawn_args,
+                             const std::vector<std::string>& driver_args,
+                             std::map<std::string, std::string>* env,
+                             std::ostream* stderr_stream,
+                             bool stdout_to_stderr) {
+  if (DriverBypass::Enabled() && PlansSingleFrontendJob(driver_args)) {
+    std::optional<std::vector<std::string>> frontend_command =
+        DriverBypass::Shared().FrontendCommand(
+            spawn_args, tool_args_, driver_args, ephemeral_module_cache_path_,
+            env);
+    if (frontend_command.has_value()) {
+      return RunSubProcess(*frontend_command, env, stderr_stream,
+                           stdout_to_stderr);
+    }
+  }
+  return RunSubProcess(spawn_args, env, stderr_stream, stdout_to_stderr);
+}
+
+void SwiftRunner::PopulateModuleCache() {
+  ModuleCacheStore* store = ModuleCacheStore::Shared();
+  if (store == nullptr || ephemeral_module_cache_path_.empty()) {
+    return;
+  }
+  module_cache_view_ =
+      store->Populate(ModuleCacheStore::ViewKey(tool_args_, args_),
+                      ephemeral_module_cache_path_);
+}
+
+void SwiftRunner::PublishModuleCache() {
+  // Modules are written to the cache by renaming complete files into place,
+  // so even a failed compile leaves only complete modules to publish.
+  if (module_cache_view_.has_value()) {
+    ModuleCacheStore::Shared()->Publish(*module_cache_view_);
+  }
+}
+
 int SwiftRunner::PerformGeneratedHeaderRewriting(std::ostream& stderr_stream,
                                                  bool stdout_to_stderr) {
 #if __APPLE__
@@ -852,8 +1148,8 @@ int SwiftRunner::PerformGeneratedHeaderRewriting(std::ostream& stderr_stream,
   rewriter_tool_args.push_back("--");
   rewriter_tool_args.push_back(tool_args_[tool_binary_index]);
 
-  return SpawnJob(rewriter_tool_args, args_, /*env=*/nullptr, &stderr_stream,
-                  stdout_to_stderr);
+  return RunSubProcess(SpawnArgs(rewriter_tool_args), /*env=*/nullptr,
+                       &stderr_stream, stdout_to_stderr);
 }
 
 int SwiftRunner::PerformLayeringCheck(std::ostream& stderr_stream,
@@ -865,18 +1161,27 @@ int SwiftRunner::PerformLayeringCheck(std::ostream& stderr_stream,
       ReplaceExtension(deps_modules_path_, ".imported-modules",
                        /*all_extensions=*/true);
 
-  std::vector<std::string> emit_imports_args;
-  for (auto it = args_.begin(); it != args_.end(); ++it) {
-    if (!SkipLayeringCheckIncompatibleArgs(it)) {
-      emit_imports_args.push_back(*it);
+  std::vector<std::string> emit_imports_args = {"-emit-imported-modules", "-o",
+                                               imported_modules_path};
+  std::vector<std::string> spawn_args =
+      SpawnArgs(tool_args_, /*for_layering_check=*/true);
+  spawn_args.insert(spawn_args.end(), emit_imports_args.begin(),
+                    emit_imports_args.end());
+
+  // The arguments the driver sees, which the bypass uses to recognize the
+  // invocation.
+  std::vector<std::string> driver_args;
+  if (DriverBypass::Enabled()) {
+    for (auto it = args_.begin(); it != args_.end(); ++it) {
+      if (!SkipLayeringCheckIncompatibleArgs(it)) {
+        driver_args.push_back(*it);
+      }
     }
+    driver_args.insert(driver_args.end(), emit_imports_args.begin(),
+                       emit_imports_args.end());
   }
-
-  emit_imports_args.push_back("-emit-imported-modules");
-  emit_imports_args.push_back("-o");
-  emit_imports_args.push_back(imported_modules_path);
-  int exit_code = SpawnJob(tool_args_, emit_imports_args, &job_env_,
-                           &stderr_stream, stdout_to_stderr);
+  int exit_code = SpawnDriver(spawn_args, driver_args, &job_env_,
+                              &stderr_stream, stdout_to_stderr);
   if (exit_code != 0) {
     WithColor(stderr_stream, Color::kBoldRed) << std::endl << "error: ";
     WithColor(stderr_stream, Color::kBold)
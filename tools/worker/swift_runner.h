@@ -19,12 +19,15 @@
 #include <iostream>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "tools/common/bazel_substitutions.h"
 #include "tools/common/temp_file.h"
+#include "tools/worker/module_cache_store.h"
+#include "tools/worker/output_file_map.h"
 
 // Returns true if the given command line argument enables whole-module
 // optimization in the compiler.
@@ -59,7 +62,10 @@ extern bool ArgumentEnablesWMO(const std::string& arg);
 //     that to the Swift compiler using `-module-cache-path`, and then delete
 //     the directory afterwards. This should resolve issues where the module
 //     cache state is not refreshed correctly in all situations, which
-//     sometimes results in hard-to-diagnose crashes in `swiftc`.
+//     sometimes results in hard-to-diagnose crashes in `swiftc`. If the
+//     `ModuleCacheStore` is enabled, the directory starts with the modules
+//     that earlier compiles built, and the modules built by this one are
+//     published to the store.
 class SwiftRunner {
  public:
   // Create a new spawner that launches a Swift tool with the given arguments.
@@ -69,11 +75,31 @@ class SwiftRunner {
   SwiftRunner(const std::vector<std::string>& args,
               std::string index_import_path, bool force_response_file = false);
 
+  // Deletes the temporary files and directories created for the invocation.
+  // Directories are handed to the shared `DirectoryReaper` if it is running.
+  ~SwiftRunner();
+
   // Run the Swift compiler, redirecting stderr to the specified stream. If
   // stdout_to_stderr is true, then stdout is also redirected to that stream.
   int Run(std::ostream* stderr_stream, bool stdout_to_stderr = false);
 
+  // Tells the runner that the caller has already parsed the output file map
+  // passed to the compiler and rewritten it for incremental compilation, so
+  // that the runner uses it instead of reading the file again. The map must
+  // outlive the runner.
+  void SetOutputFileMap(const OutputFileMap* output_file_map) {
+    output_file_map_ = output_file_map;
+  }
+
  private:
+  // Returns the paths of the per-source outputs that the compiler writes,
+  // reading the output file map at most once.
+  std::vector<std::string> CompilerOutputPaths();
+
+  // Returns the paths of the Make-style dependency files that the compiler
+  // writes, which list the files it read.
+  std::vector<std::string> DependencyFilePaths();
+
   // Processes an argument that looks like it might be a response file (i.e., it
   // begins with '@') and returns true if the argument(s) passed to the consumer
   // were different than "arg").
@@ -117,6 +143,36 @@ class SwiftRunner {
   // `tool_args_` and `args_` vectors.
   void ProcessArguments(const std::vector<std::string>& args);
 
+  // Writes the response files for this invocation, if they haven't been
+  // written yet. Every job spawned for the invocation shares the same files:
+  // when a layering check is performed, the arguments it shares with the
+  // compile are written once, and those that only the compile uses are written
+  // to a second, smaller file.
+  void WriteResponseFiles();
+
+  // Returns the command line that spawns the tool in `tool_args` with the
+  // arguments in `args_`, which are passed through the shared response files
+  // when the invocation supports them. If `for_layering_check` is true, the
+  // arguments that are incompatible with `-emit-imported-modules` are omitted.
+  std::vector<std::string> SpawnArgs(const std::vector<std::string>& tool_args,
+                                     bool for_layering_check = false);
+
+  // Runs the driver with `spawn_args`, which pass it `driver_args`. If the
+  // driver bypass is enabled and the invocation is a single frontend job, the
+  // frontend is launched directly instead.
+  int SpawnDriver(const std::vector<std::string>& spawn_args,
+                  const std::vector<std::string>& driver_args,
+                  std::map<std::string, std::string>* env,
+                  std::ostream* stderr_stream, bool stdout_to_stderr);
+
+  // Populates the ephemeral module cache from the `ModuleCacheStore`, if both
+  // are in use.
+  void PopulateModuleCache();
+
+  // Publishes the modules built in the ephemeral module cache to the
+  // `ModuleCacheStore`, if it was populated from it.
+  void PublishModuleCache();
+
   // Spawns the generated header rewriter to perform any desired transformations
   // on the Clang header emitted from a Swift compilation.
   int PerformGeneratedHeaderRewriting(std::ostream& stderr_stream,
@@ -154,10 +210,20 @@ class SwiftRunner {
   // after the driver has terminated.
   std::vector<std::unique_ptr<TempFile>> temp_files_;
 
+  // The `@file` arguments that pass `args_` to the spawned jobs, and those
+  // that pass only the arguments compatible with the layering check.
+  std::vector<std::string> response_file_args_;
+  std::vector<std::string> layering_check_response_file_args_;
+
   // Temporary directories (e.g., ephemeral module cache) that should be cleaned
   // up after the driver has terminated.
   std::vector<std::unique_ptr<TempDirectory>> temp_directories_;
 
+  // The path of the ephemeral module cache, if one was requested, and the
+  // modules it was populated with from the `ModuleCacheStore`.
+  std::string ephemeral_module_cache_path_;
+  std::optional<ModuleCacheView> module_cache_view_;
+
   // Whether readable input response files should be flattened into the response
   // file created when spawning the Swift job.
   bool force_response_file_;
@@ -203,9 +269,24 @@ class SwiftRunner {
   // The path of the output map file
   std::string output_file_map_path_;
 
+  // The parsed output file map, if the caller provided one (in which case the
+  // compiler writes to its incremental storage paths), or the one the runner
+  // read from `output_file_map_path_` itself.
+  const OutputFileMap* output_file_map_ = nullptr;
+  std::unique_ptr<OutputFileMap> own_output_file_map_;
+
   // The path where the Swift module will be written.
   std::string emit_module_path_;
 
+  // The path of the single output file passed with `-o`, if any.
+  std::string output_path_;
+
+  // The path where the inputs that the compiler didn't read are listed for
+  // Bazel, and the path of the list of inputs that may appear there, if
+  // unused inputs are being reported.
+  std::string unused_inputs_list_path_;
+  std::string prunable_inputs_path_;
+
   // The index store path argument passed to the runner
   std::string index_store_path_;
 
@@ -0,0 +1,58 @@
+#!/bin/bash
+# Copyright 2026 The Bazel Authors. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Regenerates the objects and archives that `autolink_extractor_test` reads.
+# The objects cover both byte orders and both ELF classes, and the archives
+# cover GNU and BSD long member names and a thin archive, which the worker
+# leaves to `swift-autolink-extract`.
+#
+# The `.autolink` files are what `swift-autolink-extract` writes for the
+# inputs the test passes it. After regenerating the inputs, check them with
+#
+#   swift-autolink-extract le64.o libgnu.a be32.o -o le64_libgnu_be32.autolink
+#   swift-autolink-extract libbsd.a -o libbsd.autolink
+
+set -euo pipefail
+
+cd "$(dirname "$0")"
+readonly scratch="$(mktemp -d)"
+trap 'rm -rf "$scratch"' EXIT
+
+# Assembles an object for the target triple $1 whose autolink section has the
+# NUL-terminated entries $3..., into $2.
+object() {
+  local triple="$1" output="$2"
+  shift 2
+  local entries
+  entries="$(printf '%s\\0' "$@")"
+  printf '.section .swift1_autolink_entries,"e",@progbits\n.ascii "%s"\n' \
+      "$entries" | llvm-mc -triple="$triple" -filetype=obj -o "$output" -
+}
+
+object x86_64-linux-gnu le64.o \
+    -lswiftCore -lFoo -lswiftSwiftOnoneSupport -lBar
+object powerpc64-linux-gnu be64.o -lBar -lBaz -lswift_Concurrency
+object powerpc-linux-gnu be32.o -lswiftCore -lFoo -lCorge
+object i386-linux-gnu "$scratch/a_long_object_file_name.o" -lQux -lm
+printf '.text\nnop\n' |
+    llvm-mc -triple=x86_64-linux-gnu -filetype=obj -o "$scratch/none.o" -
+
+rm -f libgnu.a libbsd.a libthin.a
+cp be64.o "$scratch/"
+(cd "$scratch" && llvm-ar rc libgnu.a be64.o a_long_object_file_name.o none.o)
+(cd "$scratch" &&
+    llvm-ar --format=bsd rc libbsd.a be64.o a_long_object_file_name.o)
+mv "$scratch/libgnu.a" "$scratch/libbsd.a" .
+llvm-ar rcT libthin.a be32.o
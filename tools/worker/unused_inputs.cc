@@ -0,0 +1,143 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/worker/unused_inputs.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+
+namespace {
+
+// Returns the contents of the file at `path`, or nothing if it can't be read.
+std::optional<std::string> ReadFile(const std::string& path) {
+  std::ifstream stream(path, std::ios::binary);
+  if (!stream.good()) {
+    return std::nullopt;
+  }
+  std::string contents((std::istreambuf_iterator<char>(stream)),
+                       std::istreambuf_iterator<char>());
+  if (stream.bad()) {
+    return std::nullopt;
+  }
+  return contents;
+}
+
+// Returns `path` relative to the execution root, if it is inside it, and
+// lexically normalized, so that the same file is spelled the same way whether
+// it came from the build rules or from the compiler.
+std::string NormalizePath(absl::string_view path,
+                          const std::filesystem::path& exec_root) {
+  std::filesystem::path normalized =
+      std::filesystem::path(std::string(path)).lexically_normal();
+  if (normalized.is_absolute()) {
+    std::filesystem::path relative = normalized.lexically_relative(exec_root);
+    if (!relative.empty() && *relative.begin() != "..") {
+      normalized = relative;
+    }
+  }
+  return normalized.generic_string();
+}
+
+// Adds the paths in the Make-style dependency file `contents` to `paths`. The
+// targets of each rule are added as well; they are outputs of the compile, so
+// they never match a prunable input.
+void AddDependencyPaths(absl::string_view contents,
+                        const std::filesystem::path& exec_root,
+                        absl::flat_hash_set<std::string>& paths) {
+  std::string token;
+  auto finish_token = [&]() {
+    absl::string_view path = token;
+    absl::ConsumeSuffix(&path, ":");
+    if (!path.empty()) {
+      paths.insert(NormalizePath(path, exec_root));
+    }
+    token.clear();
+  };
+
+  for (size_t i = 0; i < contents.size(); ++i) {
+    char c = contents[i];
+    char next = i + 1 < contents.size() ? contents[i + 1] : '\0';
+    if (c == '\\' && (next == ' ' || next == '#' || next == '\\')) {
+      // An escaped character that is part of the path.
+      token.push_back(next);
+      ++i;
+    } else if (c == '\\' && (next == '\n' || next == '\r')) {
+      // A line continuation.
+      finish_token();
+    } else if (c == '$' && next == '$') {
+      token.push_back('$');
+      ++i;
+    } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+      finish_token();
+    } else {
+      token.push_back(c);
+    }
+  }
+  finish_token();
+}
+
+}  // namespace
+
+bool WriteUnusedInputsList(
+    const std::string& prunable_inputs_path,
+    const std::vector<std::string>& dependency_file_paths,
+    const std::string& unused_inputs_path, std::ostream& stderr_stream) {
+  std::string unused_inputs;
+
+  std::optional<std::string> prunable_inputs = ReadFile(prunable_inputs_path);
+  absl::flat_hash_set<std::string> used_paths;
+  bool all_dependencies_known =
+      prunable_inputs.has_value() && !dependency_file_paths.empty();
+  std::filesystem::path exec_root = std::filesystem::current_path();
+  for (auto it = dependency_file_paths.begin();
+       all_dependencies_known && it != dependency_file_paths.end(); ++it) {
+    std::optional<std::string> contents = ReadFile(*it);
+    if (contents.has_value()) {
+      AddDependencyPaths(*contents, exec_root, used_paths);
+    } else {
+      all_dependencies_known = false;
+    }
+  }
+
+  if (all_dependencies_known) {
+    for (absl::string_view input :
+         absl::StrSplit(*prunable_inputs, '\n', absl::SkipEmpty())) {
+      absl::ConsumeSuffix(&input, "\r");
+      if (!input.empty() &&
+          !used_paths.contains(NormalizePath(input, exec_root))) {
+        unused_inputs.append(input.data(), input.size());
+        unused_inputs.push_back('\n');
+      }
+    }
+  }
+
+  std::ofstream stream(unused_inputs_path, std::ios::binary | std::ios::trunc);
+  stream.write(unused_inputs.data(), unused_inputs.size());
+  stream.close();
+  if (!stream.good()) {
+    stderr_stream << "swift_worker: Could not write the unused inputs list "
+                  << unused_inputs_path << "\n";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,36 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_UNUSED_INPUTS_H_
+#define BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_UNUSED_INPUTS_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Writes the Bazel `unused_inputs_list` of a compile to `unused_inputs_path`:
+// the paths listed one per line in `prunable_inputs_path` that none of the
+// Make-style dependency files at `dependency_file_paths` mention. Paths in the
+// dependency files are compared after making them relative to the current
+// directory (the execution root) and normalizing them lexically.
+//
+// If any dependency file is missing or can't be read, nothing is known to be
+// unused and an empty list is written. Returns false and writes a diagnostic to
+// `stderr_stream` only if the list itself couldn't be written.
+bool WriteUnusedInputsList(
+    const std::string& prunable_inputs_path,
+    const std::vector<std::string>& dependency_file_paths,
+    const std::string& unused_inputs_path, std::ostream& stderr_stream);
+
+#endif  // BUILD_BAZEL_RULES_SWIFT_TOOLS_WORKER_UNUSED_INPUTS_H_
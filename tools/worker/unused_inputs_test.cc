@@ -0,0 +1,160 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Tests for computing a compile's unused inputs list from the dependency files
+// it wrote. Each test writes the prunable inputs and dependency files into the
+// current directory, which stands in for the execution root.
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "tools/common/test_support.h"
+#include "tools/worker/unused_inputs.h"
+
+namespace {
+
+constexpr char kPrunableInputs[] = "prunable_inputs.txt";
+constexpr char kUnusedInputs[] = "unused_inputs.txt";
+
+void WriteFile(const std::string& path, const std::string& contents) {
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream stream(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(stream),
+                     std::istreambuf_iterator<char>());
+}
+
+// Writes `prunable_inputs` and the dependency files with the given contents,
+// and returns the unused inputs list that is written for them.
+std::string UnusedInputs(const std::string& prunable_inputs,
+                         const std::vector<std::string>& dependency_files) {
+  WriteFile(kPrunableInputs, prunable_inputs);
+  std::vector<std::string> dependency_file_paths;
+  for (const std::string& contents : dependency_files) {
+    std::string path =
+        "dependencies" + std::to_string(dependency_file_paths.size()) + ".d";
+    WriteFile(path, contents);
+    dependency_file_paths.push_back(path);
+  }
+  std::ostringstream stderr_stream;
+  CHECK(WriteUnusedInputsList(kPrunableInputs, dependency_file_paths,
+                              kUnusedInputs, stderr_stream));
+  CHECK(stderr_stream.str().empty());
+  return ReadFile(kUnusedInputs);
+}
+
+void TestEscapedPaths() {
+  std::string unused = UnusedInputs(
+      "Sources/With Space.swift\n"
+      "Headers/Hash#.h\n"
+      "Headers/Dollar$.h\n"
+      "Headers/Back\\slash.h\n"
+      "Headers/Unused.h\n",
+      {"A.o: Sources/With\\ Space.swift Headers/Hash\\#.h \\\n"
+       "  Headers/Dollar$$.h Headers/Back\\\\slash.h\n"});
+  CHECK(unused == "Headers/Unused.h\n");
+}
+
+void TestMultipleTargetsAndRules() {
+  std::string unused = UnusedInputs(
+      "a.h\nb.h\nc.h\nd.h\ne.h\nf.h\n",
+      {"A.o A.swiftmodule: a.h \\\n"
+       "    b.h\n"
+       "B.o: c.h\n"
+       "\n"
+       "C.o \\\n"
+       "  : e.h\n",
+       "D.o:\td.h"});
+  CHECK(unused == "f.h\n");
+}
+
+void TestPathsAreNormalized() {
+  std::string absolute =
+      (std::filesystem::current_path() / "Headers/Absolute.h").string();
+  std::string unused = UnusedInputs(
+      "./Headers/Dotted.h\r\n"
+      "Headers/Absolute.h\r\n"
+      "Headers/Unused.h\r\n"
+      "\n",
+      {"A.o: Headers/Other/../Dotted.h " + absolute + "\n"});
+  CHECK(unused == "Headers/Unused.h\n");
+}
+
+void TestOnlyPrunableInputsAreReported() {
+  // Dependencies, and targets, that aren't prunable are never reported.
+  std::string prunable = "Headers/Used.h\nHeaders/Unused.h\n";
+  std::string unused = UnusedInputs(
+      prunable, {"A.o: Sources/A.swift Headers/Used.h /sdk/usr/include/c.h\n"
+                 "bazel-out/B.o: Headers/Generated.h\n"});
+  CHECK(unused == "Headers/Unused.h\n");
+  for (absl::string_view line :
+       absl::StrSplit(unused, '\n', absl::SkipEmpty())) {
+    CHECK(prunable.find(std::string(line) + "\n") != std::string::npos);
+  }
+
+  // Nothing is prunable, so nothing is reported however little is used.
+  CHECK(UnusedInputs("", {"A.o: a.h\n"}).empty());
+}
+
+void TestNothingIsUnusedWithoutEveryDependencyFile() {
+  WriteFile(kPrunableInputs, "a.h\nb.h\n");
+  WriteFile("present.d", "A.o: a.h\n");
+  std::ostringstream stderr_stream;
+  CHECK(WriteUnusedInputsList(kPrunableInputs, {"present.d", "missing.d"},
+                              kUnusedInputs, stderr_stream));
+  CHECK(ReadFile(kUnusedInputs).empty());
+
+  CHECK(WriteUnusedInputsList(kPrunableInputs, {}, kUnusedInputs,
+                              stderr_stream));
+  CHECK(ReadFile(kUnusedInputs).empty());
+
+  CHECK(WriteUnusedInputsList("missing.txt", {"present.d"}, kUnusedInputs,
+                              stderr_stream));
+  CHECK(ReadFile(kUnusedInputs).empty());
+  CHECK(stderr_stream.str().empty());
+}
+
+void TestReportsWhenListCantBeWritten() {
+  WriteFile(kPrunableInputs, "a.h\n");
+  WriteFile("present.d", "A.o: a.h\n");
+  std::ostringstream stderr_stream;
+  CHECK(!WriteUnusedInputsList(kPrunableInputs, {"present.d"},
+                               "missing_directory/unused_inputs.txt",
+                               stderr_stream));
+  CHECK(stderr_stream.str().find("swift_worker: Could not write") !=
+        std::string::npos);
+}
+
+}  // namespace
+
+int main() {
+  std::filesystem::current_path(
+      bazel_rules_swift::testing::MakeTestDirectory("unused_inputs_test"));
+
+  TestEscapedPaths();
+  TestMultipleTargetsAndRules();
+  TestPathsAreNormalized();
+  TestOnlyPrunableInputsAreReported();
+  TestNothingIsUnusedWithoutEveryDependencyFile();
+  TestReportsWhenListCantBeWritten();
+  return bazel_rules_swift::testing::TestExitCode();
+}
@@ -14,41 +14,110 @@
 
 #include "tools/worker/work_processor.h"
 
-#if defined(__APPLE__)
-#include <copyfile.h>
-#endif
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <map>
+#include <memory>
+#include <optional>
 #include <set>
 #include <sstream>
 #include <string>
+#include <vector>
 
+#include "absl/strings/string_view.h"
+#include "tools/common/file_operation_batch.h"
 #include "tools/common/file_system.h"
-#include "tools/common/temp_file.h"
+#include "tools/common/file_transfer.h"
+#include "tools/common/response_file.h"
+#include "tools/worker/file_snapshot.h"
+#include "tools/worker/incremental_manifest.h"
+#include "tools/worker/incremental_storage_quota.h"
+#include "tools/worker/input_digest_table.h"
 #include "tools/worker/output_file_map.h"
+#include "tools/worker/output_file_map_cache.h"
 #include "tools/worker/swift_runner.h"
 #include "tools/worker/worker_protocol.h"
 
 namespace {
 
+using bazel_rules_swift::FileOperationBatch;
+using bazel_rules_swift::FileTransferStats;
 using bazel_rules_swift::LongPath;
+using bazel_rules_swift::TransferFile;
+using bazel_rules_swift::UnescapeResponseFileArgument;
+
+// Makes the file at `to` a copy of the one at `from` after a successful
+// compile. If `to` already has the same contents it is left alone, so that
+// files the compiler didn't rewrite cost a `stat` rather than a copy. The two
+// paths never share an inode: Bazel makes its outputs read-only once the action
+// finishes, and a tool that rewrote either file in place would corrupt the
+// other, so the file is cloned or copied rather than hard linked.
+static bool SyncFile(const std::filesystem::path& from,
+                     const std::filesystem::path& to,
+                     FileTransferStats& transfer_stats, std::error_code& ec) {
+  FileSnapshotCache& snapshot_cache = FileSnapshotCache::Shared();
+  if (std::filesystem::exists(LongPath(to), ec)) {
+    if (snapshot_cache.HaveSameContents(from, to)) {
+      transfer_stats.RecordUnchanged(
+          std::filesystem::file_size(LongPath(to), ec));
+      ec.clear();
+      return true;
+    }
+    // TransferFile fails if the file already exists
+    std::filesystem::remove(LongPath(to), ec);
+  }
 
-bool copy_file(const std::filesystem::path& from,
-               const std::filesystem::path& to, std::error_code& ec) noexcept {
-#if defined(__APPLE__)
-  if (copyfile(from.string().c_str(), to.string().c_str(), nullptr,
-               COPYFILE_ALL | COPYFILE_CLONE) < 0) {
-    ec = std::error_code(errno, std::system_category());
+  if (!TransferFile(from, to, /*allow_hard_link=*/false, &transfer_stats, ec)) {
     return false;
   }
-  ec = std::error_code();
+  snapshot_cache.RecordCopy(from, to);
   return true;
-#else
-  return std::filesystem::copy_file(LongPath(from), LongPath(to), ec);
-#endif
+}
+
+// Returns true if the driver's build record should be rewritten to reflect
+// which inputs actually changed according to their digests. This is opt-in via
+// `RULES_SWIFT_INPUT_DIGESTS=1`.
+static bool UseInputDigests() {
+  const char* enabled = std::getenv("RULES_SWIFT_INPUT_DIGESTS");
+  return enabled != nullptr && std::string(enabled) == "1";
+}
+
+// Records what the incremental storage area now holds for the next compile to
+// validate against. If that fails, the stale manifest is removed so that the
+// next compile doesn't trust it.
+static void RecordIncrementalStorage(const OutputFileMap& output_file_map,
+                                     const std::string& manifest_path,
+                                     FileSnapshotCache& snapshot_cache) {
+  std::vector<std::string> stored_paths;
+  std::string module_swiftdeps(output_file_map.incremental_module_swiftdeps());
+  stored_paths.push_back(module_swiftdeps);
+  stored_paths.push_back(std::filesystem::path(module_swiftdeps)
+                             .replace_extension(".priors")
+                             .string());
+  for (const auto& [swiftdeps, outputs] :
+       output_file_map.incremental_source_outputs()) {
+    stored_paths.emplace_back(swiftdeps);
+    for (absl::string_view output : outputs) {
+      stored_paths.emplace_back(output);
+    }
+  }
+  for (const auto& expected_object_pair :
+       output_file_map.incremental_inputs()) {
+    stored_paths.emplace_back(expected_object_pair.second);
+  }
+  IncrementalManifest manifest;
+  manifest.ReadFromPath(manifest_path);
+  manifest.Record(stored_paths, snapshot_cache);
+  if (!manifest.WriteToPath(manifest_path)) {
+    std::error_code ec;
+    std::filesystem::remove(LongPath(manifest_path), ec);
+  }
 }
 
 static void FinalizeWorkRequest(
@@ -72,18 +141,17 @@ WorkProcessor::WorkProcessor(const std::vector<std::string>& args,
 void WorkProcessor::ProcessWorkRequest(
     const bazel_rules_swift::worker_protocol::WorkRequest& request,
     bazel_rules_swift::worker_protocol::WorkResponse& response) {
-  std::vector<std::string> processed_args(universal_args_);
-
   // Bazel's worker spawning strategy reads the arguments from the params file
   // and inserts them into the proto. This means that if we just try to pass
   // them verbatim to swiftc, we might end up with a command line that's too
-  // long. Rather than try to figure out these limits (which is very
-  // OS-specific and easy to get wrong), we unconditionally write the processed
-  // arguments out to a params file.
-  auto params_file = TempFile::Create("swiftc_params.XXXXXX");
-  std::ofstream params_file_stream(params_file->GetPath());
+  // long. The processed arguments are kept in memory and handed to the
+  // `SwiftRunner`, which unconditionally writes them to a single response file
+  // that every job it spawns for this request shares.
+  std::vector<std::string> processed_args(universal_args_);
+  processed_args.reserve(universal_args_.size() + request.arguments.size() + 3);
 
-  OutputFileMap output_file_map;
+  std::shared_ptr<const OutputFileMap> output_file_map =
+      std::make_shared<OutputFileMap>();
   std::string output_file_map_path;
   std::string emit_module_path;
   std::string emit_objc_header_path;
@@ -118,54 +186,110 @@ void WorkProcessor::ProcessWorkRequest(
       emit_swift_source_info = true;
     }
 
+    // The arguments are unescaped the way those in a response file are, so
+    // that quoted and escaped arguments reach the compiler as they do when the
+    // worker isn't used. Most arguments have nothing to unescape.
     if (!arg.empty()) {
-      params_file_stream << arg << '\n';
+      if (arg.find_first_of("\"'\\") == std::string::npos) {
+        processed_args.push_back(arg);
+      } else {
+        processed_args.push_back(UnescapeResponseFileArgument(arg));
+      }
     }
 
     prev_arg = original_arg;
   }
 
-  bool is_incremental = !is_wmo && !is_dump_ast;
+  bool is_incremental =
+      !is_wmo && !is_dump_ast && !output_file_map_path.empty();
 
   if (!output_file_map_path.empty()) {
     if (is_incremental) {
-      output_file_map.ReadFromPath(output_file_map_path, emit_module_path,
-                                   emit_objc_header_path);
-
       // Rewrite the output file map to use the incremental storage area and
-      // pass the compiler the path to the rewritten file.
+      // pass the compiler the path to the rewritten file. Maps that haven't
+      // changed since an earlier request are reused, and the rewritten file is
+      // left untouched.
       std::string new_path = std::filesystem::path(output_file_map_path)
                                  .replace_extension(".incremental.json")
                                  .string();
-      output_file_map.WriteToPath(new_path);
+      std::ostringstream error;
+      output_file_map = OutputFileMapCache::Shared().Rewrite(
+          output_file_map_path, new_path, emit_module_path,
+          emit_objc_header_path, error);
+      if (output_file_map == nullptr) {
+        FinalizeWorkRequest(request, response, EXIT_FAILURE, error);
+        return;
+      }
 
-      params_file_stream << "-output-file-map\n";
-      params_file_stream << new_path << '\n';
+      processed_args.push_back("-output-file-map");
+      processed_args.push_back(new_path);
 
       // Pass the incremental flags only if WMO is disabled. WMO would overrule
       // incremental mode anyway, but since we control the passing of this flag,
       // there's no reason to pass it when it's a no-op.
-      params_file_stream << "-incremental\n";
+      processed_args.push_back("-incremental");
     } else {
       // If WMO or -dump-ast is forcing us out of incremental mode, just put the
       // original output file map back so the outputs end up where they should.
-      params_file_stream << "-output-file-map\n";
-      params_file_stream << output_file_map_path << '\n';
+      processed_args.push_back("-output-file-map");
+      processed_args.push_back(output_file_map_path);
     }
   }
 
-  processed_args.push_back("@" + params_file->GetPath());
-  params_file_stream.close();
-
   std::ostringstream stderr_stream;
 
+  // Tracks how files were moved in and out of the incremental storage area, so
+  // the cost of the transfers can be seen in the worker log.
+  FileTransferStats transfer_stats;
+  FileSnapshotCache& snapshot_cache = FileSnapshotCache::Shared();
+
+  // Describes the state of the incremental storage area after the last
+  // compile of this module.
+  std::string manifest_path;
+
+  // Exists while the compiler runs, so that a compile that was interrupted
+  // before its outputs could be recorded isn't trusted by the next one.
+  std::string in_progress_path;
+
+  // The digests and modification times of the inputs of the last successful
+  // compile of this module, and of this one.
+  std::string input_digests_path;
+  InputDigestTable current_inputs;
+  bool use_input_digests = false;
+  if (is_incremental) {
+    std::filesystem::path module_swiftdeps(
+        std::string(output_file_map->incremental_module_swiftdeps()));
+    manifest_path = std::filesystem::path(module_swiftdeps)
+                        .replace_extension(".incremental_manifest")
+                        .string();
+    in_progress_path = std::filesystem::path(module_swiftdeps)
+                           .replace_extension(".incremental_in_progress")
+                           .string();
+    use_input_digests = UseInputDigests();
+    if (use_input_digests) {
+      input_digests_path =
+          module_swiftdeps.replace_extension(".input_digests").string();
+      current_inputs = InputDigestTable::FromInputs(request.inputs);
+    }
+  }
+
+  // Keeps other workers from evicting this module's storage while it compiles.
+  std::unique_ptr<IncrementalStorageQuota::Lease> storage_lease;
+  if (is_incremental) {
+    storage_lease = IncrementalStorageQuota::Shared().Acquire(manifest_path);
+  }
+
+  // Set if the build record was rewritten, so that it can be put back if the
+  // compile fails.
+  std::optional<BuildRecordEdit> build_record_edit;
+
   if (is_incremental) {
     std::set<std::string> dir_paths;
 
     for (const auto& expected_object_pair :
-         output_file_map.incremental_inputs()) {
+         output_file_map->incremental_inputs()) {
       const auto expected_object_path =
-          std::filesystem::path(expected_object_pair.second);
+          std::filesystem::path(std::string(expected_object_pair.second));
 
       // In rules_swift < 3.x the .swiftsourceinfo files are unconditionally
       // written to the module path. In rules_swift >= 3.x these same files are
@@ -187,74 +311,178 @@ void WorkProcessor::ProcessWorkRequest(
     }
 
     for (const auto& expected_object_pair :
-         output_file_map.incremental_outputs()) {
+         output_file_map->incremental_outputs()) {
       // Bazel creates the intermediate directories for the files declared at
       // analysis time, but we need to manually create the ones for the
       // incremental storage area.
       const std::string dir_path =
-          std::filesystem::path(expected_object_pair.second)
+          std::filesystem::path(std::string(expected_object_pair.second))
               .parent_path()
               .string();
       dir_paths.insert(dir_path);
     }
 
+    // The directories are independent of each other, and so are the files
+    // checked, copied, and removed below, so each group is submitted as a
+    // single batch instead of paying for one round trip per path.
+    FileOperationBatch batch(&transfer_stats);
     for (const auto& dir_path : dir_paths) {
-      std::error_code ec;
-      std::filesystem::create_directories(LongPath(dir_path), ec);
-      if (ec) {
-        stderr_stream << "swift_worker: Could not create directory " << dir_path
-                      << " (" << ec.message() << ")\n";
-        FinalizeWorkRequest(request, response, EXIT_FAILURE, stderr_stream);
-        return;
-      }
+      batch.CreateDirectories(dir_path);
+    }
+    if (!batch.Run(stderr_stream)) {
+      FinalizeWorkRequest(request, response, EXIT_FAILURE, stderr_stream);
+      return;
     }
 
     // Copy some input files from the incremental storage area to the locations
     // where Bazel will generate them. swiftc expects all or none of them exist
     // otherwise the next invocation may not produce all the files. We also need
     // to remove some files that exist in the incremental storage area.
-    auto inputs = output_file_map.incremental_inputs();
-    bool all_inputs_exist = std::all_of(
-        inputs.cbegin(), inputs.cend(), [](const auto& expected_object_pair) {
-          return std::filesystem::exists(LongPath(expected_object_pair.second));
-        });
+    auto inputs = output_file_map->incremental_inputs();
+    std::unique_ptr<bool[]> inputs_exist(new bool[inputs.size()]());
+    size_t input_index = 0;
+    for (const auto& expected_object_pair : inputs) {
+      batch.Exists(std::string(expected_object_pair.second),
+                   &inputs_exist[input_index++]);
+    }
+    if (!batch.Run(stderr_stream)) {
+      FinalizeWorkRequest(request, response, EXIT_FAILURE, stderr_stream);
+      return;
+    }
+    bool all_inputs_exist =
+        std::all_of(inputs_exist.get(), inputs_exist.get() + inputs.size(),
+                    [](bool exists) { return exists; });
+
+    // The module-level files (the driver's dependency graph and the module
+    // outputs) can only be trusted if they are exactly what the last compile
+    // left behind, and nothing can be trusted if that compile was interrupted.
+    // Without a manifest, all we can check is that they exist.
+    IncrementalManifest manifest;
+    bool have_manifest = manifest.ReadFromPath(manifest_path);
+    bool graph_trusted =
+        all_inputs_exist &&
+        !std::filesystem::exists(LongPath(in_progress_path));
+    if (have_manifest && graph_trusted) {
+      graph_trusted = manifest.Matches(
+          std::string(output_file_map->incremental_module_swiftdeps()),
+          snapshot_cache);
+      for (const auto& expected_object_pair : inputs) {
+        graph_trusted =
+            graph_trusted &&
+            manifest.Matches(std::string(expected_object_pair.second),
+                             snapshot_cache);
+      }
+    }
 
-    if (all_inputs_exist) {
+    std::atomic<size_t> invalidated_sources(0);
+    if (graph_trusted) {
       for (const auto& expected_object_pair : inputs) {
-        std::error_code ec;
-        copy_file(expected_object_pair.second, expected_object_pair.first, ec);
-        if (ec) {
-          stderr_stream << "swift_worker: Could not copy "
-                        << expected_object_pair.second << " to "
-                        << expected_object_pair.first << " (" << ec.message()
-                        << ")\n";
-          FinalizeWorkRequest(request, response, EXIT_FAILURE, stderr_stream);
-          return;
+        // The storage area has to keep an intact copy of these if the compile
+        // fails partway through, so they must not share an inode with it.
+        batch.Transfer(std::string(expected_object_pair.second),
+                       std::string(expected_object_pair.first),
+                       /*allow_hard_link=*/false);
+      }
+
+      // If the outputs of a single source file were lost or changed (for
+      // example, by an interrupted build), discard just that file's state so
+      // the driver recompiles it, rather than the whole module.
+      if (have_manifest) {
+        for (const auto& [source_swiftdeps, source_outputs] :
+             output_file_map->incremental_source_outputs()) {
+          std::string swiftdeps(source_swiftdeps);
+          batch.Add(
+              [&manifest, &snapshot_cache, &invalidated_sources, swiftdeps,
+               outputs = source_outputs](std::error_code& ec) {
+                bool consistent = manifest.Matches(swiftdeps, snapshot_cache);
+                for (absl::string_view output : outputs) {
+                  consistent = consistent && manifest.Matches(
+                                                 std::string(output),
+                                                 snapshot_cache);
+                }
+                if (consistent) {
+                  return true;
+                }
+                ++invalidated_sources;
+                std::filesystem::remove(LongPath(swiftdeps), ec);
+                for (absl::string_view output : outputs) {
+                  if (!ec) {
+                    std::filesystem::remove(LongPath(std::string(output)), ec);
+                  }
+                }
+                return !ec;
+              },
+              "remove " + swiftdeps);
         }
       }
     } else {
-      auto cleanup_outputs = output_file_map.incremental_cleanup_outputs();
-      for (const auto& cleanup_output : cleanup_outputs) {
-        if (!std::filesystem::exists(LongPath(cleanup_output))) {
-          continue;
-        }
+      for (const auto& cleanup_output :
+           output_file_map->incremental_cleanup_outputs()) {
+        batch.Remove(std::string(cleanup_output));
+      }
+      batch.Remove(manifest_path);
+      batch.Remove(in_progress_path);
+    }
+    if (!batch.Run(stderr_stream)) {
+      FinalizeWorkRequest(request, response, EXIT_FAILURE, stderr_stream);
+      return;
+    }
+    if (request.verbosity > 0 && invalidated_sources > 0) {
+      std::cerr << "swift_worker: Discarded incremental state for "
+                << invalidated_sources << " source files that changed since "
+                << "generation " << manifest.generation() << "\n";
+    }
 
-        std::error_code ec;
-        std::filesystem::remove(LongPath(cleanup_output), ec);
-        if (ec) {
-          stderr_stream << "swift_worker: Could not remove " << cleanup_output
-                        << " (" << ec.message() << ")\n";
-          FinalizeWorkRequest(request, response, EXIT_FAILURE, stderr_stream);
-          return;
-        }
+    // The driver compares the modification times of the inputs with the ones
+    // in its build record, which change whenever Bazel materializes an input
+    // again. Inputs whose digests haven't changed since the last successful
+    // compile are made to look unchanged.
+    if (graph_trusted && use_input_digests) {
+      InputDigestTable previous_inputs;
+      if (previous_inputs.ReadFromPath(input_digests_path)) {
+        build_record_edit = current_inputs.NormalizeBuildRecord(
+            std::string(output_file_map->incremental_module_swiftdeps()),
+            previous_inputs);
+      }
+      if (request.verbosity > 0 && build_record_edit.has_value() &&
+          build_record_edit->restamped_sources() > 0) {
+        std::cerr << "swift_worker: Kept "
+                  << build_record_edit->restamped_sources()
+                  << " source files whose modification times changed but "
+                  << "whose digests didn't\n";
       }
     }
   }
 
+  if (is_incremental) {
+    // If the marker can't be written, an interruption couldn't be detected, so
+    // the manifest is removed instead.
+    if (!std::ofstream(LongPath(in_progress_path), std::ios::trunc)) {
+      std::error_code ec;
+      std::filesystem::remove(LongPath(manifest_path), ec);
+    }
+  }
+
   SwiftRunner swift_runner(processed_args, index_import_path_,
                            /*force_response_file=*/true);
+  if (is_incremental) {
+    swift_runner.SetOutputFileMap(output_file_map.get());
+  }
   int exit_code = swift_runner.Run(&stderr_stream, /*stdout_to_stderr=*/true);
   if (exit_code != 0) {
+    if (build_record_edit.has_value()) {
+      build_record_edit->Revert();
+    }
+    if (is_incremental) {
+      // The driver has already rewritten its dependency graph, its build
+      // record, and the outputs of the sources that compiled, and its build
+      // record marks the ones that failed to be compiled again. The next
+      // compile can build on that state as long as it's recorded.
+      RecordIncrementalStorage(*output_file_map, manifest_path,
+                               snapshot_cache);
+      std::error_code ec;
+      std::filesystem::remove(LongPath(in_progress_path), ec);
+    }
     FinalizeWorkRequest(request, response, exit_code, stderr_stream);
     return;
   }
@@ -262,32 +490,31 @@ void WorkProcessor::ProcessWorkRequest(
   if (is_incremental) {
     // Copy the output files from the incremental storage area back to the
     // locations where Bazel declared the files.
+    FileOperationBatch batch(&transfer_stats);
     for (const auto& expected_object_pair :
-         output_file_map.incremental_outputs()) {
-      std::error_code ec;
-      copy_file(expected_object_pair.second, expected_object_pair.first, ec);
-      if (ec) {
-        stderr_stream << "swift_worker: Could not copy "
-                      << expected_object_pair.second << " to "
-                      << expected_object_pair.first << " (" << ec.message()
-                      << ")\n";
-        FinalizeWorkRequest(request, response, EXIT_FAILURE, stderr_stream);
-        return;
-      }
+         output_file_map->incremental_outputs()) {
+      std::filesystem::path from = std::string(expected_object_pair.second);
+      std::filesystem::path to = std::string(expected_object_pair.first);
+      batch.Add(
+          [from, to, &transfer_stats](std::error_code& ec) {
+            return SyncFile(from, to, transfer_stats, ec);
+          },
+          "copy " + from.string() + " to " + to.string());
+    }
+    if (!batch.Run(stderr_stream)) {
+      FinalizeWorkRequest(request, response, EXIT_FAILURE, stderr_stream);
+      return;
     }
 
     // Copy the replaced input files back to the incremental storage for the
     // next run.
     for (const auto& expected_object_pair :
-         output_file_map.incremental_inputs()) {
-      if (std::filesystem::exists(LongPath(expected_object_pair.first))) {
-        if (std::filesystem::exists(LongPath(expected_object_pair.second))) {
-          // CopyFile fails if the file already exists
-          std::filesystem::remove(LongPath(expected_object_pair.second));
-        }
+         output_file_map->incremental_inputs()) {
+      std::filesystem::path from = std::string(expected_object_pair.first);
+      std::filesystem::path to = std::string(expected_object_pair.second);
+      if (std::filesystem::exists(LongPath(from))) {
         std::error_code ec;
-        copy_file(expected_object_pair.first, expected_object_pair.second, ec);
-        if (ec) {
+        if (!SyncFile(from, to, transfer_stats, ec)) {
           stderr_stream << "swift_worker: Could not copy "
                         << expected_object_pair.first << " to "
                         << expected_object_pair.second << " (" << ec.message()
@@ -302,6 +529,20 @@ void WorkProcessor::ProcessWorkRequest(
         return;
       }
     }
+
+    RecordIncrementalStorage(*output_file_map, manifest_path, snapshot_cache);
+    std::error_code ec;
+    std::filesystem::remove(LongPath(in_progress_path), ec);
+    if (use_input_digests && !current_inputs.WriteToPath(input_digests_path)) {
+      std::filesystem::remove(LongPath(input_digests_path), ec);
+    }
+
+    IncrementalStorageQuota::Shared().MaybeEvict(
+        request.verbosity > 0 ? &std::cerr : nullptr);
+  }
+
+  if (request.verbosity > 0 && !transfer_stats.empty()) {
+    transfer_stats.Report(std::cerr);
   }
 
   FinalizeWorkRequest(request, response, exit_code, stderr_stream);
@@ -0,0 +1,98 @@
+// Copyright 2026 The Bazel Authors. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests for how the worker passes a request's arguments to the compiler. The
+// compiler is replaced by a script that prints the response files it is given,
+// which the worker returns as the request's output.
+
+#include <sys/stat.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "tools/common/test_support.h"
+#include "tools/worker/work_processor.h"
+#include "tools/worker/worker_protocol.h"
+
+using bazel_rules_swift::worker_protocol::WorkRequest;
+using bazel_rules_swift::worker_protocol::WorkResponse;
+
+namespace {
+
+// Writes a script that prints the contents of each response file it is passed,
+// and each other argument on a line of its own, to stderr.
+std::string WriteFakeCompiler(const std::filesystem::path& directory) {
+  std::string path = (directory / "fake_swiftc").string();
+  std::ofstream(path, std::ios::trunc)
+      << "#!/bin/sh\n"
+         "for arg in \"$@\"; do\n"
+         "  case \"$arg\" in\n"
+         "    @*) cat \"${arg#@}\" >&2 ;;\n"
+         "    *) echo \"$arg\" >&2 ;;\n"
+         "  esac\n"
+         "done\n";
+  chmod(path.c_str(), 0755);
+  return path;
+}
+
+// Returns the output of running the fake compiler through the worker with
+// `arguments`.
+std::string RunRequest(const std::string& compiler,
+                       const std::vector<std::string>& arguments) {
+  WorkProcessor processor({compiler}, /*index_import_path=*/"");
+  WorkRequest request;
+  request.arguments = arguments;
+  request.request_id = 0;
+  request.cancel = false;
+  request.verbosity = 0;
+  WorkResponse response;
+  processor.ProcessWorkRequest(request, response);
+  CHECK(response.exit_code == 0);
+  return response.output;
+}
+
+void TestPlainArgumentsAreUnchanged() {
+  std::string output = RunRequest(
+      WriteFakeCompiler(bazel_rules_swift::testing::MakeTestDirectory(
+          "work_processor_test_plain")),
+      {"-module-name", "M", "-DDEBUG", "Sources/A.swift"});
+  CHECK(output.find("\"-module-name\"\n\"M\"\n\"-DDEBUG\"\n"
+                    "\"Sources/A.swift\"\n") != std::string::npos);
+}
+
+void TestQuotedAndEscapedArgumentsAreUnescaped() {
+  // Each argument is unescaped the way a response file line is, and written
+  // to the compiler's response file quoted and escaped again.
+  std::string output = RunRequest(
+      WriteFakeCompiler(bazel_rules_swift::testing::MakeTestDirectory(
+          "work_processor_test_escaped")),
+      {"-Xcc", "'-DGREETING=hello world'", "Sources/With\\ Space.swift",
+       "-Xcc", "-DQUOTE=\\\"q\\\"", "Sources/Back\\\\slash.swift"});
+  CHECK(output.find("\"-DGREETING=hello world\"\n") != std::string::npos);
+  CHECK(output.find("\"Sources/With Space.swift\"\n") != std::string::npos);
+  CHECK(output.find("\"-DQUOTE=\\\"q\\\"\"\n") != std::string::npos);
+  CHECK(output.find("\"Sources/Back\\\\slash.swift\"\n") !=
+        std::string::npos);
+  CHECK(output.find("'") == std::string::npos);
+}
+
+}  // namespace
+
+int main() {
+  TestPlainArgumentsAreUnchanged();
+  TestQuotedAndEscapedArgumentsAreUnescaped();
+  return bazel_rules_swift::testing::TestExitCode();
+}
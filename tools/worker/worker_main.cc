@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <filesystem>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -21,10 +22,17 @@
 #include "tools/cpp/runfiles/runfiles.h"
 #include "tools/worker/compile_with_worker.h"
 #include "tools/worker/compile_without_worker.h"
+#include "tools/worker/plugin_pool.h"
 
 using bazel::tools::cpp::runfiles::Runfiles;
 
 int main(int argc, char* argv[]) {
+  // The scripts that stand in for pooled macro plugins run the worker binary
+  // to relay the frontend's messages to the pool.
+  if (argc == 4 && std::string(argv[1]) == kPluginProxyFlag) {
+    return RunPluginProxy(argv[2], argv[3]);
+  }
+
   std::string index_import_path;
 #ifdef BAZEL_CURRENT_REPOSITORY
   std::unique_ptr<Runfiles> runfiles(
@@ -60,5 +68,6 @@ int main(int argc, char* argv[]) {
 
   // Remove the special flag before starting the worker processing loop.
   args.erase(persistent_worker_it);
+  PluginPool::Start(std::filesystem::absolute(argv[0]).string());
   return CompileWithWorker(args, index_import_path);
 }